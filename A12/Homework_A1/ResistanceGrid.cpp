@@ -18,6 +18,7 @@ template<unsigned long long _dim>struct SquareGrid
 	unsigned long long clipB;
 	unsigned long long clipID;
 	double rCholesky;
+	double rCholeskySparse;
 	double rSteepestDescent;
 	double rConjugateGradient;
 	double rConjugateGradientSparse;
@@ -33,6 +34,7 @@ template<unsigned long long _dim>struct SquareGrid
 		clipB(_clipB),
 		clipID(_clipA* dim + _clipB),
 		rCholesky(0),
+		rCholeskySparse(0),
 		rSteepestDescent(0),
 		rConjugateGradient(0),
 		rConjugateGradientSparse(0)
@@ -46,6 +48,25 @@ template<unsigned long long _dim>struct SquareGrid
 		if (b == 0)s--; if (b == _dim)s--;
 		return s;
 	}
+	//full (not grounded) Laplacian of all dim * dim nodes for ResistanceEngine, a: SparseMat of 5 * dim * dim elements
+	static mat& laplacian(mat& a)
+	{
+		if (a.matType != MatType::SparseMat)return a;
+		unsigned long long cnt(0);
+		for (unsigned long long c0(0); c0 < dim; ++c0)
+			for (unsigned long long c1(0); c1 < dim; ++c1)
+			{
+				unsigned long long n(c0 * dim + c1);
+				double s(4.0 - (c0 == 0) - (c0 == _dim) - (c1 == 0) - (c1 == _dim));
+				if (c0)a.addSparse(n, n - dim, -1, cnt);
+				if (c1)a.addSparse(n, n - 1, -1, cnt);
+				a.addSparse(n, n, s, cnt);
+				if (c1 != _dim)a.addSparse(n, n + 1, -1, cnt);
+				if (c0 != _dim)a.addSparse(n, n + dim, -1, cnt);
+			}
+		a.elementNum = cnt;
+		return a;
+	}
 	void setGrid()
 	{
 		unsigned long long cnt(0);
@@ -133,6 +154,18 @@ template<unsigned long long _dim>struct SquareGrid
 		timer.print();
 		return rCholesky;
 	}
+	//supernodal sparse Cholesky on matSparse (nested dissection)
+	double solveCholeskySparse()
+	{
+		timer.begin();
+		sparseCholesky chol(matSparse, matDim);
+		chol.solve(i, u);
+		timer.end();
+		rCholeskySparse = u.data[0];
+		::printf("%.15e\tSquareGrid<%llu> CholeskySparse\t", rCholeskySparse, _dim);
+		timer.print();
+		return rCholeskySparse;
+	}
 	/*double solveSteepestDescent(double _esp)
 	{
 		u = 0;
@@ -371,6 +404,7 @@ template<unsigned long long _dim>struct HexagonGrid
 	unsigned long long clipB;
 	unsigned long long clipID;
 	double rCholesky;
+	double rCholeskyRCM;
 	double rSteepestDescent;
 	double rConjugateGradient;
 	double rConjugateGradientSparse;
@@ -387,6 +421,7 @@ template<unsigned long long _dim>struct HexagonGrid
 		clipB(_clipB),
 		clipID(id(_clipA, _clipB)),
 		rCholesky(0),
+		rCholeskyRCM(0),
 		rSteepestDescent(0),
 		rConjugateGradient(0),
 		rConjugateGradientSparse(0)
@@ -527,6 +562,24 @@ template<unsigned long long _dim>struct HexagonGrid
 		timer.print();
 		return rCholesky;
 	}
+	//reverse Cuthill-McKee on matSparse instead of the natural ordering of matLBand
+	double solveCholeskyRCM()
+	{
+		timer.begin();
+		matOrdering ordering(matSparse, matDim);
+		mat band;
+		ordering.toLBand(matSparse, band);
+		vec ip(matDim, false);
+		vec up(matDim, false);
+		ordering.permute(i, ip);
+		band.solveCholeskyBand(ip, up);
+		ordering.permuteBack(up, u);
+		timer.end();
+		rCholeskyRCM = u.data[0];
+		::printf("%.15e\tHexagonGrid<%llu> CholeskyRCM(%llu)\t", rCholeskyRCM, _dim, band.halfBandWidth);
+		timer.print();
+		return rCholeskyRCM;
+	}
 	/*double solveSteepestDescent(double _esp)
 	{
 		u = 0;
@@ -569,6 +622,7 @@ template<unsigned long long _dim>struct TriangleGridCplx2Real
 
 	mat matLBand;
 	mat matSparse;
+	matBSR<2> matBlock;
 	vec u;
 	vec i;
 	unsigned long long clipA;
@@ -576,7 +630,9 @@ template<unsigned long long _dim>struct TriangleGridCplx2Real
 	unsigned long long clipID;
 	double omega;
 	cplx rCholesky;
+	cplx rCholeskyRCM;
 	cplx rConjugateGradientSparse;
+	cplx rConjugateGradientBSR;
 	Timer timer;
 
 	TriangleGridCplx2Real(unsigned long long _clipA, unsigned long long _clipB)
@@ -589,7 +645,9 @@ template<unsigned long long _dim>struct TriangleGridCplx2Real
 		clipB(_clipB),
 		clipID(id(_clipA, _clipB)),
 		rCholesky({ 0,0 }),
-		rConjugateGradientSparse({ 0,0 })
+		rCholeskyRCM({ 0,0 }),
+		rConjugateGradientSparse({ 0,0 }),
+		rConjugateGradientBSR({ 0,0 })
 	{
 		i.data[0] = 1;
 	}
@@ -755,6 +813,8 @@ template<unsigned long long _dim>struct TriangleGridCplx2Real
 			}
 		}
 		matSparse.elementNum = cnt;
+		//node n owns rows 2n, 2n + 1, so every coupling is one 2 x 2 block
+		matBlock.set(matSparse, matDim);
 	}
 	cplx solveCholesky()
 	{
@@ -769,6 +829,27 @@ template<unsigned long long _dim>struct TriangleGridCplx2Real
 		timer.print();
 		return rCholesky;
 	}
+	//reverse Cuthill-McKee on matSparse instead of the (dim + 1) * 2 wide natural ordering
+	cplx solveCholeskyRCM()
+	{
+		timer.begin();
+		matOrdering ordering(matSparse, matDim);
+		mat band;
+		ordering.toLBand(matSparse, band);
+		vec ip(matDim, false);
+		vec up(matDim, false);
+		ordering.permute(i, ip);
+		band.solveCholeskyBand(ip, up);
+		ordering.permuteBack(up, u);
+		timer.end();
+		rCholeskyRCM.im = u.data[0];
+		rCholeskyRCM.re = u.data[1];
+		cplx pole(rCholeskyRCM.transToPole());
+		::printf("(%.15e, %.15e), (%.15e, %.15e)\tTriangleGridCplx2Real<%llu, omega=%.3e> CholeskyRCM(%llu)\t",
+			rCholeskyRCM.re, rCholeskyRCM.im, pole.re, pole.im, _dim, omega, band.halfBandWidth);
+		timer.print();
+		return rCholeskyRCM;
+	}
 	cplx solveConjugateGradientSparse(double _esp)
 	{
 		timer.begin();
@@ -782,6 +863,19 @@ template<unsigned long long _dim>struct TriangleGridCplx2Real
 		timer.print();
 		return rConjugateGradientSparse;
 	}
+	cplx solveConjugateGradientBSR(double _esp)
+	{
+		timer.begin();
+		matBlock.solveConjugateGradient(i, u, _esp);
+		timer.end();
+		rConjugateGradientBSR.im = u.data[0];
+		rConjugateGradientBSR.re = u.data[1];
+		cplx pole(rConjugateGradientBSR.transToPole());
+		::printf("(%.15e, %.15e), (%.15e, %.15e)\tTriangleGridCplx2Real<%llu, omega=%.3e> ConjugateGradientBSR\t",
+			rConjugateGradientBSR.re, rConjugateGradientBSR.im, pole.re, pole.im, _dim, omega);
+		timer.print();
+		return rConjugateGradientBSR;
+	}
 };
 
 template<unsigned long long _dim>struct TriangleGridCplx
@@ -792,6 +886,8 @@ template<unsigned long long _dim>struct TriangleGridCplx
 	matCplx matLBand;
 	//mat matBand;
 	matCplx matSparse;
+	matCplxCSR matCSR;
+	matLDLTCplxBand ldlt;
 	vecCplx u;
 	vecCplx i;
 	unsigned long long clipA;
@@ -799,8 +895,13 @@ template<unsigned long long _dim>struct TriangleGridCplx
 	unsigned long long clipID;
 	double omega;
 	cplx rCholesky;
+	cplx rLDLT;
 	cplx rConjugateGradientSparse;
 	cplx rConjugateGradientSparseDagger;
+	cplx rConjugateGradientCSR;
+	cplx rCOCG;
+	cplx rBiCGStab;
+	cplx rGMRES;
 	Timer timer;
 
 	TriangleGridCplx(unsigned long long _clipA, unsigned long long _clipB)
@@ -814,8 +915,13 @@ template<unsigned long long _dim>struct TriangleGridCplx
 		clipB(_clipB),
 		clipID(id(_clipA, _clipB)),
 		rCholesky({ 0,0 }),
+		rLDLT({ 0,0 }),
 		rConjugateGradientSparse({ 0,0 }),
-		rConjugateGradientSparseDagger({ 0,0 })
+		rConjugateGradientSparseDagger({ 0,0 }),
+		rConjugateGradientCSR({ 0,0 }),
+		rCOCG({ 0,0 }),
+		rBiCGStab({ 0,0 }),
+		rGMRES({ 0,0 })
 	{
 		i.re.data[0] = 1;
 	}
@@ -945,6 +1051,7 @@ template<unsigned long long _dim>struct TriangleGridCplx
 		}
 		matSparse.re.elementNum = cntre;
 		matSparse.im.elementNum = cntim;
+		matCSR.set(matSparse, matDim);
 	}
 	cplx solveCholesky()
 	{
@@ -959,6 +1066,21 @@ template<unsigned long long _dim>struct TriangleGridCplx
 		timer.print();
 		return rCholesky;
 	}
+	//complex symmetric band L D L^T, matLBand is kept so it can be called before solveCholesky
+	cplx solveLDLT()
+	{
+		timer.begin();
+		ldlt.factor(matLBand);
+		ldlt.solve(i, u);
+		timer.end();
+		rLDLT.re = u.re.data[0];
+		rLDLT.im = u.im.data[0];
+		cplx pole(rLDLT.transToPole());
+		::printf("(%.15e, %.15e), (%.15e, %.15e)\tTriangleGridCplx<%llu, omega=%.3e> LDLT\t\t",
+			rLDLT.re, rLDLT.im, pole.re, pole.im, _dim, omega);
+		timer.print();
+		return rLDLT;
+	}
 	cplx solveConjugateGradientSparse(double _esp)
 	{
 		timer.begin();
@@ -985,8 +1107,855 @@ template<unsigned long long _dim>struct TriangleGridCplx
 		timer.print();
 		return rConjugateGradientSparseDagger;
 	}
+	//CG on the Hermitian positive definite A^H A with the shared-pattern CSR copy, same iteration as
+	//solveConjugateGradientSparseDagger; plain CG does not converge on this complex symmetric A
+	cplx solveConjugateGradientCSR(double _esp)
+	{
+		timer.begin();
+		matCSR.solveConjugateGradientDagger(i, u, _esp);
+		timer.end();
+		rConjugateGradientCSR.re = u.re.data[0];
+		rConjugateGradientCSR.im = u.im.data[0];
+		cplx pole(rConjugateGradientCSR.transToPole());
+		::printf("(%.15e, %.15e), (%.15e, %.15e)\tTriangleGridCplx<%llu, omega=%.3e> ConjugateGradientCSR\t",
+			rConjugateGradientCSR.re, rConjugateGradientCSR.im, pole.re, pole.im, _dim, omega);
+		timer.print();
+		return rConjugateGradientCSR;
+	}
+	//Jacobi preconditioned Krylov solvers on matCSR, the matrix is complex symmetric so COCG applies
+	cplx solveCOCG(double _eps)
+	{
+		krylovCplx solver(_eps);
+		timer.begin();
+		solver.cocg(matCSR, i, u, jacobiCplx(matCSR));
+		timer.end();
+		rCOCG.re = u.re.data[0];
+		rCOCG.im = u.im.data[0];
+		cplx pole(rCOCG.transToPole());
+		::printf("(%.15e, %.15e), (%.15e, %.15e)\tTriangleGridCplx<%llu, omega=%.3e> COCG(%llu)\t",
+			rCOCG.re, rCOCG.im, pole.re, pole.im, _dim, omega, solver.iters);
+		timer.print();
+		return rCOCG;
+	}
+	cplx solveBiCGStab(double _eps)
+	{
+		krylovCplx solver(_eps);
+		timer.begin();
+		solver.bicgstab(matCSR, i, u, jacobiCplx(matCSR));
+		timer.end();
+		rBiCGStab.re = u.re.data[0];
+		rBiCGStab.im = u.im.data[0];
+		cplx pole(rBiCGStab.transToPole());
+		::printf("(%.15e, %.15e), (%.15e, %.15e)\tTriangleGridCplx<%llu, omega=%.3e> BiCGStab(%llu)\t",
+			rBiCGStab.re, rBiCGStab.im, pole.re, pole.im, _dim, omega, solver.iters);
+		timer.print();
+		return rBiCGStab;
+	}
+	cplx solveGMRES(double _eps, unsigned long long _restart = 50)
+	{
+		krylovCplx solver(_eps, 100000, _restart);
+		timer.begin();
+		solver.gmres(matCSR, i, u, jacobiCplx(matCSR));
+		timer.end();
+		rGMRES.re = u.re.data[0];
+		rGMRES.im = u.im.data[0];
+		cplx pole(rGMRES.transToPole());
+		::printf("(%.15e, %.15e), (%.15e, %.15e)\tTriangleGridCplx<%llu, omega=%.3e> GMRES(%llu)\t",
+			rGMRES.re, rGMRES.im, pole.re, pole.im, _dim, omega, solver.iters);
+		timer.print();
+		return rGMRES;
+	}
+};
+
+
+//lattice with sizes given at run time: a unit cell of siteNum sites repeated over the cells (a, b) of a region,
+//bond {s0, s1, da, db, y, power} joins site s0 of cell (a, b) to site s1 of cell (a + da, b + db) with admittance y omega^power
+//bonds leaving the region are dropped, the ground node is removed from the system but still loads its neighbours
+struct Lattice
+{
+	enum class Shape
+	{
+		Rectangle,//0 <= a < rows, 0 <= b < cols
+		Triangle,//0 <= b <= a < rows
+	};
+	struct Bond
+	{
+		unsigned long long s0;
+		unsigned long long s1;
+		long long da;
+		long long db;
+		cplx y;
+		long long power;//0: resistor, 1: capacitor (y = i C), -1: inductor (y = -i / L)
+	};
+
+	Shape shape;
+	unsigned long long rows;
+	unsigned long long cols;
+	unsigned long long siteNum;
+	unsigned long long nodeNum;
+	unsigned long long ground;//nodeNum: nothing removed
+	unsigned long long matDim;
+	double omega;
+	std::vector<Bond> bonds;
+
+	Lattice(Shape _shape, unsigned long long _rows, unsigned long long _cols, unsigned long long _siteNum = 1)
+		:
+		shape(_shape),
+		rows(_rows),
+		cols(_shape == Shape::Triangle ? _rows : _cols),
+		siteNum(_siteNum),
+		nodeNum((_shape == Shape::Triangle ? (_rows * (_rows + 1)) / 2 : _rows * _cols) * _siteNum),
+		ground(nodeNum),
+		matDim(nodeNum),
+		omega(1),
+		bonds()
+	{
+	}
+	Lattice& bond(unsigned long long s0, unsigned long long s1, long long da, long long db, cplx y, long long power = 0)
+	{
+		if (s0 < siteNum && s1 < siteNum && (da || db || s0 != s1))bonds.push_back({ s0, s1, da, db, y, power });
+		return *this;
+	}
+	Lattice& bond(unsigned long long s0, unsigned long long s1, long long da, long long db, double g, long long power = 0)
+	{
+		return bond(s0, s1, da, db, cplx(g, 0), power);
+	}
+	Lattice& frequency(double _omega)
+	{
+		omega = _omega;
+		return *this;
+	}
+	//the bonds of one omega power only, as a frequency independent lattice
+	Lattice part(long long power)const
+	{
+		Lattice a(*this);
+		a.bonds.clear();
+		for (Bond const& bd : bonds)
+			if (bd.power == power)a.bonds.push_back({ bd.s0, bd.s1, bd.da, bd.db, bd.y, 0 });
+		return a;
+	}
+	//remove node (a, b, s) from the system, clip(rows, 0) puts it back
+	Lattice& clip(unsigned long long a, unsigned long long b, unsigned long long s = 0)
+	{
+		ground = inside(a, b) && s < siteNum ? node(a, b, s) : nodeNum;
+		matDim = nodeNum - (ground < nodeNum);
+		return *this;
+	}
+	bool inside(long long a, long long b)const
+	{
+		if (a < 0 || b < 0 || (unsigned long long)a >= rows)return false;
+		if (shape == Shape::Triangle)return b <= a;
+		return (unsigned long long)b < cols;
+	}
+	unsigned long long node(unsigned long long a, unsigned long long b, unsigned long long s = 0)const
+	{
+		if (shape == Shape::Triangle)return (((a + 1) * a) / 2 + b) * siteNum + s;
+		return (a * cols + b) * siteNum + s;
+	}
+	//row of node n in the system, matDim for the ground node
+	unsigned long long index(unsigned long long n)const
+	{
+		if (n == ground)return matDim;
+		return n - (n > ground);
+	}
+	bool isReal()const
+	{
+		for (Bond const& bd : bonds)if (bd.y.im != 0)return false;
+		return true;
+	}
+	cplx admittance(Bond const& bd)const
+	{
+		if (!bd.power)return bd.y;
+		return bd.y * ::pow(omega, double(bd.power));
+	}
+	unsigned long long halfBandWidth()const
+	{
+		std::vector<unsigned long long> hb(threadNum(), 0);
+		forRows([&](unsigned long long r, unsigned long long num, unsigned long long const* col, cplx const*, unsigned long long id)
+			{
+				if (num && r - col[0] > hb[id])hb[id] = r - col[0];
+			});
+		return *std::max_element(hb.begin(), hb.end());
+	}
+	//full symmetric pattern, sorted by row then column (the real parts of y)
+	mat& sparse(mat& a)const
+	{
+		unsigned long long* bgn(rowCount(0));
+		mat r(MatType::SparseMat, bgn[matDim] ? bgn[matDim] : 1);
+		forRows([&](unsigned long long row, unsigned long long num, unsigned long long const* col, cplx const* y, unsigned long long)
+			{
+				unsigned long long p(bgn[row]);
+				for (unsigned long long c0(0); c0 < num; ++c0)
+					if (y[c0].re != 0 || col[c0] == row)
+					{
+						r.rowIndice[p] = row;
+						r.colIndice[p] = col[c0];
+						r.data[p++] = y[c0].re;
+					}
+			});
+		r.elementNum = bgn[matDim];
+		::free(bgn);
+		a = (mat&&)r;
+		return a;
+	}
+	//lower band of the real parts
+	mat& lBand(mat& a)const
+	{
+		a = mat(halfBandWidth(), matDim, MatType::LBandMat, true);
+		forRows([&](unsigned long long row, unsigned long long num, unsigned long long const* col, cplx const* y, unsigned long long)
+			{
+				for (unsigned long long c0(0); c0 < num && col[c0] <= row; ++c0)a.LBandEleRef(row, col[c0]) = y[c0].re;
+			});
+		return a;
+	}
+	//re and im get their own patterns (zeros left out, the diagonal always kept)
+	matCplx& sparse(matCplx& a)const
+	{
+		unsigned long long* bgnRe(rowCount(0));
+		unsigned long long* bgnIm(rowCount(1));
+		mat re(MatType::SparseMat, bgnRe[matDim] ? bgnRe[matDim] : 1);
+		mat im(MatType::SparseMat, bgnIm[matDim] ? bgnIm[matDim] : 1);
+		forRows([&](unsigned long long row, unsigned long long num, unsigned long long const* col, cplx const* y, unsigned long long)
+			{
+				unsigned long long pr(bgnRe[row]), pi(bgnIm[row]);
+				for (unsigned long long c0(0); c0 < num; ++c0)
+				{
+					if (y[c0].re != 0 || col[c0] == row)
+					{
+						re.rowIndice[pr] = row;
+						re.colIndice[pr] = col[c0];
+						re.data[pr++] = y[c0].re;
+					}
+					if (y[c0].im != 0 || col[c0] == row)
+					{
+						im.rowIndice[pi] = row;
+						im.colIndice[pi] = col[c0];
+						im.data[pi++] = y[c0].im;
+					}
+				}
+			});
+		re.elementNum = bgnRe[matDim];
+		im.elementNum = bgnIm[matDim];
+		::free(bgnRe);
+		::free(bgnIm);
+		a.re = (mat&&)re;
+		a.im = (mat&&)im;
+		return a;
+	}
+	matCplx& lBand(matCplx& a)const
+	{
+		unsigned long long hb(halfBandWidth());
+		//same shape as last time: keep the storage
+		if (a.re.data && a.im.data && a.re.matType == MatType::LBandMat && a.im.matType == MatType::LBandMat &&
+			a.re.height == matDim && a.re.halfBandWidth == hb && a.im.height == matDim && a.im.halfBandWidth == hb)
+		{
+			a.re.clear();
+			a.im.clear();
+		}
+		else
+		{
+			a.re = mat(hb, matDim, MatType::LBandMat, true);
+			a.im = mat(hb, matDim, MatType::LBandMat, true);
+		}
+		forRows([&](unsigned long long row, unsigned long long num, unsigned long long const* col, cplx const* y, unsigned long long)
+			{
+				for (unsigned long long c0(0); c0 < num && col[c0] <= row; ++c0)
+				{
+					a.re.LBandEleRef(row, col[c0]) = y[c0].re;
+					a.im.LBandEleRef(row, col[c0]) = y[c0].im;
+				}
+			});
+		return a;
+	}
+
+private:
+	//f(row, num, col, y, threadId) for every row, entries sorted by column with duplicates merged, rows in parallel
+	template<class F>void forRows(F&& f)const
+	{
+		constexpr unsigned long long block(1024);
+		unsigned long long maxNum(2 * bonds.size() + 1);
+		unsigned long long threads(threadNum());
+		std::vector<unsigned long long> colBuffer(threads * maxNum);
+		std::vector<cplx> yBuffer(threads * maxNum, cplx(0, 0));
+		std::vector<cplx> yBond;
+		for (Bond const& bd : bonds)yBond.push_back(admittance(bd));
+		parallelFor((nodeNum + block - 1) / block, [&](unsigned long long c0, unsigned long long id)
+			{
+				unsigned long long* col(colBuffer.data() + id * maxNum);
+				cplx* y(yBuffer.data() + id * maxNum);
+				unsigned long long end(c0 * block + block < nodeNum ? c0 * block + block : nodeNum);
+				unsigned long long a(0), b(0);
+				cellOf(c0 * block / siteNum, a, b);
+				for (unsigned long long n(c0 * block); n < end; ++n)
+				{
+					unsigned long long s(n % siteNum);
+					if (n != c0 * block && !s)
+					{
+						++b;
+						if (!inside(a, b)) { ++a; b = 0; }
+					}
+					if (n == ground)continue;
+					unsigned long long row(n - (n > ground));
+					unsigned long long num(1);
+					col[0] = row;
+					y[0] = cplx(0, 0);
+					for (unsigned long long c1(0); c1 < bonds.size(); ++c1)
+						for (unsigned long long dir(0); dir < 2; ++dir)
+						{
+							Bond const& bd(bonds[c1]);
+							if ((dir ? bd.s1 : bd.s0) != s)continue;
+							long long na(dir ? long long(a) - bd.da : long long(a) + bd.da);
+							long long nb(dir ? long long(b) - bd.db : long long(b) + bd.db);
+							if (!inside(na, nb))continue;
+							y[0] += yBond[c1];
+							unsigned long long m(node(na, nb, dir ? bd.s0 : bd.s1));
+							if (m == ground)continue;
+							col[num] = m - (m > ground);
+							y[num] = cplx(-yBond[c1].re, -yBond[c1].im);
+							++num;
+						}
+					//insertion sort, a row holds only a few entries
+					for (unsigned long long c1(1); c1 < num; ++c1)
+					{
+						unsigned long long tc(col[c1]);
+						cplx ty(y[c1]);
+						long long c2(c1 - 1);
+						for (; c2 >= 0 && col[c2] > tc; --c2)
+						{
+							col[c2 + 1] = col[c2];
+							y[c2 + 1] = y[c2];
+						}
+						col[c2 + 1] = tc;
+						y[c2 + 1] = ty;
+					}
+					unsigned long long m(0);
+					for (unsigned long long c1(1); c1 < num; ++c1)
+					{
+						if (col[c1] == col[m])y[m] += y[c1];
+						else
+						{
+							col[++m] = col[c1];
+							y[m] = y[c1];
+						}
+					}
+					f(row, m + 1, (unsigned long long const*)col, (cplx const*)y, id);
+				}
+			}, threads);
+	}
+	void cellOf(unsigned long long c, unsigned long long& a, unsigned long long& b)const
+	{
+		if (shape == Shape::Triangle)
+		{
+			a = (unsigned long long)((::sqrt(8.0 * c + 1) - 1) / 2);
+			while ((a * (a + 1)) / 2 > c)--a;
+			while (((a + 1) * (a + 2)) / 2 <= c)++a;
+			b = c - (a * (a + 1)) / 2;
+		}
+		else
+		{
+			a = c / cols;
+			b = c % cols;
+		}
+	}
+	//row begin of the entries kept in part (0: re, 1: im), matDim + 1 entries
+	unsigned long long* rowCount(unsigned long long part)const
+	{
+		unsigned long long* bgn((unsigned long long*)::calloc(matDim + 1, sizeof(unsigned long long)));
+		forRows([&](unsigned long long row, unsigned long long num, unsigned long long const* col, cplx const* y, unsigned long long)
+			{
+				unsigned long long k(0);
+				for (unsigned long long c0(0); c0 < num; ++c0)
+					k += (part ? y[c0].im : y[c0].re) != 0 || col[c0] == row;
+				bgn[row + 1] = k;
+			});
+		for (unsigned long long c0(0); c0 < matDim; ++c0)bgn[c0 + 1] += bgn[c0];
+		return bgn;
+	}
+};
+
+//frequency sweep of a lattice whose bonds are resistors (power 0), capacitors (power 1) and inductors (power -1):
+//A(omega) = A0 + omega A1 + A_1 / omega, so omega A(omega) = A_1 + omega A0 + omega^2 A1 is linearised as
+//(P + omega Q)[z; omega z] = [b; 0], P = [A_1, 0; 0, I], Q = [A0, A1; -I, 0], x = omega z,
+//and all omega come from one Krylov space of K^-1 Q with K = P + omega0 Q, where K^-1 needs only A(omega0)^-1
+struct FrequencySweep
+{
+	unsigned long long n;
+	double omega0;
+	matCplxCSR a0;
+	matCplxCSR a1;
+	matLDLTCplxBand ldlt;
+	multiShiftCplx solver;
+	Timer timer;
+
+	FrequencySweep(Lattice const& lattice, double _omega0, double eps = 1e-10, unsigned long long maxDim = 200)
+		:
+		n(lattice.matDim),
+		omega0(_omega0),
+		solver(eps, maxDim)
+	{
+		matCplx a(MatType::SparseMat, 1, 1);
+		a0.set(lattice.part(0).sparse(a), n);
+		a1.set(lattice.part(1).sparse(a), n);
+		matCplx band(0, 1, MatType::LBandMat, false);
+		Lattice l(lattice);
+		ldlt.factor(l.frequency(omega0).lBand(band));
+	}
+	//x[c0]: potentials at omega[c0], false if a shift did not converge
+	bool solve(vecCplx const& b, std::vector<double> const& omega, std::vector<vecCplx>& x)
+	{
+		timer.begin();
+		if (ldlt.singular || b.dim != n)return false;
+		vecCplx f(n, false), g(n, false), t(n, false), u(n, false);
+		auto kInv = [&](vecCplx const& a, vecCplx& c)
+			{
+				split(a, f, g);
+				a1(g, t);
+				f.fmadd(-omega0, t);
+				ldlt.solve(f, u);
+				u *= cplx(1 / omega0, 0);
+				g.fmadd(omega0, u);
+				join(u, g, c);
+			};
+		auto bMult = [&](vecCplx const& a, vecCplx& c)
+			{
+				split(a, f, g);
+				a0(f, t);
+				a1(g, u);
+				t += u;
+				f *= cplx(-1, 0);
+				join(t, f, c);
+			};
+		vecCplx bb(2 * n, true);
+		join(b, vecCplx(n, true), bb);
+		std::vector<cplx> sigma;
+		for (double w : omega)sigma.push_back(cplx(w, 0));
+		std::vector<vecCplx> z;
+		bool converged(solver.solve(kInv, bMult, bb, cplx(omega0, 0), sigma, z));
+		x.resize(omega.size());
+		for (unsigned long long c0(0); c0 < omega.size(); ++c0)
+		{
+			if (x[c0].dim != n)
+			{
+				x[c0].reconstruct(n, false);
+				x[c0].dim = n;
+			}
+			split(z[c0], x[c0], g);
+			x[c0] *= cplx(omega[c0], 0);
+		}
+		timer.end();
+		return converged;
+	}
+
+private:
+	void split(vecCplx const& a, vecCplx& top, vecCplx& bottom)const
+	{
+		memcpy64d(top.re.data, a.re.data, n);
+		memcpy64d(top.im.data, a.im.data, n);
+		memcpy64d(bottom.re.data, a.re.data + n, n);
+		memcpy64d(bottom.im.data, a.im.data + n, n);
+	}
+	void join(vecCplx const& top, vecCplx const& bottom, vecCplx& a)const
+	{
+		memcpy64d(a.re.data, top.re.data, n);
+		memcpy64d(a.im.data, top.im.data, n);
+		memcpy64d(a.re.data + n, bottom.re.data, n);
+		memcpy64d(a.im.data + n, bottom.im.data, n);
+	}
+};
+
+//independent solves over the grid size x clip x omega x source, spread over all cores:
+//largest lattices are taken first, workers pick the next task when done (dynamic scheduling),
+//every worker keeps its band matrix, factorisation and vectors between tasks,
+//rows are written in grid order (source fastest, size slowest) as soon as all rows before them are done
+struct LatticeSweep
+{
+	//node (a * size, b * size, s) rounded is clipped
+	struct Clip
+	{
+		double a;
+		double b;
+		unsigned long long s;
+	};
+	//b: currents into the rows of the system, zero on entry
+	typedef void(*Source)(Lattice const&, vecCplx&);
+	struct Row
+	{
+		unsigned long long size;
+		unsigned long long clip;
+		double omega;
+		unsigned long long source;
+		cplx z{ 0, 0 };//(b, x), the impedance for a unit current
+		long long time;//ns
+	};
+
+	Lattice(*build)(unsigned long long size);
+	std::vector<unsigned long long> sizes;
+	std::vector<Clip> clips;
+	std::vector<double> omegas;
+	std::vector<Source> sources;
+	std::vector<Row> rows;
+	unsigned long long threads;//0: threadNum()
+	Timer timer;
+
+	LatticeSweep(Lattice(*_build)(unsigned long long))
+		:
+		build(_build),
+		sizes(),
+		clips(),
+		omegas(),
+		sources(),
+		rows(),
+		threads(0)
+	{
+	}
+	//unit current into the first node that is not clipped
+	static void unitSource(Lattice const& l, vecCplx& b)
+	{
+		if (l.matDim)b.re.data[l.index(l.ground ? 0 : 1)] = 1;
+	}
+	unsigned long long taskNum()const
+	{
+		return sizes.size() * clips.size() * omegas.size() * sources.size();
+	}
+	//file: tab separated table, nullptr for none; false if the file can not be opened
+	bool run(char const* file = nullptr)
+	{
+		FILE* fp(nullptr);
+		if (file && !(fp = ::fopen(file, "w")))return false;
+		if (fp)::fprintf(fp, "size\tclipA\tclipB\tclipS\tomega\tsource\tre\tim\ttime(ns)\n");
+		timer.begin();
+		unsigned long long n(taskNum());
+		unsigned long long nw(threads ? threads : threadNum());
+		rows.resize(n);
+		std::vector<Worker> workers(nw);
+		//largest first, then in grid order
+		std::vector<unsigned long long> schedule(n);
+		for (unsigned long long c0(0); c0 < n; ++c0)schedule[c0] = c0;
+		std::stable_sort(schedule.begin(), schedule.end(), [&](unsigned long long a, unsigned long long b)
+			{
+				return sizes[sizeOf(a)] > sizes[sizeOf(b)];
+			});
+		parallelOrdered(n, [&](unsigned long long t, unsigned long long id)
+			{
+				solve(t, workers[id]);
+			}, [&](unsigned long long t)
+			{
+				Row const& r(rows[t]);
+				Clip const& cl(clips[r.clip]);
+				if (fp)::fprintf(fp, "%llu\t%.6g\t%.6g\t%llu\t%.15e\t%llu\t%.15e\t%.15e\t%lld\n",
+					r.size, cl.a, cl.b, cl.s, r.omega, r.source, r.z.re, r.z.im, r.time);
+			}, schedule.data(), nw);
+		if (fp)::fclose(fp);
+		timer.end();
+		return true;
+	}
+
+private:
+	struct Worker
+	{
+		matCplx band;
+		matLDLTCplxBand ldlt;
+		vecCplx b;
+		vecCplx x;
+		Worker() :band(0, 1, MatType::LBandMat, false), ldlt(), b(), x() {}
+	};
+	unsigned long long sizeOf(unsigned long long t)const
+	{
+		return t / (clips.size() * omegas.size() * sources.size());
+	}
+	void solve(unsigned long long t, Worker& w)
+	{
+		Timer tm;
+		tm.begin();
+		Row& r(rows[t]);
+		r.source = t % sources.size();
+		t /= sources.size();
+		r.omega = omegas[t % omegas.size()];
+		t /= omegas.size();
+		r.clip = t % clips.size();
+		r.size = sizes[t / clips.size()];
+		Clip const& cl(clips[r.clip]);
+		Lattice l(build(r.size));
+		l.clip((unsigned long long)::llround(cl.a * r.size), (unsigned long long)::llround(cl.b * r.size), cl.s);
+		l.frequency(r.omega);
+		if (w.b.dim != l.matDim)
+		{
+			w.b.reconstruct(l.matDim, false);
+			w.b.dim = l.matDim;
+			w.x.reconstruct(l.matDim, false);
+			w.x.dim = l.matDim;
+		}
+		w.b = cplx(0, 0);
+		sources[r.source](l, w.b);
+		if (w.ldlt.factor(l.lBand(w.band)))
+		{
+			w.ldlt.solve(w.b, w.x);
+			r.z = (w.b, w.x);
+		}
+		else r.z = cplx(NAN, NAN);
+		tm.end();
+		r.time = 1000000000ll * (tm.ending.tv_sec - tm.begining.tv_sec) + (tm.ending.tv_nsec - tm.begining.tv_nsec);
+	}
 };
 
+//effective resistance between many node pairs of one network, the grounded Laplacian is factored once
+//R(i, j) = (e_i - e_j)^T L^+ (e_i - e_j)
+//columns of L^+ are cached for nodes that show up again, a JL sketch gives approximate all-pairs answers
+struct ResistanceEngine
+{
+	sparseCholesky chol;
+	unsigned long long n;
+	unsigned long long ground;
+	//edges for the sketch
+	unsigned long long edgeNum;
+	unsigned long long* edgeA;
+	unsigned long long* edgeB;
+	double* edgeG;
+	//cache: cache[c0] is the potential of all nodes for a unit current into nodeOf[c0], allocated when first filled
+	double** cache;
+	unsigned long long cacheSize;
+	unsigned long long cacheNext;
+	unsigned long long* slotOf;
+	unsigned long long* nodeOf;
+	unsigned long long* slotUse;
+	unsigned long long batch;
+	//sketch: row of a node is its k dimensional embedding
+	mat sketch;
+	unsigned long long sketchSize;
+
+	//laplacian: full symmetric COO of _n nodes sorted by row, _cacheSize: columns of L^+ kept (0: up to ~256MB)
+	ResistanceEngine(mat const& laplacian, unsigned long long _n, unsigned long long _ground = 0, unsigned long long _cacheSize = 0)
+		:
+		n(_n),
+		ground(_ground < _n ? _ground : 0),
+		edgeNum(0),
+		cache(nullptr),
+		cacheSize(_cacheSize ? _cacheSize : (1llu << 25) / (_n ? _n : 1) + 1),
+		cacheNext(0),
+		slotOf((unsigned long long*)::malloc(_n * sizeof(unsigned long long))),
+		nodeOf(nullptr),
+		slotUse(nullptr),
+		batch(0),
+		sketch(),
+		sketchSize(0)
+	{
+		if (cacheSize > n)cacheSize = n;
+		nodeOf = (unsigned long long*)::malloc(cacheSize * sizeof(unsigned long long));
+		slotUse = (unsigned long long*)::calloc(cacheSize, sizeof(unsigned long long));
+		for (unsigned long long c0(0); c0 < n; ++c0)slotOf[c0] = cacheSize;
+		for (unsigned long long c0(0); c0 < cacheSize; ++c0)nodeOf[c0] = n;
+		cache = (double**)::calloc(cacheSize, sizeof(double*));
+		//grounded Laplacian: drop row and column ground
+		unsigned long long cnt(0);
+		for (unsigned long long c0(0); c0 < laplacian.elementNum; ++c0)
+		{
+			unsigned long long r(laplacian.rowIndice[c0]), c(laplacian.colIndice[c0]);
+			if (r != ground && c != ground)cnt++;
+			if (r < c)edgeNum++;
+		}
+		mat lg(MatType::SparseMat, cnt ? cnt : 1);
+		edgeA = (unsigned long long*)::malloc((edgeNum ? edgeNum : 1) * sizeof(unsigned long long));
+		edgeB = (unsigned long long*)::malloc((edgeNum ? edgeNum : 1) * sizeof(unsigned long long));
+		edgeG = (double*)::malloc((edgeNum ? edgeNum : 1) * sizeof(double));
+		cnt = 0;
+		unsigned long long e(0);
+		for (unsigned long long c0(0); c0 < laplacian.elementNum; ++c0)
+		{
+			unsigned long long r(laplacian.rowIndice[c0]), c(laplacian.colIndice[c0]);
+			if (r != ground && c != ground)lg.addSparse(r - (r > ground), c - (c > ground), laplacian.data[c0], cnt);
+			if (r < c)
+			{
+				edgeA[e] = r;
+				edgeB[e] = c;
+				edgeG[e++] = -laplacian.data[c0];
+			}
+		}
+		lg.elementNum = cnt;
+		chol.analyze(lg, n - 1);
+		chol.factor(lg);
+	}
+	ResistanceEngine(ResistanceEngine const&) = delete;
+	~ResistanceEngine()
+	{
+		::free(edgeA);
+		::free(edgeB);
+		::free(edgeG);
+		::free(slotOf);
+		::free(nodeOf);
+		::free(slotUse);
+		for (unsigned long long c0(0); c0 < cacheSize; ++c0)
+			if (cache[c0])_mm_free(cache[c0]);
+		::free(cache);
+	}
+
+	double operator()(unsigned long long a, unsigned long long b)
+	{
+		double r;
+		pairs(&a, &b, 1, &r);
+		return r;
+	}
+	//r[c0] = R(a[c0], b[c0])
+	void pairs(unsigned long long const* a, unsigned long long const* b, unsigned long long num, double* r)
+	{
+		++batch;
+		//nodes used by this batch are never evicted during it
+		std::vector<unsigned long long> missing;
+		std::vector<unsigned long long> rest;
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			bool ca(slotOf[a[c0]] != cacheSize), cb(slotOf[b[c0]] != cacheSize);
+			if (ca)slotUse[slotOf[a[c0]]] = batch;
+			if (cb)slotUse[slotOf[b[c0]]] = batch;
+			if (ca && cb)r[c0] = fromCache(a[c0], b[c0]);
+			else
+			{
+				rest.push_back(c0);
+				if (!ca)missing.push_back(a[c0]);
+				if (!cb)missing.push_back(b[c0]);
+			}
+		}
+		if (!rest.size())return;
+		std::sort(missing.begin(), missing.end());
+		missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+		//one solve per node if that is cheaper than one per pair and the cache can hold them
+		unsigned long long freeSlots(0);
+		for (unsigned long long c0(0); c0 < cacheSize; ++c0)freeSlots += slotUse[c0] != batch;
+		if (missing.size() <= rest.size() && missing.size() <= freeSlots)
+		{
+			std::vector<unsigned long long> slots(missing.size());
+			for (unsigned long long c0(0); c0 < missing.size(); ++c0)
+			{
+				while (slotUse[cacheNext] == batch)cacheNext = (cacheNext + 1) % cacheSize;
+				unsigned long long s(cacheNext);
+				cacheNext = (cacheNext + 1) % cacheSize;
+				if (nodeOf[s] != n)slotOf[nodeOf[s]] = cacheSize;
+				nodeOf[s] = missing[c0];
+				slotOf[missing[c0]] = s;
+				slotUse[s] = batch;
+				slots[c0] = s;
+			}
+			potentials(missing.data(), nullptr, missing.size(), [&](unsigned long long c0, double const* x)
+				{
+					double*& col(cache[slots[c0]]);
+					if (!col)col = malloc64d(n);
+					memcpy64d(col, x, n);
+				});
+			for (unsigned long long c0 : rest)r[c0] = fromCache(a[c0], b[c0]);
+		}
+		else
+		{
+			std::vector<unsigned long long> ra(rest.size()), rb(rest.size());
+			for (unsigned long long c0(0); c0 < rest.size(); ++c0)
+			{
+				ra[c0] = a[rest[c0]];
+				rb[c0] = b[rest[c0]];
+			}
+			potentials(ra.data(), rb.data(), rest.size(), [&](unsigned long long c0, double const* x)
+				{
+					r[rest[c0]] = x[ra[c0]] - x[rb[c0]];
+				});
+		}
+	}
+	vec& pairs(unsigned long long const* a, unsigned long long const* b, vec& r)
+	{
+		pairs(a, b, r.dim, r.data + r.beginning);
+		return r;
+	}
+	//Johnson-Lindenstrauss sketch with k rows: R(i, j) ~ |Z (e_i - e_j)|^2, Z = Q G^1/2 B L^+
+	void buildSketch(unsigned long long k, std::mt19937& mt)
+	{
+		sketchSize = k;
+		sketch.reconstruct(k, n, false);
+		std::vector<unsigned long long> seeds(k);
+		for (unsigned long long c0(0); c0 < k; ++c0)seeds[c0] = mt();
+		double s(1 / ::sqrt(double(k)));
+		//all k right hand sides in the grounded numbering, solved together
+		mat xg(k, n - 1);
+		for (unsigned long long c0(0); c0 < k; ++c0)
+		{
+			std::mt19937 m(seeds[c0]);
+			for (unsigned long long c1(0); c1 < edgeNum; ++c1)
+			{
+				double q((m() & 1) ? s : -s);
+				q *= ::sqrt(edgeG[c1]);
+				if (edgeA[c1] != ground)xg.data[(edgeA[c1] - (edgeA[c1] > ground)) * xg.width4d + c0] += q;
+				if (edgeB[c1] != ground)xg.data[(edgeB[c1] - (edgeB[c1] > ground)) * xg.width4d + c0] -= q;
+			}
+		}
+		chol.solve(xg, xg);
+		for (unsigned long long c0(0); c0 < n; ++c0)
+		{
+			double* z(sketch.data + c0 * sketch.width4d);
+			if (c0 == ground)memset64d(z, 0, k);
+			else memcpy64d(z, xg.data + (c0 - (c0 > ground)) * xg.width4d, k);
+		}
+	}
+	//k ~ 24 ln(n) / eps^2 for relative error eps with high probability
+	double approx(unsigned long long a, unsigned long long b)const
+	{
+		double const* za(sketch.data + a * sketch.width4d);
+		double const* zb(sketch.data + b * sketch.width4d);
+		double s(0);
+		for (unsigned long long c0(0); c0 < sketchSize; ++c0)
+			s += (za[c0] - zb[c0]) * (za[c0] - zb[c0]);
+		return s;
+	}
+	void approxPairs(unsigned long long const* a, unsigned long long const* b, unsigned long long num, double* r)const
+	{
+		parallelFor((num + 1023) / 1024, [&](unsigned long long c0, unsigned long long)
+			{
+				unsigned long long end(c0 * 1024 + 1024 < num ? c0 * 1024 + 1024 : num);
+				for (unsigned long long c1(c0 * 1024); c1 < end; ++c1)r[c1] = approx(a[c1], b[c1]);
+			});
+	}
+
+	//x: currents of all nodes (the ground entry is ignored) -> potentials, ground at 0
+	void potential(double* x)const
+	{
+		vec xg(n - 1, false);
+		for (unsigned long long c0(0); c0 < n; ++c0)
+			if (c0 != ground)xg.data[c0 - (c0 > ground)] = x[c0];
+		chol.solve(xg, xg);
+		for (unsigned long long c0(0); c0 < n; ++c0)
+			x[c0] = c0 == ground ? 0 : xg.data[c0 - (c0 > ground)];
+	}
+	//potentials for unit currents into a[c0] and out of b[c0] (b == nullptr: out of the ground)
+	//up to 64 right hand sides share one blocked substitution, f(c0, x) gets the potentials x of all nodes
+	template<class F>void potentials(unsigned long long const* a, unsigned long long const* b, unsigned long long num, F&& f)const
+	{
+		constexpr unsigned long long block(64);
+		double* x(malloc64d(n));
+		for (unsigned long long c0(0); c0 < num; c0 += block)
+		{
+			unsigned long long k(c0 + block < num ? block : num - c0);
+			mat xg(k, n - 1);
+			for (unsigned long long c1(0); c1 < k; ++c1)
+			{
+				unsigned long long p(a[c0 + c1]);
+				if (p != ground)xg.data[(p - (p > ground)) * xg.width4d + c1] += 1;
+				if (!b)continue;
+				p = b[c0 + c1];
+				if (p != ground)xg.data[(p - (p > ground)) * xg.width4d + c1] -= 1;
+			}
+			chol.solve(xg, xg);
+			for (unsigned long long c1(0); c1 < k; ++c1)
+			{
+				for (unsigned long long c2(0); c2 < n; ++c2)
+					x[c2] = c2 == ground ? 0 : xg.data[(c2 - (c2 > ground)) * xg.width4d + c1];
+				f(c0 + c1, x);
+			}
+		}
+		_mm_free(x);
+	}
+
+private:
+	double fromCache(unsigned long long a, unsigned long long b)const
+	{
+		double const* xa(cache[slotOf[a]]);
+		double const* xb(cache[slotOf[b]]);
+		return xa[a] + xb[b] - 2 * xa[b];
+	}
+};
 
 
 int main()
@@ -1019,6 +1988,7 @@ int main()
 	sq16_1.solveConjugateGradientSparse(eps);
 	SquareGrid<64>sq64_1(64, 64);
 	sq64_1.solveCholesky();
+	sq64_1.solveCholeskySparse();
 	sq64_1.solveConjugateGradientSparse(eps);
 	//SquareGrid<256>sq256_1(256, 256);
 	//sq256_1.solveCholesky();
@@ -1040,7 +2010,53 @@ int main()
 	sq16_2.solveConjugateGradientSparse(eps);
 	SquareGrid<64>sq64_2(0, 64);
 	sq64_2.solveCholesky();
+	sq64_2.solveCholeskySparse();
 	sq64_2.solveConjugateGradientSparse(eps);
+	{
+		//both clip settings and many more pairs from one factorisation
+		mat lap(MatType::SparseMat, 5 * SquareGrid<64>::dim * SquareGrid<64>::dim);
+		SquareGrid<64>::laplacian(lap);
+		Timer t;
+		t.begin();
+		ResistanceEngine engine(lap, SquareGrid<64>::dim * SquareGrid<64>::dim);
+		unsigned long long pa[2]{ 0, 0 };
+		unsigned long long pb[2]{ sq64_1.clipID, sq64_2.clipID };
+		double r[2];
+		engine.pairs(pa, pb, 2, r);
+		t.end();
+		::printf("%.15e\t%.15e\tResistanceEngine<64> both clips\t", r[0], r[1]);
+		t.print();
+		std::uniform_int_distribution<unsigned long long> rdNode(0, SquareGrid<64>::dim * SquareGrid<64>::dim - 1);
+		constexpr unsigned long long pairNum(1024);
+		unsigned long long* qa((unsigned long long*)::malloc(pairNum * sizeof(unsigned long long)));
+		unsigned long long* qb((unsigned long long*)::malloc(pairNum * sizeof(unsigned long long)));
+		vec exact(pairNum, false), approx(pairNum, false);
+		for (unsigned long long c0(0); c0 < pairNum; ++c0)
+		{
+			qa[c0] = rdNode(mt) % 32;
+			qb[c0] = rdNode(mt);
+		}
+		t.begin();
+		engine.pairs(qa, qb, exact);
+		t.end();
+		::printf("%llu random pairs (32 sources) exact\t", pairNum);
+		t.print();
+		t.begin();
+		engine.buildSketch(256, mt);
+		engine.approxPairs(qa, qb, pairNum, approx.data);
+		t.end();
+		double err(0);
+		for (unsigned long long c0(0); c0 < pairNum; ++c0)
+			if (qa[c0] != qb[c0])
+			{
+				double e(::fabs(approx.data[c0] / exact.data[c0] - 1));
+				if (e > err)err = e;
+			}
+		::printf("%llu random pairs sketch k = 256, max relative error %.3e\t", pairNum, err);
+		t.print();
+		::free(qa);
+		::free(qb);
+	}
 	//SquareGrid<256>sq256_2(0, 256);
 	//sq256_2.solveCholesky();
 	//sq256_2.solveConjugateGradientSparse(eps);
@@ -1079,6 +2095,7 @@ int main()
 	he16.solveConjugateGradientSparse(eps);
 	HexagonGrid<64>he64(63, 0);
 	he64.solveCholesky();
+	he64.solveCholeskyRCM();
 	he64.solveConjugateGradientSparse(eps);
 	//HexagonGrid<256>he256(255, 0);
 	//he256.solveCholesky();
@@ -1087,6 +2104,105 @@ int main()
 	//he1024.solveCholesky();
 	//he1024.solveConjugateGradientSparse(eps);
 
+	::printf("\n");
+
+	//lattices described at run time, no instantiation per size
+	{
+		unsigned long long size(64);
+		Lattice square(Lattice::Shape::Rectangle, size + 1, size + 1);
+		square.bond(0, 0, 1, 0, 1.0).bond(0, 0, 0, 1, 1.0).clip(size, size);
+		Lattice triangle(Lattice::Shape::Triangle, size + 1, 0);
+		triangle.bond(0, 0, 1, 0, 1.0).bond(0, 0, 1, 1, 1.0).bond(0, 0, 0, 1, 1.0).clip(size, 0);
+		//honeycomb as a brick wall: two sites per cell
+		Lattice honeycomb(Lattice::Shape::Rectangle, size + 1, size + 1, 2);
+		honeycomb.bond(0, 1, 0, 0, 1.0).bond(1, 0, 0, 1, 1.0).bond(1, 0, 1, 0, 1.0).clip(size, size, 1);
+		Lattice* lattices[3]{ &square, &triangle, &honeycomb };
+		char const* names[3]{ "Square", "Triangle", "Honeycomb" };
+		for (unsigned long long c0(0); c0 < 3; ++c0)
+		{
+			Timer t;
+			t.begin();
+			mat a;
+			lattices[c0]->sparse(a);
+			sparseCholesky chol(a, lattices[c0]->matDim);
+			vec x(lattices[c0]->matDim, true);
+			x.data[0] = 1;
+			chol.solve(x, x);
+			t.end();
+			::printf("%.15e\tLattice %s<%llu> CholeskySparse\t", x.data[0], names[c0], size);
+			t.print();
+		}
+	}
+
+	::printf("\n");
+
+	TriangleGridCplx<64>trCplxKrylov64(64, 0);
+	trCplxKrylov64.setGrid(0.5);
+	trCplxKrylov64.solveLDLT();
+	trCplxKrylov64.solveCholesky();
+	trCplxKrylov64.solveConjugateGradientSparseDagger(1e-12);
+	trCplxKrylov64.solveConjugateGradientCSR(1e-12);
+	trCplxKrylov64.solveCOCG(1e-12);
+	trCplxKrylov64.solveBiCGStab(1e-12);
+	//GMRES(50) stagnates here (58500 iterations), a basis of 1000 is full GMRES for this size
+	trCplxKrylov64.solveGMRES(1e-12, 1000);
+
+	::printf("\n");
+
+	//the same system as a real 2 x 2 embedding: SparseMat against matBSR<2> in the same CG
+	{
+		TriangleGridCplx2Real<64>trCplx2Real64(64, 0);
+		trCplx2Real64.setGrid(0.5);
+		trCplx2Real64.solveCholesky();
+		trCplx2Real64.solveConjugateGradientSparse(1e-12);
+		trCplx2Real64.solveConjugateGradientBSR(1e-12);
+		::printf("best block size %llu, fill %.3f, %llu bytes against %llu for the SparseMat\n",
+			blockSizeBSR(trCplx2Real64.matSparse, trCplx2Real64.matDim), trCplx2Real64.matBlock.fill(),
+			trCplx2Real64.matBlock.bytes(), trCplx2Real64.matSparse.elementNum * (sizeof(double) + 2 * sizeof(unsigned long long)));
+	}
+
+	::printf("\n");
+
+	//the 125 point sweep of TriangleGridCplx<64> from one factorisation at omega0 = 30
+	{
+		unsigned long long size(64), points(125);
+		Lattice lc(Lattice::Shape::Triangle, size + 1, 0);
+		lc.bond(0, 0, 1, 0, 1.0).bond(0, 0, 1, 1, cplx(0, 1), 1).bond(0, 0, 0, 1, cplx(0, -1), -1).clip(size, 0);
+		std::vector<double> omega(points);
+		for (unsigned long long c0(0); c0 < points; ++c0)omega[c0] = 1 / (0.001 + 0.001 * c0);
+		FrequencySweep sweep(lc, 30, 1e-12);
+		vecCplx b(lc.matDim, true);
+		b.re.data[0] = 1;
+		std::vector<vecCplx> x;
+		sweep.solve(b, omega, x);
+		for (unsigned long long c0(0); c0 < points; c0 += 31)
+			::printf("(%.15e, %.15e)\tLattice LC Triangle<%llu, omega=%.3e> MultiShift\n", x[c0].re.data[0], x[c0].im.data[0], size, omega[c0]);
+		::printf("%llu omegas, %llu iterations\t", points, sweep.solver.iters);
+		sweep.timer.print();
+	}
+
+	::printf("\n");
+
+	//the 125 point sweep of TriangleGridCplx<1, 4, 16, 64> on all cores, streamed to a table
+	{
+		LatticeSweep sweep([](unsigned long long size)
+			{
+				Lattice lc(Lattice::Shape::Triangle, size + 1, 0);
+				lc.bond(0, 0, 1, 0, 1.0).bond(0, 0, 1, 1, cplx(0, 1), 1).bond(0, 0, 0, 1, cplx(0, -1), -1);
+				return lc;
+			});
+		sweep.sizes = { 1, 4, 16, 64 };
+		sweep.clips = { { 1, 0, 0 } };
+		for (unsigned long long c0(0); c0 < 125; ++c0)sweep.omegas.push_back(1 / (0.001 + 0.001 * c0));
+		sweep.sources = { LatticeSweep::unitSource };
+		sweep.run("TriangleGridCplxSweep.txt");
+		for (unsigned long long c0(0); c0 < sweep.rows.size(); c0 += 125)
+			::printf("(%.15e, %.15e)\tLattice LC Triangle<%llu, omega=%.3e> Sweep\n",
+				sweep.rows[c0].z.re, sweep.rows[c0].z.im, sweep.rows[c0].size, sweep.rows[c0].omega);
+		::printf("%llu solves on %llu threads\t", sweep.taskNum(), threadNum());
+		sweep.timer.print();
+	}
+
 	timer.end();
 	timer.print("Total time:");
 
@@ -1114,19 +2230,19 @@ int main()
 	//	trCplx4.setGrid(omega[c0]);
 	//	trCplx16.setGrid(omega[c0]);
 	//	trCplx64.setGrid(omega[c0]);
-	//	trCplx1.solveCholesky();
-	//	trCplx4.solveCholesky();
-	//	trCplx16.solveCholesky();
-	//	trCplx64.solveCholesky();
+	//	trCplx1.solveLDLT();
+	//	trCplx4.solveLDLT();
+	//	trCplx16.solveLDLT();
+	//	trCplx64.solveLDLT();
 	//	//trCplx2Real1.solveConjugateGradientSparse(eps);
-	//	ansCho1.re[c0] = trCplx1.rCholesky.re;
-	//	ansCho4.re[c0] = trCplx4.rCholesky.re;
-	//	ansCho16.re[c0] = trCplx16.rCholesky.re;
-	//	ansCho64.re[c0] = trCplx64.rCholesky.re;
-	//	ansCho1.im[c0] = trCplx1.rCholesky.im;
-	//	ansCho4.im[c0] = trCplx4.rCholesky.im;
-	//	ansCho16.im[c0] = trCplx16.rCholesky.im;
-	//	ansCho64.im[c0] = trCplx64.rCholesky.im;
+	//	ansCho1.re[c0] = trCplx1.rLDLT.re;
+	//	ansCho4.re[c0] = trCplx4.rLDLT.re;
+	//	ansCho16.re[c0] = trCplx16.rLDLT.re;
+	//	ansCho64.re[c0] = trCplx64.rLDLT.re;
+	//	ansCho1.im[c0] = trCplx1.rLDLT.im;
+	//	ansCho4.im[c0] = trCplx4.rLDLT.im;
+	//	ansCho16.im[c0] = trCplx16.rLDLT.im;
+	//	ansCho64.im[c0] = trCplx64.rLDLT.im;
 	//}
 
 	//trCplx2Real1.setGrid(0.5);
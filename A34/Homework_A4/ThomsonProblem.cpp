@@ -3,6 +3,646 @@
 
 using namespace BLAS;
 
+//1 / sqrt(r2), 12 bits from rsqrtps, two Newton steps leave a relative error below 1e-13
+inline __m256d rsqrt4(__m256d r2)
+{
+	__m256d r(_mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r2))));
+	__m256d h(_mm256_mul_pd(r2, _mm256_set1_pd(0.5)));
+	__m256d c(_mm256_set1_pd(1.5));
+	r = _mm256_mul_pd(r, _mm256_fnmadd_pd(h, _mm256_mul_pd(r, r), c));
+	r = _mm256_mul_pd(r, _mm256_fnmadd_pd(h, _mm256_mul_pd(r, r), c));
+	return r;
+}
+inline double sum4(__m256d a)
+{
+	__m128d s(_mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1)));
+	return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+//the pairs j < i of num points cut into tile x tile squares (triangles on the diagonal),
+//the tiles in row order are split into chunkNum runs of about equal work; chunkNum does not depend on the thread count,
+//so sums kept per chunk and added in chunk order give the same bits whatever the number of threads
+struct PairSchedule
+{
+	static constexpr unsigned long long tile = 128;
+	static constexpr unsigned long long maxChunks = 128;
+	unsigned long long num;
+	unsigned long long tileNum;
+	unsigned long long chunkNum;
+	std::vector<unsigned long long> tileI;
+	std::vector<unsigned long long> tileJ;
+	std::vector<unsigned long long> chunkBegin;//chunkNum + 1, into tileI and tileJ
+
+	PairSchedule(unsigned long long _num)
+		:
+		num(_num),
+		tileNum((_num + tile - 1) / tile),
+		chunkNum(0)
+	{
+		for (unsigned long long c0(0); c0 < tileNum; ++c0)
+			for (unsigned long long c1(0); c1 <= c0; ++c1)
+			{
+				tileI.push_back(c0);
+				tileJ.push_back(c1);
+			}
+		unsigned long long n(tileI.size());
+		chunkNum = n < maxChunks ? n : maxChunks;
+		if (!chunkNum)chunkNum = 1;
+		std::vector<double> work(n);
+		double total(0);
+		for (unsigned long long c0(0); c0 < n; ++c0)
+		{
+			unsigned long long i0, i1, j0, j1;
+			range(c0, i0, i1, j0, j1);
+			double ni(double(i1 - i0));
+			work[c0] = i0 == j0 ? ni * (ni - 1) / 2 : ni * double(j1 - j0);
+			total += work[c0];
+		}
+		chunkBegin.assign(chunkNum + 1, n);
+		chunkBegin[0] = 0;
+		double done(0);
+		unsigned long long chunk(0);
+		for (unsigned long long c0(0); c0 < n; ++c0)
+		{
+			//a tile goes to the chunk its middle falls in
+			unsigned long long c1(total > 0 ? (unsigned long long)((done + work[c0] / 2) * chunkNum / total) : 0);
+			if (c1 >= chunkNum)c1 = chunkNum - 1;
+			while (chunk < c1)chunkBegin[++chunk] = c0;
+			done += work[c0];
+		}
+	}
+	//points [i0, i1) against [j0, j1), only j < i when i0 == j0
+	void range(unsigned long long t, unsigned long long& i0, unsigned long long& i1, unsigned long long& j0, unsigned long long& j1)const
+	{
+		i0 = tileI[t] * tile;
+		i1 = i0 + tile < num ? i0 + tile : num;
+		j0 = tileJ[t] * tile;
+		j1 = j0 + tile < num ? j0 + tile : num;
+	}
+};
+
+//Barnes-Hut octree for the potential and field of unit charges, O(N log N):
+//a node far enough away (box side < theta * distance, target outside the box) is replaced by
+//its charge and traceless quadrupole about its centre of charge (the dipole term vanishes there),
+//leaves and near nodes are summed directly, 4 at a time over coordinates copied in tree order,
+//every target walks the tree alone, so threads never share output
+struct SphereTree
+{
+	struct Node
+	{
+		double cx, cy, cz;//centre of charge
+		double qxx, qyy, qzz, qxy, qxz, qyz;//sum of 3 d d^T - |d|^2 I, d = r_j - c
+		double bx, by, bz, half;//box
+		unsigned long long begin, end;//points order[begin, end)
+		unsigned long long child;//first child, 0 for a leaf
+		unsigned long long childNum;
+	};
+	static constexpr unsigned long long leafSize = 64;
+	static constexpr unsigned long long maxDepth = 32;
+	std::vector<Node> nodes;
+	std::vector<unsigned long long> order;
+	std::vector<unsigned long long> scratch;
+	vec xs, ys, zs;//points in tree order, 4 spare at the end
+
+	SphereTree() :nodes(), order(), scratch(), xs(), ys(), zs() {}
+	//psi = sum over pairs of 1 / r, g = d psi / d r_i when gx is not null
+	double evaluate(double const* x, double const* y, double const* z, unsigned long long num, double theta,
+		double* gx, double* gy, double* gz, unsigned long long threads = 0)
+	{
+		build(x, y, z, num);
+		constexpr unsigned long long block = 64;
+		std::vector<double> phi(num, 0);
+		double theta2(theta * theta);
+		__m256d lane(_mm256_set_pd(3, 2, 1, 0));
+		parallelFor((num + block - 1) / block, [&](unsigned long long b, unsigned long long)
+			{
+				std::vector<unsigned long long> stack;
+				unsigned long long c1(b * block + block < num ? b * block + block : num);
+				for (unsigned long long c0(b * block); c0 < c1; ++c0)
+				{
+					double xi(x[c0]), yi(y[c0]), zi(z[c0]);
+					double p(0), fx(0), fy(0), fz(0);
+					stack.assign(1, 0);
+					while (stack.size())
+					{
+						Node const& nd(nodes[stack.back()]);
+						stack.pop_back();
+						double dx(xi - nd.cx), dy(yi - nd.cy), dz(zi - nd.cz);
+						double r2(dx * dx + dy * dy + dz * dz);
+						bool outside(abs(xi - nd.bx) > nd.half || abs(yi - nd.by) > nd.half || abs(zi - nd.bz) > nd.half);
+						if (outside && 4 * nd.half * nd.half < theta2 * r2)
+						{
+							double ir2(1 / r2), ir(sqrt(ir2)), ir3(ir * ir2), ir5(ir3 * ir2);
+							double m(double(nd.end - nd.begin));
+							double qx(nd.qxx * dx + nd.qxy * dy + nd.qxz * dz);
+							double qy(nd.qxy * dx + nd.qyy * dy + nd.qyz * dz);
+							double qz(nd.qxz * dx + nd.qyz * dy + nd.qzz * dz);
+							double rqr(dx * qx + dy * qy + dz * qz);
+							p += m * ir + 0.5 * rqr * ir5;
+							double s(m * ir3 + 2.5 * rqr * ir5 * ir2);
+							fx += qx * ir5 - s * dx;
+							fy += qy * ir5 - s * dy;
+							fz += qz * ir5 - s * dz;
+						}
+						else if (!nd.child)
+						{
+							__m256d p4(_mm256_setzero_pd()), fx4(_mm256_setzero_pd()), fy4(_mm256_setzero_pd()), fz4(_mm256_setzero_pd());
+							for (unsigned long long c2(nd.begin); c2 < nd.end; c2 += 4)
+							{
+								__m256d ex(_mm256_sub_pd(_mm256_set1_pd(xi), _mm256_loadu_pd(xs.data + c2)));
+								__m256d ey(_mm256_sub_pd(_mm256_set1_pd(yi), _mm256_loadu_pd(ys.data + c2)));
+								__m256d ez(_mm256_sub_pd(_mm256_set1_pd(zi), _mm256_loadu_pd(zs.data + c2)));
+								__m256d r2(_mm256_fmadd_pd(ez, ez, _mm256_fmadd_pd(ey, ey, _mm256_mul_pd(ex, ex))));
+								//the target itself (r2 = 0) and lanes past the leaf drop out
+								__m256d valid(_mm256_and_pd(_mm256_cmp_pd(r2, _mm256_setzero_pd(), _CMP_GT_OQ),
+									_mm256_cmp_pd(lane, _mm256_set1_pd(double(nd.end - c2)), _CMP_LT_OQ)));
+								__m256d ir(_mm256_and_pd(valid, rsqrt4(_mm256_blendv_pd(_mm256_set1_pd(1), r2, valid))));
+								__m256d ir3(_mm256_mul_pd(ir, _mm256_mul_pd(ir, ir)));
+								p4 = _mm256_add_pd(p4, ir);
+								fx4 = _mm256_fnmadd_pd(ex, ir3, fx4);
+								fy4 = _mm256_fnmadd_pd(ey, ir3, fy4);
+								fz4 = _mm256_fnmadd_pd(ez, ir3, fz4);
+							}
+							p += sum4(p4);
+							fx += sum4(fx4);
+							fy += sum4(fy4);
+							fz += sum4(fz4);
+						}
+						else for (unsigned long long c2(0); c2 < nd.childNum; ++c2)stack.push_back(nd.child + c2);
+					}
+					phi[c0] = p;
+					if (gx)
+					{
+						gx[c0] = fx;
+						gy[c0] = fy;
+						gz[c0] = fz;
+					}
+				}
+			}, threads);
+		double e(0);
+		for (unsigned long long c0(0); c0 < num; ++c0)e += phi[c0];
+		return e / 2;
+	}
+
+private:
+	void build(double const* x, double const* y, double const* z, unsigned long long num)
+	{
+		nodes.clear();
+		order.resize(num);
+		scratch.resize(num);
+		for (unsigned long long c0(0); c0 < num; ++c0)order[c0] = c0;
+		Node root{};
+		root.half = 1;
+		root.end = num;
+		nodes.push_back(root);
+		split(x, y, z, 0, 0);
+		if (xs.dim < num + 4)
+		{
+			xs.reconstruct(num + 4, true);
+			ys.reconstruct(num + 4, true);
+			zs.reconstruct(num + 4, true);
+		}
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			xs[c0] = x[order[c0]];
+			ys[c0] = y[order[c0]];
+			zs[c0] = z[order[c0]];
+		}
+	}
+	void split(double const* x, double const* y, double const* z, unsigned long long k, unsigned long long depth)
+	{
+		//moments
+		{
+			Node& nd(nodes[k]);
+			double m(double(nd.end - nd.begin)), cx(0), cy(0), cz(0);
+			for (unsigned long long c0(nd.begin); c0 < nd.end; ++c0)
+			{
+				cx += x[order[c0]];
+				cy += y[order[c0]];
+				cz += z[order[c0]];
+			}
+			nd.cx = cx /= m;
+			nd.cy = cy /= m;
+			nd.cz = cz /= m;
+			double xx(0), yy(0), zz(0), xy(0), xz(0), yz(0);
+			for (unsigned long long c0(nd.begin); c0 < nd.end; ++c0)
+			{
+				double dx(x[order[c0]] - cx), dy(y[order[c0]] - cy), dz(z[order[c0]] - cz);
+				double d2(dx * dx + dy * dy + dz * dz);
+				xx += 3 * dx * dx - d2;
+				yy += 3 * dy * dy - d2;
+				zz += 3 * dz * dz - d2;
+				xy += 3 * dx * dy;
+				xz += 3 * dx * dz;
+				yz += 3 * dy * dz;
+			}
+			nd.qxx = xx; nd.qyy = yy; nd.qzz = zz;
+			nd.qxy = xy; nd.qxz = xz; nd.qyz = yz;
+			if (nd.end - nd.begin <= leafSize || depth >= maxDepth)return;
+		}
+		//octants by counting sort
+		Node nd(nodes[k]);
+		unsigned long long cnt[9]{};
+		auto octant = [&](unsigned long long j)
+		{
+			return (x[j] >= nd.bx ? 1llu : 0llu) | (y[j] >= nd.by ? 2llu : 0llu) | (z[j] >= nd.bz ? 4llu : 0llu);
+		};
+		for (unsigned long long c0(nd.begin); c0 < nd.end; ++c0)cnt[octant(order[c0]) + 1]++;
+		for (unsigned long long c0(0); c0 < 8; ++c0)cnt[c0 + 1] += cnt[c0];
+		unsigned long long pos[8];
+		for (unsigned long long c0(0); c0 < 8; ++c0)pos[c0] = nd.begin + cnt[c0];
+		for (unsigned long long c0(nd.begin); c0 < nd.end; ++c0)scratch[pos[octant(order[c0])]++] = order[c0];
+		::memcpy(order.data() + nd.begin, scratch.data() + nd.begin, (nd.end - nd.begin) * sizeof(unsigned long long));
+		unsigned long long first(nodes.size()), num(0);
+		double h(nd.half / 2);
+		for (unsigned long long c0(0); c0 < 8; ++c0)
+		{
+			if (cnt[c0 + 1] == cnt[c0])continue;
+			Node ch{};
+			ch.bx = nd.bx + (c0 & 1 ? h : -h);
+			ch.by = nd.by + (c0 & 2 ? h : -h);
+			ch.bz = nd.bz + (c0 & 4 ? h : -h);
+			ch.half = h;
+			ch.begin = nd.begin + cnt[c0];
+			ch.end = nd.begin + cnt[c0 + 1];
+			nodes.push_back(ch);
+			num++;
+		}
+		nodes[k].child = first;
+		nodes[k].childNum = num;
+		for (unsigned long long c0(0); c0 < num; ++c0)split(x, y, z, first + c0, depth + 1);
+	}
+};
+
+//energy and gradient of N unit charges in one pass over the pairs j < i:
+//unit vectors kept as x, y, z arrays, 4 pairs per AVX2 step, 1 / r from a float rsqrt and Newton steps,
+//the force on j is added to contiguous buffers, the Cartesian gradient is projected on d/dtheta, d/dphi at the end
+//chunks of PairSchedule run on all cores, each into its own rows of acc, then reduced in chunk order
+//theta > 0 swaps the pair sum for SphereTree with that opening angle (relative error about 2e-6 at 0.3 up to 1e-4 at 0.7)
+struct ThomsonKernel
+{
+	unsigned long long num;
+	unsigned long long threads;//0: threadNum()
+	double theta;
+	PairSchedule tiles;
+	SphereTree tree;
+	vec x, y, z;
+	vec gx, gy, gz;
+	vec sinTheta, cosTheta, sinPhi, cosPhi;
+	mat acc;//rows 3 k, 3 k + 1, 3 k + 2: gx, gy, gz of chunk k
+	vec energies;
+	vec tx, ty, tz, px, py;//tangent basis of every charge: e_theta = (tx, ty, tz), e_phi = (px, py, 0)
+	vec shift;//-(r, dpsi / dr), added by the constraint |r| = 1 to both diagonal entries of a charge
+	vec ux, uy, uz;//Cartesian displacement of a Hessian product
+	vec hx, hy, hz;//chunk sums of the Hessian passes
+
+	ThomsonKernel(unsigned long long _num)
+		:
+		num(_num),
+		threads(0),
+		theta(0),
+		tiles(_num),
+		tree(),
+		x(_num, true), y(_num, true), z(_num, true),
+		gx(_num, true), gy(_num, true), gz(_num, true),
+		sinTheta(_num, false), cosTheta(_num, false), sinPhi(_num, false), cosPhi(_num, false),
+		acc(_num, 3 * tiles.chunkNum, false),
+		energies(tiles.chunkNum, false),
+		tx(_num, true), ty(_num, true), tz(_num, true), px(_num, true), py(_num, true),
+		shift(_num, true),
+		ux(_num, true), uy(_num, true), uz(_num, true),
+		hx(_num, true), hy(_num, true), hz(_num, true)
+	{
+	}
+	//p: (theta, phi) of every charge
+	void load(vec const& p)
+	{
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			sinTheta[c0] = sin(p.data[2 * c0]);
+			cosTheta[c0] = cos(p.data[2 * c0]);
+			sinPhi[c0] = sin(p.data[2 * c0 + 1]);
+			cosPhi[c0] = cos(p.data[2 * c0 + 1]);
+			x[c0] = sinTheta[c0] * cosPhi[c0];
+			y[c0] = sinTheta[c0] * sinPhi[c0];
+			z[c0] = cosTheta[c0];
+		}
+		//the last block reads past num
+		for (unsigned long long c0(num); c0 < ceiling4(num); ++c0)
+			x.data[c0] = y.data[c0] = z.data[c0] = 0;
+	}
+	double energy(vec const& p)
+	{
+		load(p);
+		if (theta > 0)return tree.evaluate(x.data, y.data, z.data, num, theta, nullptr, nullptr, nullptr, threads);
+		return pairs<false>();
+	}
+	//g: d psi / d(theta, phi)
+	double energyGradient(vec const& p, vec& g)
+	{
+		load(p);
+		double e(theta > 0 ? tree.evaluate(x.data, y.data, z.data, num, theta, gx.data, gy.data, gz.data, threads) : pairs<true>());
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			double gr(gx[c0] * cosPhi[c0] + gy[c0] * sinPhi[c0]);
+			g.data[2 * c0] = gr * cosTheta[c0] - gz[c0] * sinTheta[c0];
+			g.data[2 * c0 + 1] = (gy[c0] * cosPhi[c0] - gx[c0] * sinPhi[c0]) * sinTheta[c0];
+		}
+		return e;
+	}
+	//Hessian on the sphere in the orthonormal tangent basis T_i = (e_theta, e_phi) of every charge, 2 num x 2 num:
+	//H_ij = -T_i^T A_ij T_j (i != j), H_ii = sum_j T_i^T A_ij T_i + shift_i I, A_ij = 3 d d^T / r^5 - I / r^3, d = r_i - r_j;
+	//at a minimum this is the (theta, phi) Hessian with the phi rows and columns divided by sin theta
+	void hessianLoad(vec const& p)
+	{
+		load(p);
+		pairs<true>();
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			tx[c0] = cosTheta[c0] * cosPhi[c0];
+			ty[c0] = cosTheta[c0] * sinPhi[c0];
+			tz[c0] = -sinTheta[c0];
+			px[c0] = -sinPhi[c0];
+			py[c0] = cosPhi[c0];
+			shift[c0] = -(x[c0] * gx[c0] + y[c0] * gy[c0] + z[c0] * gz[c0]);
+		}
+	}
+	//after hessianLoad: lower triangle packed by rows, (r, c) with c <= r at r (r + 1) / 2 + c,
+	//every pair writes its own 2 x 2 block, the diagonal blocks are summed per chunk
+	void hessian(double* h)
+	{
+		parallelFor(tiles.chunkNum, [&](unsigned long long k, unsigned long long)
+			{
+				double* dtt(acc.data + 3 * k * acc.width4d);
+				double* dtp(dtt + acc.width4d);
+				double* dpp(dtp + acc.width4d);
+				memset64d(dtt, 0, 3 * acc.width4d);
+				for (unsigned long long t(tiles.chunkBegin[k]); t < tiles.chunkBegin[k + 1]; ++t)
+				{
+					unsigned long long i0, i1, j0, j1;
+					tiles.range(t, i0, i1, j0, j1);
+					hessianBlock(i0, i1, j0, j1, h, dtt, dtp, dpp);
+				}
+			}, threads);
+		reduce(hx.data, hy.data, hz.data);
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			double* h0(h + (2 * c0) * (2 * c0 + 1) / 2);
+			double* h1(h0 + 2 * c0 + 1);
+			h0[2 * c0] = hx[c0] + shift[c0];
+			h1[2 * c0] = hy[c0];
+			h1[2 * c0 + 1] = hz[c0] + shift[c0];
+		}
+	}
+	//after hessianLoad: hv = H v without storing H, O(num) memory and the cost of one gradient:
+	//(H v)_i = T_i^T sum_j A_ij (u_i - u_j) + shift_i v_i, u_i = T_i v_i
+	void hessianVector(vec const& v, vec& hv)
+	{
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			double vt(v.data[2 * c0]), vp(v.data[2 * c0 + 1]);
+			ux[c0] = vt * tx[c0] + vp * px[c0];
+			uy[c0] = vt * ty[c0] + vp * py[c0];
+			uz[c0] = vt * tz[c0];
+		}
+		parallelFor(tiles.chunkNum, [&](unsigned long long k, unsigned long long)
+			{
+				double* fx(acc.data + 3 * k * acc.width4d);
+				double* fy(fx + acc.width4d);
+				double* fz(fy + acc.width4d);
+				memset64d(fx, 0, 3 * acc.width4d);
+				for (unsigned long long t(tiles.chunkBegin[k]); t < tiles.chunkBegin[k + 1]; ++t)
+				{
+					unsigned long long i0, i1, j0, j1;
+					tiles.range(t, i0, i1, j0, j1);
+					hessianVectorBlock(i0, i1, j0, j1, fx, fy, fz);
+				}
+			}, threads);
+		reduce(hx.data, hy.data, hz.data);
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			hv.data[2 * c0] = tx[c0] * hx[c0] + ty[c0] * hy[c0] + tz[c0] * hz[c0] + shift[c0] * v.data[2 * c0];
+			hv.data[2 * c0 + 1] = px[c0] * hx[c0] + py[c0] * hy[c0] + shift[c0] * v.data[2 * c0 + 1];
+		}
+	}
+
+private:
+	//a0, a1, a2 = sum over chunks of acc rows 3 k, 3 k + 1, 3 k + 2:
+	//column blocks in parallel, chunks always added in the same order
+	void reduce(double* a0, double* a1, double* a2)
+	{
+		constexpr unsigned long long width = 1024;
+		parallelFor((num + width - 1) / width, [&](unsigned long long b, unsigned long long)
+			{
+				unsigned long long c0(b * width), c1(c0 + width < num ? c0 + width : num);
+				for (unsigned long long d(0); d < 3; ++d)
+				{
+					double* g(d == 0 ? a0 : d == 1 ? a1 : a2);
+					memcpy64d(g + c0, acc.data + d * acc.width4d + c0, c1 - c0);
+					for (unsigned long long k(1); k < tiles.chunkNum; ++k)
+					{
+						double const* a(acc.data + (3 * k + d) * acc.width4d);
+						for (unsigned long long c2(c0); c2 < c1; ++c2)g[c2] += a[c2];
+					}
+				}
+			}, threads);
+	}
+	template<bool grad>double pairs()
+	{
+		parallelFor(tiles.chunkNum, [&](unsigned long long k, unsigned long long)
+			{
+				double* fx(acc.data + 3 * k * acc.width4d);
+				double* fy(fx + acc.width4d);
+				double* fz(fy + acc.width4d);
+				if (grad)memset64d(fx, 0, 3 * acc.width4d);
+				double e(0);
+				for (unsigned long long t(tiles.chunkBegin[k]); t < tiles.chunkBegin[k + 1]; ++t)
+				{
+					unsigned long long i0, i1, j0, j1;
+					tiles.range(t, i0, i1, j0, j1);
+					e += block<grad>(i0, i1, j0, j1, fx, fy, fz);
+				}
+				energies[k] = e;
+			}, threads);
+		if (grad)reduce(gx.data, gy.data, gz.data);
+		double e(0);
+		for (unsigned long long k(0); k < tiles.chunkNum; ++k)e += energies[k];
+		return e;
+	}
+	//pairs of i in [i0, i1) and j in [j0, j1), j < i as well on a diagonal tile
+	template<bool grad>double block(unsigned long long i0, unsigned long long i1, unsigned long long j0, unsigned long long j1,
+		double* fx, double* fy, double* fz)const
+	{
+		__m256d e(_mm256_setzero_pd());
+		__m256d lane(_mm256_set_pd(3, 2, 1, 0));
+		for (unsigned long long c0(i0); c0 < i1; ++c0)
+		{
+			unsigned long long end(i0 == j0 ? c0 : j1);
+			__m256d xi(_mm256_set1_pd(x.data[c0])), yi(_mm256_set1_pd(y.data[c0])), zi(_mm256_set1_pd(z.data[c0]));
+			__m256d ax(_mm256_setzero_pd()), ay(_mm256_setzero_pd()), az(_mm256_setzero_pd());
+			for (unsigned long long c1(j0); c1 < end; c1 += 4)
+			{
+				__m256d dx(_mm256_sub_pd(xi, _mm256_load_pd(x.data + c1)));
+				__m256d dy(_mm256_sub_pd(yi, _mm256_load_pd(y.data + c1)));
+				__m256d dz(_mm256_sub_pd(zi, _mm256_load_pd(z.data + c1)));
+				__m256d r2(_mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx))));
+				__m256d inv;
+				if (c1 + 4 > end)
+				{
+					//lanes c1 + k >= end are not pairs
+					__m256d valid(_mm256_cmp_pd(lane, _mm256_set1_pd(double(end - c1)), _CMP_LT_OQ));
+					inv = _mm256_and_pd(valid, rsqrt4(_mm256_blendv_pd(_mm256_set1_pd(1), r2, valid)));
+				}
+				else inv = rsqrt4(r2);
+				e = _mm256_add_pd(e, inv);
+				if (grad)
+				{
+					__m256d inv3(_mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)));
+					dx = _mm256_mul_pd(dx, inv3);
+					dy = _mm256_mul_pd(dy, inv3);
+					dz = _mm256_mul_pd(dz, inv3);
+					ax = _mm256_add_pd(ax, dx);
+					ay = _mm256_add_pd(ay, dy);
+					az = _mm256_add_pd(az, dz);
+					_mm256_store_pd(fx + c1, _mm256_add_pd(_mm256_load_pd(fx + c1), dx));
+					_mm256_store_pd(fy + c1, _mm256_add_pd(_mm256_load_pd(fy + c1), dy));
+					_mm256_store_pd(fz + c1, _mm256_add_pd(_mm256_load_pd(fz + c1), dz));
+				}
+			}
+			if (grad)
+			{
+				fx[c0] -= sum4(ax);
+				fy[c0] -= sum4(ay);
+				fz[c0] -= sum4(az);
+			}
+		}
+		return sum4(e);
+	}
+	//1 / r of the 4 pairs (c0, c1 + l), lanes c1 + l >= end give 0
+	static __m256d inverse(__m256d r2, unsigned long long c1, unsigned long long end)
+	{
+		if (c1 + 4 <= end)return rsqrt4(r2);
+		__m256d valid(_mm256_cmp_pd(_mm256_set_pd(3, 2, 1, 0), _mm256_set1_pd(double(end - c1)), _CMP_LT_OQ));
+		return _mm256_and_pd(valid, rsqrt4(_mm256_blendv_pd(_mm256_set1_pd(1), r2, valid)));
+	}
+	//pairs of i in [i0, i1) and j in [j0, j1), j < i as well on a diagonal tile:
+	//H_ij into rows 2 i, 2 i + 1 of the packed h, T^T A T of i and j summed into tt, tp, pp
+	void hessianBlock(unsigned long long i0, unsigned long long i1, unsigned long long j0, unsigned long long j1,
+		double* h, double* tt, double* tp, double* pp)const
+	{
+		__m256d three(_mm256_set1_pd(3));
+		for (unsigned long long c0(i0); c0 < i1; ++c0)
+		{
+			unsigned long long end(i0 == j0 ? c0 : j1);
+			double* h0(h + (2 * c0) * (2 * c0 + 1) / 2);
+			double* h1(h0 + 2 * c0 + 1);
+			__m256d xi(_mm256_set1_pd(x.data[c0])), yi(_mm256_set1_pd(y.data[c0])), zi(_mm256_set1_pd(z.data[c0]));
+			__m256d txi(_mm256_set1_pd(tx.data[c0])), tyi(_mm256_set1_pd(ty.data[c0])), tzi(_mm256_set1_pd(tz.data[c0]));
+			__m256d pxi(_mm256_set1_pd(px.data[c0])), pyi(_mm256_set1_pd(py.data[c0]));
+			__m256d att(_mm256_setzero_pd()), atp(_mm256_setzero_pd()), app(_mm256_setzero_pd());
+			for (unsigned long long c1(j0); c1 < end; c1 += 4)
+			{
+				__m256d dx(_mm256_sub_pd(xi, _mm256_load_pd(x.data + c1)));
+				__m256d dy(_mm256_sub_pd(yi, _mm256_load_pd(y.data + c1)));
+				__m256d dz(_mm256_sub_pd(zi, _mm256_load_pd(z.data + c1)));
+				__m256d inv(inverse(_mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx))), c1, end));
+				__m256d inv2(_mm256_mul_pd(inv, inv));
+				__m256d inv3(_mm256_mul_pd(inv, inv2));
+				__m256d s5(_mm256_mul_pd(three, _mm256_mul_pd(inv3, inv2)));
+				__m256d txj(_mm256_load_pd(tx.data + c1)), tyj(_mm256_load_pd(ty.data + c1)), tzj(_mm256_load_pd(tz.data + c1));
+				__m256d pxj(_mm256_load_pd(px.data + c1)), pyj(_mm256_load_pd(py.data + c1));
+				//a = T_i^T d, b = T_j^T d
+				__m256d at(_mm256_fmadd_pd(tzi, dz, _mm256_fmadd_pd(tyi, dy, _mm256_mul_pd(txi, dx))));
+				__m256d ap(_mm256_fmadd_pd(pyi, dy, _mm256_mul_pd(pxi, dx)));
+				__m256d bt(_mm256_fmadd_pd(tzj, dz, _mm256_fmadd_pd(tyj, dy, _mm256_mul_pd(txj, dx))));
+				__m256d bp(_mm256_fmadd_pd(pyj, dy, _mm256_mul_pd(pxj, dx)));
+				__m256d sat(_mm256_mul_pd(s5, at)), sap(_mm256_mul_pd(s5, ap));
+				__m256d sbt(_mm256_mul_pd(s5, bt)), sbp(_mm256_mul_pd(s5, bp));
+				//-T_i^T A T_j = T_i^T T_j / r^3 - 3 a b^T / r^5
+				__m256d htt(_mm256_fmsub_pd(inv3, _mm256_fmadd_pd(tzi, tzj, _mm256_fmadd_pd(tyi, tyj, _mm256_mul_pd(txi, txj))), _mm256_mul_pd(sat, bt)));
+				__m256d htp(_mm256_fmsub_pd(inv3, _mm256_fmadd_pd(tyi, pyj, _mm256_mul_pd(txi, pxj)), _mm256_mul_pd(sat, bp)));
+				__m256d hpt(_mm256_fmsub_pd(inv3, _mm256_fmadd_pd(pyi, tyj, _mm256_mul_pd(pxi, txj)), _mm256_mul_pd(sap, bt)));
+				__m256d hpp(_mm256_fmsub_pd(inv3, _mm256_fmadd_pd(pyi, pyj, _mm256_mul_pd(pxi, pxj)), _mm256_mul_pd(sap, bp)));
+				att = _mm256_add_pd(att, _mm256_fmsub_pd(sat, at, inv3));
+				atp = _mm256_fmadd_pd(sat, ap, atp);
+				app = _mm256_add_pd(app, _mm256_fmsub_pd(sap, ap, inv3));
+				_mm256_store_pd(tt + c1, _mm256_add_pd(_mm256_load_pd(tt + c1), _mm256_fmsub_pd(sbt, bt, inv3)));
+				_mm256_store_pd(tp + c1, _mm256_fmadd_pd(sbt, bp, _mm256_load_pd(tp + c1)));
+				_mm256_store_pd(pp + c1, _mm256_add_pd(_mm256_load_pd(pp + c1), _mm256_fmsub_pd(sbp, bp, inv3)));
+				//(theta, phi) of the 4 j interleaved along the rows
+				__m256d lo0(_mm256_unpacklo_pd(htt, htp)), hi0(_mm256_unpackhi_pd(htt, htp));
+				__m256d lo1(_mm256_unpacklo_pd(hpt, hpp)), hi1(_mm256_unpackhi_pd(hpt, hpp));
+				__m256d r00(_mm256_permute2f128_pd(lo0, hi0, 0x20)), r01(_mm256_permute2f128_pd(lo0, hi0, 0x31));
+				__m256d r10(_mm256_permute2f128_pd(lo1, hi1, 0x20)), r11(_mm256_permute2f128_pd(lo1, hi1, 0x31));
+				if (c1 + 4 <= end)
+				{
+					_mm256_storeu_pd(h0 + 2 * c1, r00);
+					_mm256_storeu_pd(h0 + 2 * c1 + 4, r01);
+					_mm256_storeu_pd(h1 + 2 * c1, r10);
+					_mm256_storeu_pd(h1 + 2 * c1 + 4, r11);
+				}
+				else
+				{
+					//the rest of the rows belongs to the diagonal block and the next row
+					alignas(32) double buffer[16];
+					_mm256_store_pd(buffer, r00);
+					_mm256_store_pd(buffer + 4, r01);
+					_mm256_store_pd(buffer + 8, r10);
+					_mm256_store_pd(buffer + 12, r11);
+					for (unsigned long long c2(0); c2 < 2 * (end - c1); ++c2)
+					{
+						h0[2 * c1 + c2] = buffer[c2];
+						h1[2 * c1 + c2] = buffer[8 + c2];
+					}
+				}
+			}
+			tt[c0] += sum4(att);
+			tp[c0] += sum4(atp);
+			pp[c0] += sum4(app);
+		}
+	}
+	//pairs as in hessianBlock: f = A (u_i - u_j) added to i and taken from j
+	void hessianVectorBlock(unsigned long long i0, unsigned long long i1, unsigned long long j0, unsigned long long j1,
+		double* fx, double* fy, double* fz)const
+	{
+		__m256d three(_mm256_set1_pd(3));
+		for (unsigned long long c0(i0); c0 < i1; ++c0)
+		{
+			unsigned long long end(i0 == j0 ? c0 : j1);
+			__m256d xi(_mm256_set1_pd(x.data[c0])), yi(_mm256_set1_pd(y.data[c0])), zi(_mm256_set1_pd(z.data[c0]));
+			__m256d uxi(_mm256_set1_pd(ux.data[c0])), uyi(_mm256_set1_pd(uy.data[c0])), uzi(_mm256_set1_pd(uz.data[c0]));
+			__m256d ax(_mm256_setzero_pd()), ay(_mm256_setzero_pd()), az(_mm256_setzero_pd());
+			for (unsigned long long c1(j0); c1 < end; c1 += 4)
+			{
+				__m256d dx(_mm256_sub_pd(xi, _mm256_load_pd(x.data + c1)));
+				__m256d dy(_mm256_sub_pd(yi, _mm256_load_pd(y.data + c1)));
+				__m256d dz(_mm256_sub_pd(zi, _mm256_load_pd(z.data + c1)));
+				__m256d inv(inverse(_mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx))), c1, end));
+				__m256d inv2(_mm256_mul_pd(inv, inv));
+				__m256d inv3(_mm256_mul_pd(inv, inv2));
+				__m256d wx(_mm256_sub_pd(uxi, _mm256_load_pd(ux.data + c1)));
+				__m256d wy(_mm256_sub_pd(uyi, _mm256_load_pd(uy.data + c1)));
+				__m256d wz(_mm256_sub_pd(uzi, _mm256_load_pd(uz.data + c1)));
+				//3 d (d, w) / r^5 - w / r^3
+				__m256d s(_mm256_mul_pd(_mm256_mul_pd(three, _mm256_mul_pd(inv3, inv2)),
+					_mm256_fmadd_pd(dz, wz, _mm256_fmadd_pd(dy, wy, _mm256_mul_pd(dx, wx)))));
+				__m256d fxj(_mm256_fmsub_pd(s, dx, _mm256_mul_pd(inv3, wx)));
+				__m256d fyj(_mm256_fmsub_pd(s, dy, _mm256_mul_pd(inv3, wy)));
+				__m256d fzj(_mm256_fmsub_pd(s, dz, _mm256_mul_pd(inv3, wz)));
+				ax = _mm256_add_pd(ax, fxj);
+				ay = _mm256_add_pd(ay, fyj);
+				az = _mm256_add_pd(az, fzj);
+				_mm256_store_pd(fx + c1, _mm256_sub_pd(_mm256_load_pd(fx + c1), fxj));
+				_mm256_store_pd(fy + c1, _mm256_sub_pd(_mm256_load_pd(fy + c1), fyj));
+				_mm256_store_pd(fz + c1, _mm256_sub_pd(_mm256_load_pd(fz + c1), fzj));
+			}
+			fx[c0] += sum4(ax);
+			fy[c0] += sum4(ay);
+			fz[c0] += sum4(az);
+		}
+	}
+};
+
 struct Thomson
 {
 	static constexpr double answers[101]
@@ -113,12 +753,14 @@ struct Thomson
 	vec pos;
 	vec g0;
 	double answer;
+	ThomsonKernel kernel;
 
 	Thomson(unsigned long long _num)
 		:
 		num(_num),
 		pos(_num * 2, false),
-		g0(_num * 2, false)
+		g0(_num * 2, false),
+		kernel(_num)
 	{
 	}
 	double rij(double theta0, double phi0, double theta1, double phi1)
@@ -138,15 +780,12 @@ struct Thomson
 	}
 	double psi(vec const& p)
 	{
-		double ss(0);
-		for (unsigned long long c0(1); c0 < num; ++c0)
-		{
-			double theta0(p.data[2 * c0]);
-			double phi0(p.data[2 * c0 + 1]);
-			for (unsigned long long c1(0); c1 < c0; ++c1)
-				ss += 1 / rij(theta0, phi0, pos[2 * c1], pos[2 * c1 + 1]);
-		}
-		return ss;
+		return kernel.energy(p);
+	}
+	//psi(p), and its gradient into g
+	double psiGradient(vec const& p, vec& g)
+	{
+		return kernel.energyGradient(p, g);
 	}
 	void initPos(std::uniform_real_distribution<double>& rd, std::mt19937& mt)
 	{
@@ -158,41 +797,7 @@ struct Thomson
 	}
 	void gradient(vec const& p, vec& g)
 	{
-		constexpr double h = 1e-5;
-		constexpr double rh = 1 / (2.0 * h);
-		g = 0;
-		//vec gg(2 * num, true);
-		for (unsigned long long c0(0); c0 < num; ++c0)
-		{
-			double theta0 = p.data[2 * c0];
-			double phi0 = p.data[2 * c0 + 1];
-			double gt0, gt1, gp(0);
-			//g[2 * c0] = rh * (psi(c0, theta0 + h, phi0) - psi(c0, theta0 - h, phi0));
-			//g[2 * c0 + 1] = rh * (psi(c0, theta0, phi0 + h) - psi(c0, theta0, phi0 - h));
-			for (unsigned long long c1(0); c1 < c0; ++c1)
-			{
-				double theta1 = p.data[2 * c1];
-				double phi1 = p.data[2 * c1 + 1];
-				double s0(sin(theta0)), s1(sin(theta1));
-				double st12(sin((theta0 - theta1) / 2));
-				double sp12(sin((phi0 - phi1) / 2));
-				sp12 *= sp12;
-				double ss0(s0 * sp12);
-				double ss1(s1 * sp12);
-				double rr(2 * sqrt(st12 * st12 + s0 * ss1));
-				double r3(rr * rr * rr);
-				double s01(sin(theta0 - theta1));
-				gt0 = (s01 + 2 * cos(theta0) * ss1) / r3;
-				gt1 = (-s01 + 2 * cos(theta1) * ss0) / r3;
-				gp = (s0 * s1 * sin(phi0 - phi1)) / r3;
-				g[2 * c0] -= gt0;
-				g[2 * c1] -= gt1;
-				g[2 * c0 + 1] -= gp;
-				g[2 * c1 + 1] += gp;
-			}
-		}
-		//gg -= g;
-		//::printf("gg: %.10e\n", gg.norm2());
+		kernel.energyGradient(p, g);
 	}
 	void naive()
 	{
@@ -239,9 +844,8 @@ struct Thomson
 			for (;;)
 			{
 				pos1.fmadd(beta, d, pos);
-				gradient(pos1, g1);
+				psi1 = psiGradient(pos1, g1);
 				dg1 = (d, g1);
-				psi1 = psi(pos1);
 				if (dg1 > 0)break;
 				beta *= 2;
 			}
@@ -374,12 +978,265 @@ struct Thomson
 		} while (abs(answer - answers[num]) > 1e-8);
 		return answer;
 	}
+	//L-BFGS from pos, eps for |g|; with ck, pos and the L-BFGS pairs go to disk every ck->period seconds and at the end
+	double minimizeLBFGS(double eps, unsigned long long history = 8, checkpointThread* ck = nullptr)
+	{
+		lbfgs opt(history, eps);
+		return minimizeLBFGS(opt, false, ck);
+	}
+	//goes on from a checkpoint of minimizeLBFGS, false if file has none for this num
+	bool resumeLBFGS(char const* file, double eps, unsigned long long history = 8, checkpointThread* ck = nullptr)
+	{
+		checkpointReader r;
+		if (!r.load(file) || !load(r))return false;
+		lbfgs opt(history, eps);
+		opt.load(r, pos.dim);
+		minimizeLBFGS(opt, true, ck);
+		return true;
+	}
+	void save(checkpointWriter& w)const
+	{
+		w.add("thomson.num", double(num));
+		w.add("thomson.answer", answer);
+		w.add("thomson.pos", pos);
+	}
+	bool load(checkpointReader const& r)
+	{
+		if (r.scalar("thomson.num") != double(num))return false;
+		answer = r.scalar("thomson.answer");
+		return r.get("thomson.pos", pos);
+	}
+	double runLBFGS(double eps, std::uniform_real_distribution<double>& rd, std::mt19937& mt)
+	{
+		do
+		{
+			initPos(rd, mt);
+			answer = minimizeLBFGS(eps);
+		} while (abs(answer - answers[num]) > 1e-8);
+		return answer;
+	}
+
+private:
+	double minimizeLBFGS(lbfgs& opt, bool resume, checkpointThread* ck)
+	{
+		auto fill([&](checkpointWriter& w)
+			{
+				save(w);
+				opt.save(w);
+			});
+		if (ck)opt.progress = [&](lbfgs const& o, vec const&)
+		{
+			answer = o.value;
+			ck->offer(fill);
+		};
+		answer = opt.minimize([this](vec const& p, vec& g) { return psiGradient(p, g); }, pos, resume);
+		if (ck)
+		{
+			ck->offer(fill, true);
+			ck->flush();
+		}
+		return answer;
+	}
+};
+
+//global minimum search over many N: independent walks (random start, then basin hopping: move every charge
+//by a Gaussian step, L-BFGS, Metropolis accept) spread over all cores, largest N first, dynamic scheduling;
+//walk w of N draws from its own mt19937 seeded with (seed, N, w), so what a walk finds does not depend on the thread count;
+//minima are merged by energy and a signature that is blind to rotations, reflections and relabelling
+//(the sorted potentials of the charges), no new hop of an N is tried once its tabulated answer is reached
+struct ThomsonSearch
+{
+	struct Minimum
+	{
+		double energy;
+		std::vector<double> signature;
+		vec pos;//of the first (walk, hop) that found it
+		unsigned long long walk;
+		unsigned long long hop;
+		unsigned long long hits;
+	};
+	struct Result
+	{
+		unsigned long long num;
+		std::vector<Minimum> minima;//ascending energy
+		unsigned long long walks;//walks that ran
+		unsigned long long locals;//L-BFGS runs
+		bool reached;
+		long long time;//ns, summed over walks
+	};
+
+	std::vector<unsigned long long> sizes;
+	unsigned long long walks;//per size
+	unsigned long long hops;//per walk
+	double step;//standard deviation of the move of every charge
+	double temperature;//Metropolis, in units of psi
+	double eps;//L-BFGS
+	double energyTol;//relative
+	double signatureTol;
+	unsigned long long seed;
+	unsigned long long threads;//0: threadNum()
+	bool verbose;//one line per size as soon as all its walks are done
+	std::vector<Result> results;
+	Timer timer;
+
+	ThomsonSearch()
+		:
+		sizes(),
+		walks(8),
+		hops(20),
+		step(0.1),
+		temperature(0.1),
+		eps(1e-10),
+		energyTol(1e-10),
+		signatureTol(1e-4),
+		seed(0),
+		threads(0),
+		verbose(true),
+		results(),
+		timer()
+	{
+	}
+	void run()
+	{
+		timer.begin();
+		unsigned long long n(sizes.size() * walks);
+		results.assign(sizes.size(), Result());
+		for (unsigned long long c0(0); c0 < sizes.size(); ++c0)
+		{
+			Result& r(results[c0]);
+			r.num = sizes[c0];
+			r.walks = r.locals = 0;
+			r.reached = false;
+			r.time = 0;
+		}
+		std::vector<std::atomic<bool>> flags(sizes.size());
+		stop.swap(flags);
+		for (unsigned long long c0(0); c0 < sizes.size(); ++c0)stop[c0] = false;
+		std::vector<unsigned long long> schedule(n);
+		for (unsigned long long c0(0); c0 < n; ++c0)schedule[c0] = c0;
+		std::stable_sort(schedule.begin(), schedule.end(), [&](unsigned long long a, unsigned long long b)
+			{
+				return sizes[a / walks] > sizes[b / walks];
+			});
+		parallelOrdered(n, [&](unsigned long long t, unsigned long long)
+			{
+				walk(t / walks, t % walks);
+			}, [&](unsigned long long t)
+			{
+				if (verbose && t % walks == walks - 1)print(results[t / walks]);
+			}, schedule.data(), threads);
+		timer.end();
+	}
+	static void print(Result const& r)
+	{
+		double best(r.minima.size() ? r.minima[0].energy : NAN);
+		::printf("%llu:\t%.11f\t", r.num, best);
+		if (r.num < 101)::printf("%.3e\t", best - Thomson::answers[r.num]);
+		::printf("minima %llu\twalks %llu\tlocal %llu\t%.3f s\n",
+			(unsigned long long)r.minima.size(), r.walks, r.locals, r.time * 1e-9);
+	}
+
+private:
+	std::vector<std::atomic<bool>> stop;//per size: answer reached
+	std::mutex lock;
+
+	void walk(unsigned long long s, unsigned long long w)
+	{
+		if (stop[s])return;
+		Timer tm;
+		tm.begin();
+		unsigned long long num(sizes[s]);
+		std::seed_seq sq{ seed, num, w };
+		std::mt19937 mt(sq);
+		std::uniform_real_distribution<double> rd(0, 1);
+		std::normal_distribution<double> nd(0, step);
+		Thomson tms(num);
+		tms.kernel.threads = 1;
+		tms.initPos(rd, mt);
+		double e(tms.minimizeLBFGS(eps));
+		unsigned long long locals(1);
+		record(s, tms, e, w, 0);
+		vec current(tms.pos);
+		double eCurrent(e);
+		for (unsigned long long c0(1); c0 <= hops && !stop[s]; ++c0)
+		{
+			for (unsigned long long c1(0); c1 < num; ++c1)
+			{
+				double st(sin(current[2 * c1]));
+				double x(st * cos(current[2 * c1 + 1]) + nd(mt));
+				double y(st * sin(current[2 * c1 + 1]) + nd(mt));
+				double z(cos(current[2 * c1]) + nd(mt));
+				tms.pos[2 * c1] = acos(z / ::sqrt(x * x + y * y + z * z));
+				tms.pos[2 * c1 + 1] = atan2(y, x);
+			}
+			e = tms.minimizeLBFGS(eps);
+			locals++;
+			record(s, tms, e, w, c0);
+			if (e < eCurrent || rd(mt) < exp((eCurrent - e) / temperature))
+			{
+				current = tms.pos;
+				eCurrent = e;
+			}
+		}
+		tm.end();
+		std::lock_guard<std::mutex> guard(lock);
+		Result& r(results[s]);
+		r.walks++;
+		r.locals += locals;
+		r.time += 1000000000ll * (tm.ending.tv_sec - tm.begining.tv_sec) + (tm.ending.tv_nsec - tm.begining.tv_nsec);
+	}
+	void record(unsigned long long s, Thomson& tms, double e, unsigned long long w, unsigned long long h)
+	{
+		unsigned long long num(tms.num);
+		//from the accepted L-BFGS iterate: the kernel holds whatever point the line search tried last
+		std::vector<double> x(num), y(num), z(num), sig(num, 0);
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			double st(sin(tms.pos[2 * c0]));
+			x[c0] = st * cos(tms.pos[2 * c0 + 1]);
+			y[c0] = st * sin(tms.pos[2 * c0 + 1]);
+			z[c0] = cos(tms.pos[2 * c0]);
+		}
+		for (unsigned long long c0(1); c0 < num; ++c0)
+			for (unsigned long long c1(0); c1 < c0; ++c1)
+			{
+				double dx(x[c0] - x[c1]), dy(y[c0] - y[c1]), dz(z[c0] - z[c1]);
+				double u(1 / ::sqrt(dx * dx + dy * dy + dz * dz));
+				sig[c0] += u;
+				sig[c1] += u;
+			}
+		std::sort(sig.begin(), sig.end());
+		bool reached(num < 101 && abs(e - Thomson::answers[num]) < 1e-8);
+		if (reached)stop[s] = true;
+		std::lock_guard<std::mutex> guard(lock);
+		Result& r(results[s]);
+		if (reached)r.reached = true;
+		for (Minimum& m : r.minima)
+		{
+			if (abs(m.energy - e) > energyTol * abs(e))continue;
+			double d(0);
+			for (unsigned long long c0(0); c0 < num; ++c0)
+				if (abs(m.signature[c0] - sig[c0]) > d)d = abs(m.signature[c0] - sig[c0]);
+			if (d > signatureTol)continue;
+			m.hits++;
+			if (w < m.walk || (w == m.walk && h < m.hop))
+			{
+				m.pos = tms.pos;
+				m.walk = w;
+				m.hop = h;
+			}
+			return;
+		}
+		Minimum m{ e, std::move(sig), tms.pos, w, h, 1 };
+		r.minima.insert(std::upper_bound(r.minima.begin(), r.minima.end(), e,
+			[](double a, Minimum const& b) { return a < b.energy; }), std::move(m));
+	}
 };
 
 struct Vibration
 {
 	Thomson tms;
-	mat U;
+	vec H;//packed lower triangle of the Hessian in the tangent basis, see ThomsonKernel::hessian
 	vec freqs;
 	vec fn;
 	vec fs2r;
@@ -388,142 +1245,61 @@ struct Vibration
 	Vibration(unsigned long long _num, std::uniform_real_distribution<double>& rd, std::mt19937& mt)
 		:
 		tms(_num),
-		U(2 * _num, 2 * _num, false),
+		H(),
 		freqs(2 * _num, false),
 		fn(2 * _num, true),
 		fs2r(2 * _num, true),
 		fs(0)
 	{
-		tms.run(1e-26, rd, mt);
-		getUmat(tms.pos, U);
-	}
-	void getUmat(vec const& p, mat& u)//check this...
-	{
-		//make sure that mat is in the right format: p.dim square mat
-		u.clear();
-		for (unsigned long long cy0(1); cy0 < tms.num; ++cy0)
-		{
-			double theta0 = p.data[2 * cy0];
-			double phi0 = p.data[2 * cy0 + 1];
-			double dg;
-			for (unsigned long long cy1(0); cy1 < cy0; ++cy1)
-			{
-				double theta1 = p.data[2 * cy1];
-				double phi1 = p.data[2 * cy1 + 1];
-				double t01(theta0 - theta1);
-				double p01(phi0 - phi1);
-				double s0(sin(theta0)), s1(sin(theta1));
-				double c0(cos(theta0)), c1(cos(theta1));
-				double s0s1(s0 * s1);
-				double st01(sin(t01)), ct01(cos(t01));
-				double sp01(sin(p01)), cp01(cos(p01));
-				double cp01m(1 - cp01);
-				double pt0(s1 * c0 * cp01m + st01);
-				double pt1(s0 * c1 * cp01m - st01);
-				double pp0(s0s1 * sp01);//pp1 = -pp0
-				double ptt00(ct01 - s0s1 * cp01m);//ptt11 = ptt00
-				double ptt01(c0 * c1 * cp01m - ct01);//ptt01 = ptt10
-				double ppp00(cp01 * s0s1);//ppp01 = -ppp00, ppp10 = -ppp00, ppp11 = ppp00
-				double ptp00(c0 * s1 * sp01);//ptp01 = -ptp00
-				double ptp10(c1 * s0 * sp01);//ptp11 = -ptp10
-				double r(2 * (1 - ptt00));
-				double rn52(pow(r, 2.5));
-
-				dg = (3 * pt0 * pt0 - r * ptt00) / rn52;
-				u(2 * cy0, 2 * cy0) += dg;
-
-				dg = (3 * pt1 * pt1 - r * ptt00) / rn52;
-				u(2 * cy1, 2 * cy1) += dg;
-
-				dg = (3 * pt0 * pt1 - r * ptt01) / rn52;
-				u(2 * cy0, 2 * cy1) += dg;
-				u(2 * cy1, 2 * cy0) += dg;
-
-				dg = (3 * pt0 * pp0 - r * ptp00) / rn52;
-				u(2 * cy0, 2 * cy0 + 1) += dg;
-				u(2 * cy0, 2 * cy1 + 1) -= dg;
-				u(2 * cy0 + 1, 2 * cy0) += dg;
-				u(2 * cy1 + 1, 2 * cy0) -= dg;
-
-				dg = (3 * pt1 * pp0 - r * ptp10) / rn52;
-				u(2 * cy1, 2 * cy0 + 1) += dg;
-				u(2 * cy1, 2 * cy1 + 1) -= dg;
-				u(2 * cy0 + 1, 2 * cy1) += dg;
-				u(2 * cy1 + 1, 2 * cy1) -= dg;
-
-				dg = (3 * pp0 * pp0 - r * ppp00) / rn52;
-				u(2 * cy0 + 1, 2 * cy0 + 1) += dg;
-				u(2 * cy0 + 1, 2 * cy1 + 1) -= dg;
-				u(2 * cy1 + 1, 2 * cy0 + 1) -= dg;
-				u(2 * cy1 + 1, 2 * cy1 + 1) += dg;
-			}
+		//the table of answers ends at 100, beyond that any local minimum will do
+		if (_num < 101)tms.runLBFGS(1e-12, rd, mt);
+		else
+		{
+			tms.initPos(rd, mt);
+			tms.minimizeLBFGS(1e-10);
 		}
-		/*for (unsigned long long cy0(1); cy0 < tms.num; ++cy0)
-		{
-			constexpr double h = 1e-5;
-			constexpr double rh = 1 / (h * h);
-			constexpr double r4h = 1 / (4 * h * h);
-			double theta0 = p.data[2 * cy0];
-			double phi0 = p.data[2 * cy0 + 1];
-			double theta0p(theta0 + h);
-			double theta0n(theta0 - h);
-			double phi0p(phi0 - h);
-			double phi0n(phi0 - h);
-			double dg;
-			for (unsigned long long cy1(0); cy1 < cy0; ++cy1)
-			{
-				double theta1 = p.data[2 * cy1];
-				double phi1 = p.data[2 * cy1 + 1];
-				double theta1p(theta1 + h);
-				double theta1n(theta1 - h);
-				double phi1p(phi1 - h);
-				double phi1n(phi1 - h);
-				double r0(1 / tms.rij(theta0, phi0, theta1, phi1));
-				double rr[4];
-				rr[0] = 1 / tms.rij(theta0p, phi0, theta1, phi1);
-				rr[1] = 1 / tms.rij(theta0n, phi0, theta1, phi1);
-				dg = rh * (rr[0] + rr[1] - 2 * r0);
-				tst(2 * cy0, 2 * cy0) += dg;
-				tst(2 * cy1, 2 * cy1) += dg;
-
-				rr[0] = 1 / tms.rij(theta0p, phi0, theta1p, phi1);
-				rr[1] = 1 / tms.rij(theta0n, phi0, theta1p, phi1);
-				rr[2] = 1 / tms.rij(theta0p, phi0, theta1n, phi1);
-				rr[3] = 1 / tms.rij(theta0n, phi0, theta1n, phi1);
-				dg = r4h * (rr[0] - rr[1] - rr[2] + rr[3]);
-				tst(2 * cy0, 2 * cy1) += dg;
-				tst(2 * cy1, 2 * cy0) += dg;
-
-				rr[0] = 1 / tms.rij(theta0p, phi0p, theta1, phi1);
-				rr[1] = 1 / tms.rij(theta0n, phi0p, theta1, phi1);
-				rr[2] = 1 / tms.rij(theta0p, phi0n, theta1, phi1);
-				rr[3] = 1 / tms.rij(theta0n, phi0n, theta1, phi1);
-				dg = r4h * (rr[0] - rr[1] - rr[2] + rr[3]);
-				tst(2 * cy0, 2 * cy0 + 1) += dg;
-				tst(2 * cy0, 2 * cy1 + 1) -= dg;
-				tst(2 * cy0 + 1, 2 * cy0) += dg;
-				tst(2 * cy1 + 1, 2 * cy0) -= dg;
-
-				rr[0] = 1 / tms.rij(theta0, phi0p, theta1p, phi1);
-				rr[1] = 1 / tms.rij(theta0, phi0n, theta1p, phi1);
-				rr[2] = 1 / tms.rij(theta0, phi0p, theta1n, phi1);
-				rr[3] = 1 / tms.rij(theta0, phi0n, theta1n, phi1);
-				dg = r4h * (rr[0] - rr[1] - rr[2] + rr[3]);
-				tst(2 * cy1, 2 * cy0 + 1) += dg;
-				tst(2 * cy1, 2 * cy1 + 1) -= dg;
-				tst(2 * cy0 + 1, 2 * cy1) += dg;
-				tst(2 * cy1 + 1, 2 * cy1) -= dg;
-
-				rr[0] = 1 / tms.rij(theta0, phi0p, theta1, phi1);
-				rr[1] = 1 / tms.rij(theta0, phi0n, theta1, phi1);
-				dg = rh * (rr[0] + rr[1] - 2 * r0);
-				tst(2 * cy0 + 1, 2 * cy0 + 1) += dg;
-				tst(2 * cy0 + 1, 2 * cy1 + 1) -= dg;
-				tst(2 * cy1 + 1, 2 * cy0 + 1) -= dg;
-				tst(2 * cy1 + 1, 2 * cy1 + 1) += dg;
-
+		tms.kernel.hessianLoad(tms.pos);
+	}
+	void getHessian()
+	{
+		unsigned long long n(2 * tms.num);
+		H.reconstruct(n * (n + 1) / 2, false);
+		tms.kernel.hessian(H.data);
+	}
+	//the rotations e x r_i of all charges leave psi unchanged: 3 zero modes, orthonormal rows
+	void rotations(mat& r)
+	{
+		ThomsonKernel& k(tms.kernel);
+		r.reconstruct(2 * tms.num, 3, false);
+		for (unsigned long long c0(0); c0 < 3; ++c0)
+		{
+			double* v(r.data + c0 * r.width4d);
+			for (unsigned long long c1(0); c1 < tms.num; ++c1)
+			{
+				double wx(c0 == 0 ? 0 : c0 == 1 ? k.z[c1] : -k.y[c1]);
+				double wy(c0 == 0 ? -k.z[c1] : c0 == 1 ? 0 : k.x[c1]);
+				double wz(c0 == 0 ? k.y[c1] : c0 == 1 ? -k.x[c1] : 0);
+				v[2 * c1] = k.tx[c1] * wx + k.ty[c1] * wy + k.tz[c1] * wz;
+				v[2 * c1 + 1] = k.px[c1] * wx + k.py[c1] * wy;
+			}
+			for (unsigned long long c1(0); c1 < c0; ++c1)
+			{
+				double const* u(r.data + c1 * r.width4d);
+				fmadd64d(v, -dot64d(v, u, r.width), u, r.width);
 			}
-		}*/
+			double s(1 / ::sqrt(dot64d(v, v, r.width)));
+			for (unsigned long long c1(0); c1 < r.width; ++c1)v[c1] *= s;
+		}
+	}
+	//the k lowest frequencies above the rotations, by block Lanczos over hessianVector: O(num) memory
+	vec& lowest(unsigned long long k, vec& w, unsigned long long block = 6)
+	{
+		mat rot;
+		rotations(rot);
+		blockLanczos lz(k, block);
+		lz.lowest([this](vec const& v, vec& hv) { tms.kernel.hessianVector(v, hv); }, 2 * tms.num, w, nullptr, &rot);
+		w.abs().sqrt();
+		return w;
 	}
 	void check()
 	{
@@ -553,22 +1329,12 @@ struct Vibration
 	}
 	void run()
 	{
-		//tms.pos.printToTableTxt("E:\\files\\C++\\ComputePhysics\\A34\\Homework1_4\\pos.txt",true);
-		for (unsigned long long c0(0); c0 < U.height; c0 += 2)
-		{
-			vec tp(U.data + (c0 + 1) * U.width4d, U.width4d, Type::Parasitic);
-			double s(sin(tms.pos[c0]));
-			tp /= s;
-		}
-		for (unsigned long long c0(0); c0 < U.width; c0 += 2)
-		{
-			double s(sin(tms.pos[c0]));
-			for (unsigned long long c1(0); c1 < U.height; ++c1)
-				U(c1, c0 + 1) /= s;
-		}
-		//U.print();
-		//U.printToTableTxt("E:\\files\\C++\\ComputePhysics\\A34\\Homework1_4\\mat.txt");
-		//must use L^TL
+		getHessian();
+		unsigned long long n(2 * tms.num);
+		mat U(n, n, false);
+		for (unsigned long long c0(0); c0 < n; ++c0)
+			for (unsigned long long c1(0); c1 <= c0; ++c1)
+				U(c0, c1) = U(c1, c0) = H.data[c0 * (c0 + 1) / 2 + c1];
 		mat tridiag(U.tridiagonalizationHouseholder());
 		vec f(U.width, false);
 		tridiag.implicitSymmetricQR(1e-42, f);
@@ -620,15 +1386,45 @@ int main()
 	std::uniform_int_distribution<unsigned long long> rduint(1, 10);
 	Timer timer;
 
-	/*timer.begin();
-	for (unsigned long long c0(2); c0 < 65; ++c0)
+	//N = 2 ... 64 against the table, all cores
 	{
-		Thomson tms(c0);
-		tms.run(1e-20, rd, mt);
-		::printf("%llu:\t%.11f\t%.3e\n", c0, tms.answer, tms.answer - tms.answers[c0]);
+		ThomsonSearch search;
+		for (unsigned long long c0(2); c0 < 65; ++c0)search.sizes.push_back(c0);
+		search.run();
+		search.timer.print();
+	}
+
+	//one fused energy and gradient pass over 5e7 pairs
+	{
+		Thomson big(10000);
+		big.initPos(rd, mt);
+		timer.begin();
+		double e(big.psiGradient(big.pos, big.g0));
+		timer.end();
+		::printf("N = 10000: psi = %.10e, |g| = %.5e\t", e, big.g0.norm2());
+		timer.print();
+		big.kernel.theta = 0.5;
+		timer.begin();
+		e = big.psiGradient(big.pos, big.g0);
+		timer.end();
+		::printf("Barnes-Hut, theta = 0.5: psi = %.10e, |g| = %.5e\t", e, big.g0.norm2());
+		timer.print();
+	}
+
+	//long run written to disk every 2 s off the optimiser thread; after a crash the same call goes on from the file
+	{
+		Thomson big(2000);
+		checkpointThread ck("thomson2000.ckpt", 2);
+		timer.begin();
+		if (!big.resumeLBFGS("thomson2000.ckpt", 1e-10, 8, &ck))
+		{
+			big.initPos(rd, mt);
+			big.minimizeLBFGS(1e-10, 8, &ck);
+		}
+		timer.end();
+		::printf("N = 2000: psi = %.10f, %llu checkpoints\t", big.answer, ck.written);
+		timer.print();
 	}
-	timer.end();
-	timer.print();*/
 
 	timer.begin();
 	Vibration vbr(12, rd, mt);
@@ -639,4 +1435,15 @@ int main()
 	vbr.freqs.print(true);
 	vbr.fn.print(true);
 	vbr.fs2r.print(true);
+
+	//lowest modes of a local minimum of 1000 charges from Hessian products, no dense Hessian
+	{
+		timer.begin();
+		Vibration large(1000, rd, mt);
+		vec w;
+		large.lowest(8, w);
+		timer.end();
+		timer.print();
+		w.print(true);
+	}
 }
\ No newline at end of file
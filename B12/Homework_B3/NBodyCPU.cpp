@@ -0,0 +1,263 @@
+#include <_NBody.h>
+#include <_Time.h>
+
+using namespace BLAS;
+
+//Plummer sphere of total mass 1 and scale radius 1, Gaussian velocities of deviation sigma in every axis
+template<class T>void plummer(NBodyCPU<T>& a, std::mt19937& mt, double sigma)
+{
+	std::uniform_real_distribution<double> ud(0, 1);
+	std::normal_distribution<double> nd(0, 1);
+	for (unsigned long long c0(0); c0 < a.num; ++c0)
+	{
+		double r(1 / ::sqrt(::pow(ud(mt), -2.0 / 3) - 1));
+		double dx(nd(mt)), dy(nd(mt)), dz(nd(mt));
+		double l(r / ::sqrt(dx * dx + dy * dy + dz * dz));
+		a.x[c0] = T(dx * l); a.y[c0] = T(dy * l); a.z[c0] = T(dz * l);
+		a.vx[c0] = T(sigma * nd(mt)); a.vy[c0] = T(sigma * nd(mt)); a.vz[c0] = T(sigma * nd(mt));
+		a.m[c0] = T(1.0 / a.num);
+	}
+	a.touch();
+}
+
+//the CUDA homework's driver on the CPU glue: steps of drift then kick, then the radial field of forceCalc in bins of r
+void glue(unsigned int blocks, unsigned long long steps)
+{
+	NBodyCPU_Glue g(blocks, 1e-4f, 1.0f);
+	std::vector<NBodyCPUParticle> particles(1024ull * blocks);
+	{
+		NBodyCPU<float> init(particles.size(), 0, 1);
+		std::mt19937 mt(1);
+		plummer(init, mt, 0.3);
+		for (unsigned long long c0(0); c0 < particles.size(); ++c0)
+			particles[c0] = { { init.x[c0], init.y[c0], init.z[c0] }, init.m[c0],
+				{ init.vx[c0], init.vy[c0], init.vz[c0] }, 0 };
+	}
+	g.particles = particles.data();
+	Timer timer;
+	timer.begin();
+	for (unsigned long long c0(0); c0 < steps; ++c0)g.run();
+	timer.end();
+	::printf("NBodyCPU_Glue<%u blocks> %llu steps, %.3e pairs/s\t", blocks, steps, g.engine.pairRate());
+	timer.print();
+	std::vector<NBodyCPUExpData> expData(particles.size());
+	g.experiment(expData.data());
+	//Plummer: the field at r is -r / (r^2 + 1)^1.5
+	constexpr unsigned long long bins(8);
+	double f[bins]{}, r[bins]{};
+	unsigned long long n[bins]{};
+	for (NBodyCPUExpData const& e : expData)
+	{
+		unsigned long long b((unsigned long long)(e.r * 2));
+		if (b >= bins)continue;
+		f[b] += e.force;
+		r[b] += e.r;
+		n[b]++;
+	}
+	for (unsigned long long c0(0); c0 < bins; ++c0)
+		if (n[c0])
+		{
+			double rm(r[c0] / n[c0]);
+			::printf("r = %.3f\tforce %.6e\tPlummer %.6e\n", rm, f[c0] / n[c0], -rm / ::pow(rm * rm + 1, 1.5));
+		}
+}
+
+//all-pairs field against a double sum over every 97th particle, and the pair rate of one evaluation
+template<class T>void allPairs(unsigned long long num)
+{
+	NBodyCPU<T> a(num, T(1e-3), T(1), T(1e-4));
+	std::mt19937 mt(1);
+	plummer(a, mt, 0.3);
+	a.accelerations();
+	double err(0);
+	for (unsigned long long c0(0); c0 < num; c0 += num / 97 + 1)
+	{
+		double f[3]{ 0, 0, 0 };
+		for (unsigned long long c1(0); c1 < num; ++c1)
+		{
+			double dx(double(a.x[c1]) - a.x[c0]), dy(double(a.y[c1]) - a.y[c0]), dz(double(a.z[c1]) - a.z[c0]);
+			double r2(dx * dx + dy * dy + dz * dz + double(a.soft2));
+			double w(c1 == c0 ? 0 : a.m[c1] / (r2 * ::sqrt(r2)));
+			f[0] += w * dx; f[1] += w * dy; f[2] += w * dz;
+		}
+		double d(::sqrt((f[0] - a.ax[c0]) * (f[0] - a.ax[c0]) + (f[1] - a.ay[c0]) * (f[1] - a.ay[c0]) + (f[2] - a.az[c0]) * (f[2] - a.az[c0])));
+		double e(d / ::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]));
+		if (e > err)err = e;
+	}
+	::printf("NBodyCPU<%s> N = %llu all pairs: %.3e pairs/s, max relative field error %.3e\t",
+		sizeof(T) == 4 ? "float" : "double", num, a.pairRate(), err);
+	Timer timer;
+	a.clearStats();
+	timer.begin();
+	a.accelerations();
+	timer.end();
+	timer.print();
+}
+
+//relative change of the total energy over a leapfrog run
+template<class T>void energyDrift(unsigned long long num, unsigned long long steps)
+{
+	NBodyCPU<T> a(num, T(1e-3), T(1), T(1e-4));
+	std::mt19937 mt(1);
+	plummer(a, mt, 0.3);
+	double e0(a.energy());
+	Timer timer;
+	timer.begin();
+	a.run(steps);
+	timer.end();
+	double e1(a.energy());
+	::printf("NBodyCPU<%s> N = %llu leapfrog %llu steps: energy %.10f -> %.10f, drift %.3e\t",
+		sizeof(T) == 4 ? "float" : "double", num, steps, e0, e1, (e1 - e0) / ::fabs(e0));
+	timer.print();
+}
+
+//Barnes-Hut field at opening angle theta against all pairs (skipped when reference is false), then leapfrog steps on the tree
+template<class T>void treeCode(unsigned long long num, T theta, bool reference, unsigned long long steps)
+{
+	char const* name(sizeof(T) == 4 ? "float" : "double");
+	NBodyCPU<T> a(num, T(1e-3), T(1), T(1e-6));
+	std::mt19937 mt(1);
+	plummer(a, mt, 0.3);
+	std::vector<T> rx, ry, rz;
+	double direct(0);
+	if (reference)
+	{
+		direct = a.accelerations(a.soft2);
+		rx.assign(a.ax, a.ax + num); ry.assign(a.ay, a.ay + num); rz.assign(a.az, a.az + num);
+		::printf("NBodyCPU<%s> N = %llu all pairs: %.3f s\n", name, num, direct);
+	}
+	a.theta = theta;
+	a.clearStats();
+	double tree(a.accelerations(a.soft2));
+	::printf("NBodyCPU<%s> N = %llu tree theta = %.2f: %.3f s, %.1f interactions per particle",
+		name, num, double(theta), tree, double(a.interactions) / num);
+	if (reference)
+	{
+		double err(0), rms(0);
+		for (unsigned long long c0(0); c0 < num; ++c0)
+		{
+			double dx(double(rx[c0]) - a.ax[c0]), dy(double(ry[c0]) - a.ay[c0]), dz(double(rz[c0]) - a.az[c0]);
+			double e((dx * dx + dy * dy + dz * dz) / (double(rx[c0]) * rx[c0] + double(ry[c0]) * ry[c0] + double(rz[c0]) * rz[c0]));
+			rms += e;
+			if (e > err)err = e;
+		}
+		::printf(", speedup %.1f, field error rms %.3e max %.3e", direct / tree, ::sqrt(rms / num), ::sqrt(err));
+	}
+	::printf("\n");
+	a.touch();
+	Timer timer;
+	timer.begin();
+	a.run(steps);
+	timer.end();
+	::printf("NBodyCPU<%s> N = %llu tree leapfrog %llu steps, %llu radix and %llu insertion sorts\t",
+		name, num, steps, a.tree.radixSorts, a.tree.insertionSorts);
+	timer.print();
+}
+
+//Kepler orbits of GM = 1 and semi-major axis 1 from perihelion, eccentricity e[lane]: after whole periods the exact
+//orbit is back at its start with energy -1/2, so both errors are the integrator's; rows of one lane per orbit
+struct Kepler
+{
+	static constexpr unsigned long long lanes = 4;
+	double e[lanes];
+
+	void initial(double* x, double* y, double* vx, double* vy)const
+	{
+		for (unsigned long long c0(0); c0 < lanes; ++c0)
+		{
+			x[c0] = 1 - e[c0]; y[c0] = 0;
+			vx[c0] = 0; vy[c0] = ::sqrt((1 + e[c0]) / (1 - e[c0]));
+		}
+	}
+	static void acc(double const* x, double const* y, double* ax, double* ay)
+	{
+		for (unsigned long long c0(0); c0 < lanes; ++c0)
+		{
+			double r2(x[c0] * x[c0] + y[c0] * y[c0]);
+			double w(-1 / (r2 * ::sqrt(r2)));
+			ax[c0] = w * x[c0]; ay[c0] = w * y[c0];
+		}
+	}
+	void print(char const* name, unsigned long long evaluations, double const* x, double const* y, double const* vx, double const* vy)const
+	{
+		::printf("%-20s%8llu evaluations", name, evaluations);
+		for (unsigned long long c0(0); c0 < lanes; ++c0)
+		{
+			double dx(x[c0] - (1 - e[c0]));
+			double energy(0.5 * (vx[c0] * vx[c0] + vy[c0] * vy[c0]) - 1 / ::sqrt(x[c0] * x[c0] + y[c0] * y[c0]));
+			::printf("\t%.1e %.1e", ::sqrt(dx * dx + y[c0] * y[c0]), ::fabs(energy + 0.5));
+		}
+		::printf("\n");
+	}
+};
+//Dormand-Prince, each lane with its own steps, against fixed-step RK4 and the symplectic kick-drift schemes
+//at about the same number of evaluations of the field
+void kepler(double periods, unsigned long long evaluations)
+{
+	Kepler k{ { 0, 0.3, 0.6, 0.9 } };
+	double t1(2 * Pi * periods);
+	::printf("Kepler orbits over %.0f periods, position and energy error for e =", periods);
+	for (double e : k.e)::printf(" %.1f", e);
+	::printf("\n");
+	//first order form: rows x, y, vx, vy
+	mat y(Kepler::lanes, 4);
+	unsigned long long w4(y.width4d);
+	auto f = [w4](vec const&, mat const& y, mat& dy)
+	{
+		memcpy64d(dy.data, y.data + 2 * w4, 2 * w4);
+		Kepler::acc(y.data, y.data + w4, dy.data + 2 * w4, dy.data + 3 * w4);
+	};
+	for (double rtol : { 1e-6, 1e-9, 1e-12 })
+	{
+		k.initial(y.data, y.data + w4, y.data + 2 * w4, y.data + 3 * w4);
+		odeDoPri dp(rtol, rtol * 1e-2);
+		bool ok(dp.run(f, 0, t1, y));
+		char name[32];
+		::sprintf(name, "DoPri rtol %.0e%s", rtol, ok ? "" : "!");
+		k.print(name, dp.evaluations, y.data, y.data + w4, y.data + 2 * w4, y.data + 3 * w4);
+	}
+	k.initial(y.data, y.data + w4, y.data + 2 * w4, y.data + 3 * w4);
+	odeRK4 rk;
+	rk.run(f, 0, t1, y, evaluations / 4);
+	k.print("RK4", rk.evaluations, y.data, y.data + w4, y.data + 2 * w4, y.data + 3 * w4);
+	mat q(Kepler::lanes, 2), v(Kepler::lanes, 2);
+	auto acc = [w4](mat const& q, mat& a)
+	{
+		Kepler::acc(q.data, q.data + w4, a.data, a.data + w4);
+	};
+	for (odeSymplectic::Scheme scheme : { odeSymplectic::Scheme::Leapfrog, odeSymplectic::Scheme::Yoshida4 })
+	{
+		bool leapfrog(scheme == odeSymplectic::Scheme::Leapfrog);
+		k.initial(q.data, q.data + w4, v.data, v.data + w4);
+		odeSymplectic sy(scheme);
+		unsigned long long steps(leapfrog ? evaluations : evaluations / 3);
+		sy.run(acc, q, v, t1 / steps, steps);
+		k.print(leapfrog ? "Leapfrog" : "Yoshida4", sy.evaluations, q.data, q.data + w4, v.data, v.data + w4);
+	}
+}
+
+int main()
+{
+	Timer timer;
+	timer.begin();
+
+	glue(16, 10);
+
+	::printf("\n");
+
+	allPairs<float>(16384);
+	allPairs<double>(16384);
+	energyDrift<double>(4096, 200);
+
+	::printf("\n");
+
+	treeCode<double>(100000, 0.5, true, 5);
+	treeCode<float>(1000000, 0.6f, false, 2);
+
+	::printf("\n");
+
+	kepler(10, 100000);
+
+	timer.end();
+	timer.print("Total time:");
+}
@@ -7,6 +7,19 @@
 #include <cstdio>
 #include <immintrin.h>
 #include <random>
+#include <utility>
+#include <type_traits>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <iterator>
 
 //if you can change it, then change it
 namespace BLAS
@@ -96,6 +109,71 @@ namespace BLAS
 		return ::memset(dst, val, ceiling256dSize(width, height));
 	}
 
+	//unaligned raw kernels: a . b and y += s * x
+	inline double dot64d(double const* a, double const* b, unsigned long long length)
+	{
+		__m256d s(_mm256_setzero_pd());
+		unsigned long long c0(0);
+		for (; c0 + 4 <= length; c0 += 4)
+			s = _mm256_fmadd_pd(_mm256_loadu_pd(a + c0), _mm256_loadu_pd(b + c0), s);
+		double const* t((double const*)&s);
+		double r((t[0] + t[1]) + (t[2] + t[3]));
+		for (; c0 < length; ++c0)r += a[c0] * b[c0];
+		return r;
+	}
+	inline void fmadd64d(double* y, double s, double const* x, unsigned long long length)
+	{
+		__m256d tp(_mm256_set1_pd(s));
+		unsigned long long c0(0);
+		for (; c0 + 4 <= length; c0 += 4)
+			_mm256_storeu_pd(y + c0, _mm256_fmadd_pd(tp, _mm256_loadu_pd(x + c0), _mm256_loadu_pd(y + c0)));
+		for (; c0 < length; ++c0)y[c0] += s * x[c0];
+	}
+
+	//c -= a * b, a: rows x depth, b: depth x cols, all row major with the given strides
+	//4x8 register tiles
+	inline void fnmaddMat64d(double* c, unsigned long long ldc, double const* a, unsigned long long lda,
+		double const* b, unsigned long long ldb, unsigned long long rows, unsigned long long cols, unsigned long long depth)
+	{
+		unsigned long long c0(0);
+		for (; c0 + 4 <= rows; c0 += 4)
+		{
+			unsigned long long c1(0);
+			for (; c1 + 8 <= cols; c1 += 8)
+			{
+				__m256d acc[4][2];
+				for (unsigned long long c2(0); c2 < 4; ++c2)
+				{
+					acc[c2][0] = _mm256_loadu_pd(c + (c0 + c2) * ldc + c1);
+					acc[c2][1] = _mm256_loadu_pd(c + (c0 + c2) * ldc + c1 + 4);
+				}
+				for (unsigned long long c3(0); c3 < depth; ++c3)
+				{
+					__m256d b0(_mm256_loadu_pd(b + c3 * ldb + c1));
+					__m256d b1(_mm256_loadu_pd(b + c3 * ldb + c1 + 4));
+					for (unsigned long long c2(0); c2 < 4; ++c2)
+					{
+						__m256d l(_mm256_broadcast_sd(a + (c0 + c2) * lda + c3));
+						acc[c2][0] = _mm256_fnmadd_pd(l, b0, acc[c2][0]);
+						acc[c2][1] = _mm256_fnmadd_pd(l, b1, acc[c2][1]);
+					}
+				}
+				for (unsigned long long c2(0); c2 < 4; ++c2)
+				{
+					_mm256_storeu_pd(c + (c0 + c2) * ldc + c1, acc[c2][0]);
+					_mm256_storeu_pd(c + (c0 + c2) * ldc + c1 + 4, acc[c2][1]);
+				}
+			}
+			if (c1 < cols)
+				for (unsigned long long c2(0); c2 < 4; ++c2)
+					for (unsigned long long c3(0); c3 < depth; ++c3)
+						fmadd64d(c + (c0 + c2) * ldc + c1, -a[(c0 + c2) * lda + c3], b + c3 * ldb + c1, cols - c1);
+		}
+		for (; c0 < rows; ++c0)
+			for (unsigned long long c3(0); c3 < depth; ++c3)
+				fmadd64d(c + c0 * ldc, -a[c0 * lda + c3], b + c3 * ldb, cols);
+	}
+
 	inline unsigned long long getPtrOffset64d(double* ptr)
 	{
 		return (unsigned long long(ptr) >> 3) & 3;
@@ -105,6 +183,150 @@ namespace BLAS
 		return (double*)(unsigned long long(ptr) & -32);
 	}
 
+	//threads
+	inline unsigned long long threadNum()
+	{
+		unsigned long long n(std::thread::hardware_concurrency());
+		return n ? n : 1;
+	}
+	//true while the calling thread runs tasks of a parallelFor
+	inline bool& parallelWorker()
+	{
+		thread_local bool inside(false);
+		return inside;
+	}
+	//workers kept alive behind parallelFor, so a call costs a wake-up instead of creating and joining threads;
+	//they poll (yielding the core) a little before sleeping since calls in a solver loop come back to back
+	struct ParallelPool
+	{
+		static constexpr unsigned long long spin = 1 << 10;
+		std::mutex busy;//one job at a time
+		std::mutex lock;
+		std::condition_variable wake, done;
+		std::vector<std::thread> workers;
+		void (*call)(void*, unsigned long long);
+		void* context;
+		unsigned long long members;//workers 1 .. members take part in the current job
+		std::atomic<unsigned long long> generation;
+		std::atomic<unsigned long long> pending;
+		bool stop;
+
+		ParallelPool() :call(nullptr), context(nullptr), members(0), generation(0), pending(0), stop(false) {}
+		~ParallelPool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				stop = true;
+			}
+			wake.notify_all();
+			for (std::thread& t : workers)t.join();
+		}
+		static ParallelPool& instance()
+		{
+			static ParallelPool pool;
+			return pool;
+		}
+		//_call(_context, id) on the caller as id 0 and on threads - 1 workers, returns when all are done;
+		//the caller holds busy
+		void run(unsigned long long threads, void (*_call)(void*, unsigned long long), void* _context)
+		{
+			while (workers.size() < threads - 1)
+				workers.emplace_back(&ParallelPool::loop, this, (unsigned long long)workers.size() + 1);
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				call = _call;
+				context = _context;
+				members = threads - 1;
+				pending.store(threads - 1);
+				generation.fetch_add(1);
+			}
+			wake.notify_all();
+			_call(_context, 0);
+			for (unsigned long long c0(0); c0 < spin && pending.load(); ++c0)std::this_thread::yield();
+			std::unique_lock<std::mutex> guard(lock);
+			done.wait(guard, [this] {return !pending.load(); });
+		}
+		void loop(unsigned long long id)
+		{
+			parallelWorker() = true;
+			unsigned long long seen(0);
+			for (;;)
+			{
+				void (*c)(void*, unsigned long long);
+				void* ctx;
+				for (unsigned long long c0(0); c0 < spin && generation.load() == seen; ++c0)std::this_thread::yield();
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					wake.wait(guard, [&] {return stop || generation.load() != seen; });
+					if (stop)return;
+					seen = generation.load();
+					if (id > members)continue;
+					c = call;
+					ctx = context;
+				}
+				c(ctx, id);
+				if (pending.fetch_sub(1) == 1)
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					done.notify_one();
+				}
+			}
+		}
+	};
+	//f(c0, threadId) for every c0 in [0, n), dynamic scheduling, threads == 0 means threadNum()
+	//a call made from inside a task runs serially on that thread instead of spawning threads again;
+	//runs on ParallelPool, a call that finds the pool taken by another thread starts threads of its own
+	template<class F>void parallelFor(unsigned long long n, F&& f, unsigned long long threads = 0)
+	{
+		if (!threads)threads = threadNum();
+		if (threads > n)threads = n;
+		if (threads <= 1 || parallelWorker())
+		{
+			for (unsigned long long c0(0); c0 < n; ++c0)f(c0, 0);
+			return;
+		}
+		std::atomic<unsigned long long> next(0);
+		auto work = [&](unsigned long long id)
+		{
+			unsigned long long c0;
+			bool outer(parallelWorker());
+			parallelWorker() = true;
+			while ((c0 = next.fetch_add(1)) < n)f(c0, id);
+			parallelWorker() = outer;
+		};
+		ParallelPool& pool(ParallelPool::instance());
+		std::unique_lock<std::mutex> busy(pool.busy, std::try_to_lock);
+		if (busy.owns_lock())
+		{
+			pool.run(threads, [](void* p, unsigned long long id) {(*(decltype(work)*)p)(id); }, &work);
+			return;
+		}
+		std::thread* ths(new std::thread[threads - 1]);
+		for (unsigned long long c0(0); c0 < threads - 1; ++c0)
+			ths[c0] = std::thread(work, c0 + 1);
+		work(0);
+		for (unsigned long long c0(0); c0 < threads - 1; ++c0)
+			ths[c0].join();
+		delete[] ths;
+	}
+	//f(c0, threadId) for every c0 like parallelFor, tasks taken in the order schedule[0], schedule[1], ... if given,
+	//out(c0) runs for c0 = 0, 1, ... in order, one at a time, as soon as tasks 0 .. c0 are all done
+	template<class F, class Out>void parallelOrdered(unsigned long long n, F&& f, Out&& out,
+		unsigned long long const* schedule = nullptr, unsigned long long threads = 0)
+	{
+		std::vector<unsigned char> done(n, 0);
+		std::mutex lock;
+		unsigned long long head(0);
+		parallelFor(n, [&](unsigned long long c0, unsigned long long id)
+			{
+				if (schedule)c0 = schedule[c0];
+				f(c0, id);
+				std::lock_guard<std::mutex> guard(lock);
+				done[c0] = 1;
+				while (head < n && done[head])out(head++);
+			}, threads);
+	}
+
 	void givens(double x, double y, double& c, double& s, double& r)
 	{
 		if (y == 0)
@@ -1589,6 +1811,7 @@ namespace BLAS
 					if (_clear)memset64d(data, 0, s);
 					width = _width;
 					height = _height;
+					width4d = ceiling4(_width);
 				}
 			}
 		}
@@ -2858,38 +3081,118 @@ namespace BLAS
 			r = a;
 			return r;
 		}
-		//
-		mat& inversePowerEigenvectors(vec const& eigenvalues, mat& eigenvectors)
-		{
-			if (width && eigenvalues.dim)
-			{
-				mat ts(width, height, false);
-				vec y(width, true);
-				for (unsigned long long c0(0); c0 < eigenvalues.dim; ++c0)
+		//dense symmetric eigenproblem: Householder tridiagonalization, then implicit QR with Wilkinson shifts,
+		//both keeping their transformations; eigenvectors in rows, row c0 belongs to eigenvalues[c0] (not sorted)
+		vec& eigenSymmetric(vec& eigenvalues, mat& eigenvectors, double eps = 1e-15)const
+		{
+			unsigned long long n(width);
+			if (!n || width != height)return eigenvalues;
+			mat a(n, n, false);
+			for (unsigned long long c0(0); c0 < n; ++c0)
+				memcpy64d(a.data + c0 * a.width4d, data + c0 * width4d, n);
+			if (eigenvalues.dim != n)eigenvalues.reconstruct(n, false);
+			if (eigenvectors.width != n || eigenvectors.height != n)eigenvectors.reconstruct(n, n, false);
+			vec e(n, true), beta(n, true);
+			mat v(n, n, true);//Householder vectors in rows
+			double* d(eigenvalues.data);
+			//a_{k + 1 .., k} -> e[k] by I - beta[k] v_k v_k^T on the trailing block
+			for (unsigned long long c0(0); c0 + 2 < n; ++c0)
+			{
+				unsigned long long m(n - c0 - 1);
+				double* x(a.data + c0 * a.width4d + c0 + 1);
+				double* vk(v.data + c0 * v.width4d + c0 + 1);
+				double sigma(dot64d(x + 1, x + 1, m - 1));
+				if (sigma == 0)
 				{
-					double lbd(eigenvalues.data[c0]), lbd1(lbd + 1e-5);
-					vec x(eigenvectors.data + c0 * width4d, width, Type::Parasitic);
-					x = 0;
-					x[0] = 1;
-					ts = *this;
-					for (unsigned long long c1(0); c1 < width; ++c1)
-						ts(c1, c1) -= lbd;
-					ts.solveCholesky();
-					unsigned long long cnt(0);
-					while (abs(lbd - lbd1) > 1e-11)
+					e[c0] = x[0];
+					continue;
+				}
+				double xn(::sqrt(x[0] * x[0] + sigma));
+				double alpha(x[0] > 0 ? -xn : xn);
+				memcpy64d(vk, x, m);
+				vk[0] -= alpha;
+				double b(2 / dot64d(vk, vk, m));
+				beta[c0] = b;
+				e[c0] = alpha;
+				//p = b B v, w = p - (b p.v / 2) v, B -= v w^T + w v^T
+				vec p(m, false);
+				for (unsigned long long c1(0); c1 < m; ++c1)
+					p[c1] = b * dot64d(a.data + (c0 + 1 + c1) * a.width4d + c0 + 1, vk, m);
+				fmadd64d(p.data, -b * dot64d(p.data, vk, m) / 2, vk, m);
+				for (unsigned long long c1(0); c1 < m; ++c1)
+				{
+					double* row(a.data + (c0 + 1 + c1) * a.width4d + c0 + 1);
+					fmadd64d(row, -vk[c1], p.data, m);
+					fmadd64d(row, -p[c1], vk, m);
+				}
+			}
+			for (unsigned long long c0(0); c0 < n; ++c0)d[c0] = a.data[c0 * a.width4d + c0];
+			if (n > 1)e[n - 2] = a.data[(n - 2) * a.width4d + n - 1];
+			//rows of Q^T = H_{n - 3} ... H_0
+			double* z(eigenvectors.data);
+			unsigned long long ld(eigenvectors.width4d);
+			eigenvectors.clear();
+			for (unsigned long long c0(0); c0 < n; ++c0)z[c0 * ld + c0] = 1;
+			vec u(n, false);
+			for (unsigned long long c0(0); c0 + 2 < n; ++c0)
+			{
+				if (beta[c0] == 0)continue;
+				double const* vk(v.data + c0 * v.width4d);
+				memset64d(u.data, 0, n);
+				for (unsigned long long c1(c0 + 1); c1 < n; ++c1)fmadd64d(u.data, vk[c1], z + c1 * ld, n);
+				for (unsigned long long c1(c0 + 1); c1 < n; ++c1)fmadd64d(z + c1 * ld, -beta[c0] * vk[c1], u.data, n);
+			}
+			//implicit QR on the unreduced block [p, q], rotations J = [c s; -s c] go to rows c0, c0 + 1 of Q^T
+			unsigned long long q(n ? n - 1 : 0), cnt(0);
+			while (q > 0)
+			{
+				if (abs(e[q - 1]) <= eps * (abs(d[q - 1]) + abs(d[q])))
+				{
+					e[q - 1] = 0;
+					q--;
+					continue;
+				}
+				if (cnt++ > 30 * n)
+				{
+					::printf("QR doesn't converge!\n");
+					break;
+				}
+				unsigned long long p(q - 1);
+				while (p > 0 && abs(e[p - 1]) > eps * (abs(d[p - 1]) + abs(d[p])))p--;
+				double t((d[q - 1] - d[q]) / 2);
+				double e2(e[q - 1] * e[q - 1]);
+				double miu(d[q] - e2 / (t + copysign(::sqrt(t * t + e2), t)));
+				double x(d[p] - miu), y(e[p]);
+				for (unsigned long long c0(p); c0 < q; ++c0)
+				{
+					double c, s, r;
+					givens(x, y, c, s, r);
+					t = (d[c0 + 1] - d[c0]) * s;
+					double w((2 * c * e[c0] + t) * s);
+					d[c0] += w;
+					d[c0 + 1] -= w;
+					e[c0] = t * c + (c * c - s * s) * e[c0];
+					x = e[c0];
+					if (c0 > p)e[c0 - 1] = r;
+					if (c0 + 1 < q)
 					{
-						ts.solveCholeskyAlread(x, x, y);
-						x.normalize();
-						//x.print(true);
-						(*this)(x, y);
-						lbd1 = (x, y);
-						//::printf("%.3e\n", lbd1 - lbd);
-						if (cnt++ > 10)break;
+						y = s * e[c0 + 1];
+						e[c0 + 1] *= c;
+					}
+					double* z0(z + c0 * ld);
+					double* z1(z0 + ld);
+					for (unsigned long long c1(0); c1 < n; ++c1)
+					{
+						double g(z0[c1]), h(z1[c1]);
+						z0[c1] = c * g + s * h;
+						z1[c1] = c * h - s * g;
 					}
 				}
 			}
-			return eigenvectors;
+			return eigenvalues;
 		}
+		//shift-invert, see shiftInvertEigen
+		mat& inversePowerEigenvectors(vec const& eigenvalues, mat& eigenvectors);
 		vec& powerMaxEigenvector(vec& eigenvector)
 		{
 			if (width)
@@ -4576,6 +4879,5090 @@ namespace BLAS
 		return b;
 	}
 
+	//batch of small mats with the same size, 4 of them are interleaved in the lanes of one __m256d (SoA)
+	//element (c1, c2) of mat c0 is at data[((c0 / 4 * height + c1) * width + c2) * 4 + c0 % 4]
+	struct matBatch
+	{
+		double* data;
+		unsigned long long width;
+		unsigned long long height;
+		unsigned long long num;
+		unsigned long long groups;
+		Type type;
+
+		matBatch() :data(nullptr), width(0), height(0), num(0), groups(0), type(Type::Native) {}
+		matBatch(unsigned long long _width, unsigned long long _height, unsigned long long _num, bool _clear = true)
+			:
+			data((_width&& _height&& _num) ? malloc64d(_width * _height * ceiling4(_num)) : nullptr),
+			width(data ? _width : 0),
+			height(data ? _height : 0),
+			num(data ? _num : 0),
+			groups(data ? ceiling4(_num) >> 2 : 0),
+			type(Type::Native)
+		{
+			if (_clear && data)memset64d(data, 0, size());
+		}
+		matBatch(matBatch const& a)
+			:
+			data(a.data ? malloc64d(a.size()) : nullptr),
+			width(a.width),
+			height(a.height),
+			num(a.num),
+			groups(a.groups),
+			type(Type::Native)
+		{
+			if (data)memcpy64d(data, a.data, size());
+		}
+		matBatch(matBatch&& a) :data(a.data), width(a.width), height(a.height), num(a.num), groups(a.groups), type(a.type)
+		{
+			a.data = nullptr;
+			a.width = a.height = a.num = a.groups = 0;
+		}
+		~matBatch()
+		{
+			if (type == Type::Native)_mm_free(data);
+			data = nullptr;
+			width = height = num = groups = 0;
+		}
+		inline unsigned long long size()const
+		{
+			return width * height * groups * 4;
+		}
+		inline double& operator()(unsigned long long a, unsigned long long b, unsigned long long c)
+		{
+			return data[(((a >> 2) * height + b) * width + c) * 4 + (a & 3)];
+		}
+		inline double operator()(unsigned long long a, unsigned long long b, unsigned long long c)const
+		{
+			return data[(((a >> 2) * height + b) * width + c) * 4 + (a & 3)];
+		}
+		//the 4 mats of group a
+		inline __m256d* group(unsigned long long a)const
+		{
+			return (__m256d*)data + a * width * height;
+		}
+		void clear()
+		{
+			if (data)memset64d(data, 0, size());
+		}
+		void reconstruct(unsigned long long _width, unsigned long long _height, unsigned long long _num, bool _clear = true)
+		{
+			if (type == Type::Native)
+			{
+				_mm_free(data);
+				data = nullptr;
+				width = height = num = groups = 0;
+				if (_width && _height && _num)
+				{
+					data = malloc64d(_width * _height * ceiling4(_num));
+					width = _width;
+					height = _height;
+					num = _num;
+					groups = ceiling4(_num) >> 2;
+					if (_clear)clear();
+				}
+			}
+		}
+		matBatch& operator=(matBatch const& a)
+		{
+			if (this != &a)
+			{
+				if (width != a.width || height != a.height || num != a.num)
+					reconstruct(a.width, a.height, a.num, false);
+				if (data)memcpy64d(data, a.data, size());
+			}
+			return *this;
+		}
+		matBatch& operator=(matBatch&& a)
+		{
+			if (type == Type::Native && a.type == Type::Native)
+			{
+				_mm_free(data);
+				data = a.data;
+				width = a.width;
+				height = a.height;
+				num = a.num;
+				groups = a.groups;
+				a.data = nullptr;
+				a.width = a.height = a.num = a.groups = 0;
+				return *this;
+			}
+			return *this = (matBatch const&)a;
+		}
+		//copy between a normal mat and the c0-th mat of the batch
+		matBatch& setMat(unsigned long long c0, mat const& a)
+		{
+			unsigned long long minW(a.width > width ? width : a.width);
+			unsigned long long minH(a.height > height ? height : a.height);
+			for (unsigned long long c1(0); c1 < minH; ++c1)
+				for (unsigned long long c2(0); c2 < minW; ++c2)
+					(*this)(c0, c1, c2) = a.data[c1 * a.width4d + c2];
+			return *this;
+		}
+		mat& getMat(unsigned long long c0, mat& a)const
+		{
+			if (a.width != width || a.height != height)
+				a.reconstruct(width, height, false);
+			for (unsigned long long c1(0); c1 < height; ++c1)
+				for (unsigned long long c2(0); c2 < width; ++c2)
+					a.data[c1 * a.width4d + c2] = (*this)(c0, c1, c2);
+			return a;
+		}
+		//set every mat to identity (for square mats)
+		matBatch& identity()
+		{
+			clear();
+			__m256d one(_mm256_set1_pd(1));
+			unsigned long long minDim(width > height ? height : width);
+			for (unsigned long long c0(0); c0 < groups; ++c0)
+			{
+				__m256d* a(group(c0));
+				for (unsigned long long c1(0); c1 < minDim; ++c1)
+					a[c1 * width + c1] = one;
+			}
+			return *this;
+		}
+
+		//non-in-situ mult: b[k] = this[k] * a[k]
+		matBatch operator()(matBatch const& a)const
+		{
+			if (width == a.height && num == a.num && num)
+			{
+				matBatch r(a.width, height, num, false);
+				return (*this)(a, r);
+			}
+			return matBatch();
+		}
+		matBatch& operator()(matBatch const& a, matBatch& b)const
+		{
+			if (width != a.height || num != a.num || !num)return b;
+			if (&b == this || &b == &a)
+			{
+				matBatch r(a.width, height, num, false);
+				(*this)(a, r);
+				return b = (matBatch&&)r;
+			}
+			if (b.width != a.width || b.height != height || b.num != num)
+				b.reconstruct(a.width, height, num, false);
+			for (unsigned long long c0(0); c0 < groups; ++c0)
+			{
+				__m256d* s(group(c0));
+				__m256d* t(a.group(c0));
+				__m256d* r(b.group(c0));
+				for (unsigned long long c1(0); c1 < height; ++c1)
+				{
+					for (unsigned long long c2(0); c2 < a.width; ++c2)
+					{
+						__m256d ans(_mm256_mul_pd(s[c1 * width], t[c2]));
+						for (unsigned long long c3(1); c3 < width; ++c3)
+							ans = _mm256_fmadd_pd(s[c1 * width + c3], t[c3 * a.width + c2], ans);
+						r[c1 * a.width + c2] = ans;
+					}
+				}
+			}
+			return b;
+		}
+		//Cholesky only (no solving), for symmetric positive definite square mats
+		//the lower part is replaced by L (A = L L^T), the upper part is not touched
+		matBatch& solveCholesky()
+		{
+			if (width != height)return *this;
+			for (unsigned long long c0(0); c0 < groups; ++c0)
+			{
+				__m256d* a(group(c0));
+				for (unsigned long long c1(0); c1 < height; ++c1)
+				{
+					__m256d* l1(a + c1 * width);
+					__m256d d(l1[c1]);
+					for (unsigned long long c2(0); c2 < c1; ++c2)
+						d = _mm256_fnmadd_pd(l1[c2], l1[c2], d);
+					d = _mm256_sqrt_pd(d);
+					l1[c1] = d;
+					__m256d rd(_mm256_div_pd(_mm256_set1_pd(1), d));
+					for (unsigned long long c2(c1 + 1); c2 < height; ++c2)
+					{
+						__m256d* l2(a + c2 * width);
+						__m256d s(l2[c1]);
+						for (unsigned long long c3(0); c3 < c1; ++c3)
+							s = _mm256_fnmadd_pd(l2[c3], l1[c3], s);
+						l2[c1] = _mm256_mul_pd(s, rd);
+					}
+				}
+			}
+			return *this;
+		}
+		//Cholesky is already done, a and b are (any width) x height batches, b can be a
+		matBatch& solveCholeskyAlread(matBatch const& a, matBatch& b)const
+		{
+			if (width != height || a.height != height || a.num != num)return b;
+			if (&b != &a)b = a;
+			unsigned long long w(b.width);
+			for (unsigned long long c0(0); c0 < groups; ++c0)
+			{
+				__m256d* l(group(c0));
+				__m256d* x(b.group(c0));
+				for (unsigned long long c1(0); c1 < height; ++c1)
+				{
+					__m256d rd(_mm256_div_pd(_mm256_set1_pd(1), l[c1 * width + c1]));
+					for (unsigned long long c2(0); c2 < w; ++c2)
+					{
+						__m256d s(x[c1 * w + c2]);
+						for (unsigned long long c3(0); c3 < c1; ++c3)
+							s = _mm256_fnmadd_pd(l[c1 * width + c3], x[c3 * w + c2], s);
+						x[c1 * w + c2] = _mm256_mul_pd(s, rd);
+					}
+				}
+				for (long long c1(height - 1); c1 >= 0; --c1)
+				{
+					__m256d rd(_mm256_div_pd(_mm256_set1_pd(1), l[c1 * width + c1]));
+					for (unsigned long long c2(0); c2 < w; ++c2)
+					{
+						__m256d s(x[c1 * w + c2]);
+						for (unsigned long long c3(c1 + 1); c3 < height; ++c3)
+							s = _mm256_fnmadd_pd(l[c3 * width + c1], x[c3 * w + c2], s);
+						x[c1 * w + c2] = _mm256_mul_pd(s, rd);
+					}
+				}
+			}
+			return b;
+		}
+		//symmetric positive definite, changes the mats themselves
+		matBatch& solveCholesky(matBatch const& a, matBatch& b)
+		{
+			solveCholesky();
+			return solveCholeskyAlread(a, b);
+		}
+		//cyclic Jacobi for symmetric mats, changes the mats themselves
+		//eigenvalues: 1 x height batch, eigenvectors: height x height batch (in rows, not sorted)
+		matBatch& eigenSymmetric(matBatch& eigenvalues, matBatch& eigenvectors, double eps)
+		{
+			if (width != height || !num)return eigenvalues;
+			if (eigenvalues.width != 1 || eigenvalues.height != height || eigenvalues.num != num)
+				eigenvalues.reconstruct(1, height, num, false);
+			if (eigenvectors.width != width || eigenvectors.height != height || eigenvectors.num != num)
+				eigenvectors.reconstruct(width, height, num, false);
+			eigenvectors.identity();
+			__m256d absMask(_mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffll)));
+			__m256d one(_mm256_set1_pd(1));
+			__m256d tiny(_mm256_set1_pd(1e-300));
+			for (unsigned long long c0(0); c0 < groups; ++c0)
+			{
+				__m256d* a(group(c0));
+				__m256d* v(eigenvectors.group(c0));
+				for (unsigned long long cnt(0); cnt < 100; ++cnt)
+				{
+					__m256d off(_mm256_setzero_pd());
+					__m256d diag(_mm256_setzero_pd());
+					for (unsigned long long c1(0); c1 < height; ++c1)
+					{
+						diag = _mm256_fmadd_pd(a[c1 * width + c1], a[c1 * width + c1], diag);
+						for (unsigned long long c2(0); c2 < c1; ++c2)
+							off = _mm256_fmadd_pd(a[c1 * width + c2], a[c1 * width + c2], off);
+					}
+					double const* o((double const*)&off);
+					double const* d((double const*)&diag);
+					bool converged(true);
+					for (unsigned long long c1(0); c1 < 4; ++c1)
+						if (o[c1] > eps * eps * d[c1])converged = false;
+					if (converged)break;
+					for (unsigned long long p(0); p < height - 1; ++p)
+						for (unsigned long long q(p + 1); q < height; ++q)
+						{
+							__m256d apq(a[p * width + q]);
+							__m256d zero(_mm256_cmp_pd(_mm256_and_pd(apq, absMask), tiny, _CMP_LT_OQ));
+							__m256d theta(_mm256_div_pd(_mm256_sub_pd(a[q * width + q], a[p * width + p]),
+								_mm256_blendv_pd(_mm256_add_pd(apq, apq), one, zero)));
+							__m256d sign(_mm256_andnot_pd(absMask, theta));
+							__m256d absTheta(_mm256_and_pd(absMask, theta));
+							__m256d t(_mm256_div_pd(one, _mm256_add_pd(absTheta,
+								_mm256_sqrt_pd(_mm256_fmadd_pd(theta, theta, one)))));
+							t = _mm256_andnot_pd(zero, _mm256_or_pd(t, sign));
+							__m256d c(_mm256_div_pd(one, _mm256_sqrt_pd(_mm256_fmadd_pd(t, t, one))));
+							__m256d s(_mm256_mul_pd(t, c));
+							for (unsigned long long c1(0); c1 < height; ++c1)
+							{
+								__m256d x(a[c1 * width + p]);
+								__m256d y(a[c1 * width + q]);
+								a[c1 * width + p] = _mm256_fnmadd_pd(s, y, _mm256_mul_pd(c, x));
+								a[c1 * width + q] = _mm256_fmadd_pd(s, x, _mm256_mul_pd(c, y));
+							}
+							for (unsigned long long c1(0); c1 < width; ++c1)
+							{
+								__m256d x(a[p * width + c1]);
+								__m256d y(a[q * width + c1]);
+								a[p * width + c1] = _mm256_fnmadd_pd(s, y, _mm256_mul_pd(c, x));
+								a[q * width + c1] = _mm256_fmadd_pd(s, x, _mm256_mul_pd(c, y));
+								x = v[p * width + c1];
+								y = v[q * width + c1];
+								v[p * width + c1] = _mm256_fnmadd_pd(s, y, _mm256_mul_pd(c, x));
+								v[q * width + c1] = _mm256_fmadd_pd(s, x, _mm256_mul_pd(c, y));
+							}
+						}
+				}
+				__m256d* e(eigenvalues.group(c0));
+				for (unsigned long long c1(0); c1 < height; ++c1)
+					e[c1] = a[c1 * width + c1];
+			}
+			return eigenvalues;
+		}
+
+		void print(unsigned long long c0)const
+		{
+			::printf("[\n");
+			for (unsigned long long c1(0); c1 < height; ++c1)
+			{
+				::printf("\t[%4.6f", (*this)(c0, c1, 0));
+				for (unsigned long long c2(1); c2 < width; ++c2)
+					::printf(", %4.6f", (*this)(c0, c1, c2));
+				::printf("]\n");
+			}
+			::printf("]\n");
+		}
+	};
+
+	//compile time unroll: f(std::integral_constant<unsigned long long, c0>()) for every c0 in [0, N)
+	template<class F, unsigned long long... Is>inline void unrollImpl(F&& f, std::integer_sequence<unsigned long long, Is...>)
+	{
+		(f(std::integral_constant<unsigned long long, Is>()), ...);
+	}
+	template<unsigned long long N, class F>inline void unroll(F&& f)
+	{
+		unrollImpl(f, std::make_integer_sequence<unsigned long long, N>());
+	}
+
+	//fixed size vec/mat on the stack, same padded layout as vec/mat so that view() is zero-copy
+	//the padding is always kept 0
+	template<unsigned long long N>struct fixedVec
+	{
+		static constexpr unsigned long long dim = N;
+		static constexpr unsigned long long dim4d = ((N + 3) >> 2) << 2;
+		alignas(32) double data[dim4d];
+
+		fixedVec()
+		{
+			unroll<dim4d>([&](auto c0) { data[c0] = 0; });
+		}
+		fixedVec(std::initializer_list<double>const& a) :fixedVec()
+		{
+			for (unsigned long long c0(0); c0 < N && c0 < a.size(); ++c0)
+				data[c0] = a.begin()[c0];
+		}
+		explicit fixedVec(vec const& a) :fixedVec()
+		{
+			for (unsigned long long c0(0); c0 < N && c0 < a.dim; ++c0)
+				data[c0] = a.data[a.beginning + c0];
+		}
+		inline double& operator[](unsigned long long a)
+		{
+			return data[a];
+		}
+		inline double operator[](unsigned long long a)const
+		{
+			return data[a];
+		}
+		//zero-copy
+		inline vec view()
+		{
+			return vec(data, N, Type::Parasitic);
+		}
+		fixedVec& operator=(double a)
+		{
+			unroll<N>([&](auto c0) { data[c0] = a; });
+			return *this;
+		}
+		fixedVec& operator+=(fixedVec const& a)
+		{
+			unroll<(dim4d >> 2)>([&](auto c0)
+				{
+					((__m256d*)data)[c0] = _mm256_add_pd(((__m256d*)data)[c0], ((__m256d const*)a.data)[c0]);
+				});
+			return *this;
+		}
+		fixedVec& operator-=(fixedVec const& a)
+		{
+			unroll<(dim4d >> 2)>([&](auto c0)
+				{
+					((__m256d*)data)[c0] = _mm256_sub_pd(((__m256d*)data)[c0], ((__m256d const*)a.data)[c0]);
+				});
+			return *this;
+		}
+		fixedVec& operator*=(double a)
+		{
+			__m256d tp(_mm256_set1_pd(a));
+			unroll<(dim4d >> 2)>([&](auto c0)
+				{
+					((__m256d*)data)[c0] = _mm256_mul_pd(((__m256d*)data)[c0], tp);
+				});
+			return *this;
+		}
+		fixedVec& operator/=(double a)
+		{
+			return (*this) *= 1 / a;
+		}
+		//vecA = a * vecB + vecA
+		fixedVec& fmadd(double a, fixedVec const& b)
+		{
+			__m256d tp(_mm256_set1_pd(a));
+			unroll<(dim4d >> 2)>([&](auto c0)
+				{
+					((__m256d*)data)[c0] = _mm256_fmadd_pd(tp, ((__m256d const*)b.data)[c0], ((__m256d*)data)[c0]);
+				});
+			return *this;
+		}
+		fixedVec operator+(fixedVec const& a)const
+		{
+			fixedVec r(*this);
+			return r += a;
+		}
+		fixedVec operator-(fixedVec const& a)const
+		{
+			fixedVec r(*this);
+			return r -= a;
+		}
+		fixedVec operator*(double a)const
+		{
+			fixedVec r(*this);
+			return r *= a;
+		}
+		//dot
+		double operator,(fixedVec const& a)const
+		{
+			__m256d tp(_mm256_setzero_pd());
+			unroll<(dim4d >> 2)>([&](auto c0)
+				{
+					tp = _mm256_fmadd_pd(((__m256d const*)data)[c0], ((__m256d const*)a.data)[c0], tp);
+				});
+			double const* s((double const*)&tp);
+			return (s[0] + s[1]) + (s[2] + s[3]);
+		}
+		double norm2Square()const
+		{
+			return (*this, *this);
+		}
+		double norm2()const
+		{
+			return ::sqrt(norm2Square());
+		}
+		fixedVec& normalize()
+		{
+			double s(norm2());
+			if (s)(*this) /= s;
+			return *this;
+		}
+		void print()const
+		{
+			::printf("[");
+			for (unsigned long long c0(0); c0 < N - 1; ++c0)
+				::printf("%.16e, ", data[c0]);
+			::printf("%.16e]\n", data[N - 1]);
+		}
+	};
+	template<unsigned long long R, unsigned long long C>struct fixedMat
+	{
+		static constexpr unsigned long long width = C;
+		static constexpr unsigned long long height = R;
+		static constexpr unsigned long long width4d = ((C + 3) >> 2) << 2;
+		alignas(32) double data[R * width4d];
+
+		fixedMat()
+		{
+			unroll<R * width4d>([&](auto c0) { data[c0] = 0; });
+		}
+		fixedMat(std::initializer_list<std::initializer_list<double>>const& a) :fixedMat()
+		{
+			for (unsigned long long c0(0); c0 < R && c0 < a.size(); ++c0)
+				for (unsigned long long c1(0); c1 < C && c1 < a.begin()[c0].size(); ++c1)
+					data[c0 * width4d + c1] = a.begin()[c0].begin()[c1];
+		}
+		explicit fixedMat(mat const& a) :fixedMat()
+		{
+			for (unsigned long long c0(0); c0 < R && c0 < a.height; ++c0)
+				for (unsigned long long c1(0); c1 < C && c1 < a.width; ++c1)
+					data[c0 * width4d + c1] = a.data[c0 * a.width4d + c1];
+		}
+		inline double& operator()(unsigned long long a, unsigned long long b)
+		{
+			return data[a * width4d + b];
+		}
+		inline double operator()(unsigned long long a, unsigned long long b)const
+		{
+			return data[a * width4d + b];
+		}
+		//zero-copy
+		inline mat view()
+		{
+			return mat(data, C, R, Type::Parasitic, R == C ? MatType::SquareMat : MatType::NormalMat);
+		}
+		inline vec row(unsigned long long a)
+		{
+			return vec(data + a * width4d, C, Type::Parasitic);
+		}
+		inline fixedVec<C>& rowRef(unsigned long long a)
+		{
+			return *(fixedVec<C>*)(data + a * width4d);
+		}
+		inline fixedVec<C> const& rowRef(unsigned long long a)const
+		{
+			return *(fixedVec<C> const*)(data + a * width4d);
+		}
+		fixedMat& identity()
+		{
+			unroll<R * width4d>([&](auto c0) { data[c0] = 0; });
+			unroll<(R < C ? R : C)>([&](auto c0) { data[c0 * width4d + c0] = 1; });
+			return *this;
+		}
+		fixedMat& operator+=(fixedMat const& a)
+		{
+			unroll<R>([&](auto c0) { rowRef(c0) += a.rowRef(c0); });
+			return *this;
+		}
+		fixedMat& operator-=(fixedMat const& a)
+		{
+			unroll<R>([&](auto c0) { rowRef(c0) -= a.rowRef(c0); });
+			return *this;
+		}
+		fixedMat& operator*=(double a)
+		{
+			unroll<R>([&](auto c0) { rowRef(c0) *= a; });
+			return *this;
+		}
+		fixedMat<C, R> transposed()const
+		{
+			fixedMat<C, R> r;
+			unroll<R>([&](auto c0)
+				{
+					unroll<C>([&](auto c1) { r.data[c1 * r.width4d + c0] = data[c0 * width4d + c1]; });
+				});
+			return r;
+		}
+		//non-in-situ mult vec
+		fixedVec<R> operator()(fixedVec<C> const& a)const
+		{
+			fixedVec<R> r;
+			unroll<R>([&](auto c0) { r.data[c0] = (rowRef(c0), a); });
+			return r;
+		}
+		//non-in-situ mult mat
+		template<unsigned long long K>fixedMat<R, K> operator()(fixedMat<C, K> const& a)const
+		{
+			fixedMat<R, K> r;
+			constexpr unsigned long long K4(fixedMat<C, K>::width4d >> 2);
+			unroll<R>([&](auto c0)
+				{
+					__m256d ans[K4];
+					unroll<K4>([&](auto c2) { ans[c2] = _mm256_setzero_pd(); });
+					unroll<C>([&](auto c1)
+						{
+							__m256d tp(_mm256_set1_pd(data[c0 * width4d + c1]));
+							__m256d const* b((__m256d const*)(a.data + c1 * a.width4d));
+							unroll<K4>([&](auto c2) { ans[c2] = _mm256_fmadd_pd(tp, b[c2], ans[c2]); });
+						});
+					unroll<K4>([&](auto c2) { ((__m256d*)(r.data + c0 * r.width4d))[c2] = ans[c2]; });
+				});
+			return r;
+		}
+		//Cholesky only (no solving), only for square symmetric positive definite mat
+		//the lower part is replaced by L (A = L L^T)
+		fixedMat& solveCholesky()
+		{
+			static_assert(R == C, "solveCholesky needs a square fixedMat");
+			unroll<R>([&](auto c0)
+				{
+					double d(data[c0 * width4d + c0]);
+					unroll<c0>([&](auto c1) { d -= data[c0 * width4d + c1] * data[c0 * width4d + c1]; });
+					d = ::sqrt(d);
+					data[c0 * width4d + c0] = d;
+					double rd(1 / d);
+					unroll<R - c0 - 1>([&](auto c1)
+						{
+							constexpr unsigned long long c2(c0 + c1 + 1);
+							double s(data[c2 * width4d + c0]);
+							unroll<c0>([&](auto c3) { s -= data[c2 * width4d + c3] * data[c0 * width4d + c3]; });
+							data[c2 * width4d + c0] = s * rd;
+						});
+				});
+			return *this;
+		}
+		//Cholesky is already done
+		fixedVec<R> solveCholeskyAlread(fixedVec<R> const& a)const
+		{
+			static_assert(R == C, "solveCholeskyAlread needs a square fixedMat");
+			fixedVec<R> b(a);
+			unroll<R>([&](auto c0)
+				{
+					double s(b.data[c0]);
+					unroll<c0>([&](auto c1) { s -= data[c0 * width4d + c1] * b.data[c1]; });
+					b.data[c0] = s / data[c0 * width4d + c0];
+				});
+			unroll<R>([&](auto c)
+				{
+					constexpr unsigned long long c0(R - 1 - c);
+					double s(b.data[c0]);
+					unroll<R - c0 - 1>([&](auto c1)
+						{
+							constexpr unsigned long long c2(c0 + c1 + 1);
+							s -= data[c2 * width4d + c0] * b.data[c2];
+						});
+					b.data[c0] = s / data[c0 * width4d + c0];
+				});
+			return b;
+		}
+		//symmetric positive definite, changes the mat itself
+		fixedVec<R> solveCholesky(fixedVec<R> const& a)
+		{
+			solveCholesky();
+			return solveCholeskyAlread(a);
+		}
+		mat& copyTo(mat& a)const
+		{
+			if (a.width != C || a.height != R)a.reconstruct(C, R, false);
+			for (unsigned long long c0(0); c0 < R; ++c0)
+				memcpy64d(a.data + c0 * a.width4d, data + c0 * width4d, C);
+			return a;
+		}
+		void print()const
+		{
+			::printf("[\n");
+			for (unsigned long long c0(0); c0 < R; ++c0)
+			{
+				::printf("\t[%4.6f", data[c0 * width4d]);
+				for (unsigned long long c1(1); c1 < C; ++c1)
+					::printf(", %4.6f", data[c0 * width4d + c1]);
+				::printf("]\n");
+			}
+			::printf("]\n");
+		}
+	};
+
+	//LU with partial pivoting: P A = L U, L has unit diagonal, both stored in lu
+	//blocked right-looking, trailing update is a 4x8 register-tiled kernel run on all threads
+	//piv[c0] is the row swapped with row c0 at step c0 (same as LAPACK ipiv)
+	struct matLU
+	{
+		mat lu;
+		unsigned long long* piv;
+		unsigned long long dim;
+		unsigned long long blockSize;
+		double norm1;//1-norm of the original mat, for condition()
+		bool singular;
+
+		matLU() :lu(), piv(nullptr), dim(0), blockSize(64), norm1(0), singular(false) {}
+		matLU(mat const& a, unsigned long long _blockSize = 64)
+			:lu(), piv(nullptr), dim(0), blockSize(_blockSize), norm1(0), singular(false)
+		{
+			factor(a);
+		}
+		matLU(matCplx const& a, unsigned long long _blockSize = 64)
+			:lu(), piv(nullptr), dim(0), blockSize(_blockSize), norm1(0), singular(false)
+		{
+			factor(a);
+		}
+		matLU(matLU const&) = delete;
+		matLU(matLU&& a) :lu((mat&&)a.lu), piv(a.piv), dim(a.dim), blockSize(a.blockSize), norm1(a.norm1), singular(a.singular)
+		{
+			a.piv = nullptr;
+			a.dim = 0;
+		}
+		~matLU()
+		{
+			::free(piv);
+		}
+
+		//square part of a only, returns false if singular
+		bool factor(mat const& a)
+		{
+			unsigned long long n(a.width < a.height ? a.width : a.height);
+			if (a.matType >= MatType::BandMat || !n)return false;
+			if (n != dim)
+			{
+				::free(piv);
+				piv = (unsigned long long*)::malloc(n * sizeof(unsigned long long));
+				dim = n;
+			}
+			if (lu.width != n || lu.height != n)lu.reconstruct(n, n, false);
+			for (unsigned long long c0(0); c0 < n; ++c0)
+			{
+				memcpy64d(lu.data + c0 * lu.width4d, a.data + c0 * a.width4d, n);
+				for (unsigned long long c1(n); c1 < lu.width4d; ++c1)
+					lu.data[c0 * lu.width4d + c1] = 0;
+			}
+			return factorInPlace();
+		}
+		//complex mat mapped to real form [[re, -im], [im, re]]
+		bool factor(matCplx const& a)
+		{
+			unsigned long long n(a.re.width < a.re.height ? a.re.width : a.re.height);
+			if (a.matType >= MatType::BandMat || !n)return false;
+			if (2 * n != dim)
+			{
+				::free(piv);
+				piv = (unsigned long long*)::malloc(2 * n * sizeof(unsigned long long));
+				dim = 2 * n;
+			}
+			lu.reconstruct(2 * n, 2 * n, true);
+			for (unsigned long long c0(0); c0 < n; ++c0)
+			{
+				double* r0(lu.data + c0 * lu.width4d);
+				double* r1(lu.data + (c0 + n) * lu.width4d);
+				double const* sr(a.re.data + c0 * a.re.width4d);
+				double const* si(a.im.data + c0 * a.im.width4d);
+				for (unsigned long long c1(0); c1 < n; ++c1)
+				{
+					r0[c1] = sr[c1]; r0[c1 + n] = -si[c1];
+					r1[c1] = si[c1]; r1[c1 + n] = sr[c1];
+				}
+			}
+			return factorInPlace();
+		}
+
+		//b = A^-1 a
+		vec& solve(vec const& a, vec& b)const
+		{
+			if (!dim || a.dim < dim)return b;
+			if (b.dim < dim)
+			{
+				if (b.type == Type::Native)b.reconstruct(dim, false);
+				else return b;
+			}
+			if (&a != &b)memcpy64d(b.data + b.beginning, a.data + a.beginning, dim);
+			double* x(b.data + b.beginning);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+				if (piv[c0] != c0)
+				{
+					double t(x[c0]); x[c0] = x[piv[c0]]; x[piv[c0]] = t;
+				}
+			for (unsigned long long c0(1); c0 < dim; ++c0)
+				x[c0] -= dot64d(lu.data + c0 * lu.width4d, x, c0);
+			for (long long c0(dim - 1); c0 >= 0; --c0)
+			{
+				double const* r(lu.data + c0 * lu.width4d);
+				x[c0] = (x[c0] - dot64d(r + c0 + 1, x + c0 + 1, dim - c0 - 1)) / r[c0];
+			}
+			return b;
+		}
+		//b = A^-T a
+		vec& solveTrans(vec const& a, vec& b)const
+		{
+			if (!dim || a.dim < dim)return b;
+			if (b.dim < dim)
+			{
+				if (b.type == Type::Native)b.reconstruct(dim, false);
+				else return b;
+			}
+			if (&a != &b)memcpy64d(b.data + b.beginning, a.data + a.beginning, dim);
+			double* x(b.data + b.beginning);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				double const* r(lu.data + c0 * lu.width4d);
+				x[c0] /= r[c0];
+				fmadd64d(x + c0 + 1, -x[c0], r + c0 + 1, dim - c0 - 1);
+			}
+			for (long long c0(dim - 1); c0 > 0; --c0)
+				fmadd64d(x, -x[c0], lu.data + c0 * lu.width4d, c0);
+			for (unsigned long long c0(dim); c0-- > 0;)
+				if (piv[c0] != c0)
+				{
+					double t(x[c0]); x[c0] = x[piv[c0]]; x[piv[c0]] = t;
+				}
+			return b;
+		}
+		//multi-RHS: columns of a (dim x m) are the right hand sides, b = A^-1 a
+		mat& solve(mat const& a, mat& b)const
+		{
+			if (!dim || a.height < dim || a.matType >= MatType::BandMat)return b;
+			unsigned long long m(a.width);
+			if (b.width != m || b.height != dim)
+			{
+				if (b.type == Type::Native)b.reconstruct(m, dim, false);
+				else return b;
+			}
+			if (&a != &b)
+				for (unsigned long long c0(0); c0 < dim; ++c0)
+					memcpy64d(b.data + c0 * b.width4d, a.data + c0 * a.width4d, m);
+			constexpr unsigned long long tile(128);
+			parallelFor((m + tile - 1) / tile, [&](unsigned long long t, unsigned long long)
+				{
+					unsigned long long j0(t * tile);
+					unsigned long long len(m - j0 < tile ? m - j0 : tile);
+					double* x(b.data + j0);
+					unsigned long long w(b.width4d);
+					for (unsigned long long c0(0); c0 < dim; ++c0)
+						if (piv[c0] != c0)
+							for (unsigned long long c1(0); c1 < len; ++c1)
+							{
+								double tp(x[c0 * w + c1]);
+								x[c0 * w + c1] = x[piv[c0] * w + c1];
+								x[piv[c0] * w + c1] = tp;
+							}
+					for (unsigned long long c0(1); c0 < dim; ++c0)
+					{
+						double const* r(lu.data + c0 * lu.width4d);
+						for (unsigned long long c1(0); c1 < c0; ++c1)
+							if (r[c1] != 0)fmadd64d(x + c0 * w, -r[c1], x + c1 * w, len);
+					}
+					for (long long c0(dim - 1); c0 >= 0; --c0)
+					{
+						double const* r(lu.data + c0 * lu.width4d);
+						for (unsigned long long c1(c0 + 1); c1 < dim; ++c1)
+							if (r[c1] != 0)fmadd64d(x + c0 * w, -r[c1], x + c1 * w, len);
+						double s(1 / r[c0]);
+						for (unsigned long long c1(0); c1 < len; ++c1)
+							x[c0 * w + c1] *= s;
+					}
+				});
+			return b;
+		}
+		//complex rhs, only if factored from a matCplx
+		vecCplx& solve(vecCplx const& a, vecCplx& b)const
+		{
+			unsigned long long n(dim >> 1);
+			if (!n || a.dim < n)return b;
+			if (b.dim < n)
+			{
+				if (b.type == Type::Native)b.reconstruct(n, false);
+				else return b;
+			}
+			vec tp(dim, false);
+			memcpy64d(tp.data, a.re.data + a.re.beginning, n);
+			memcpy64d(tp.data + n, a.im.data + a.im.beginning, n);
+			solve(tp, tp);
+			memcpy64d(b.re.data + b.re.beginning, tp.data, n);
+			memcpy64d(b.im.data + b.im.beginning, tp.data + n, n);
+			return b;
+		}
+		//estimate of 1-norm condition number (Hager-Higham), 1/rcond
+		double condition()const
+		{
+			if (!dim)return 0;
+			if (singular)return INFINITY;
+			vec x(dim, false), y(dim, false), z(dim, false);
+			for (unsigned long long c0(0); c0 < dim; ++c0)x.data[c0] = 1.0 / dim;
+			double est(0);
+			unsigned long long last(dim);
+			for (unsigned long long c0(0); c0 < 5; ++c0)
+			{
+				solve(x, y);
+				est = 0;
+				for (unsigned long long c1(0); c1 < dim; ++c1)
+				{
+					est += abs(y.data[c1]);
+					z.data[c1] = y.data[c1] >= 0 ? 1 : -1;
+				}
+				solveTrans(z, z);
+				unsigned long long j(0);
+				double zmax(0), zx(0);
+				for (unsigned long long c1(0); c1 < dim; ++c1)
+				{
+					zx += z.data[c1] * x.data[c1];
+					if (abs(z.data[c1]) > zmax)
+					{
+						zmax = abs(z.data[c1]);
+						j = c1;
+					}
+				}
+				if (zmax <= zx || j == last)break;
+				memset64d(x.data, 0, dim);
+				x.data[j] = 1;
+				last = j;
+			}
+			return est * norm1;
+		}
+		//det of the factored real mat
+		double det()const
+		{
+			double s(1);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				s *= lu.data[c0 * lu.width4d + c0];
+				if (piv[c0] != c0)s = -s;
+			}
+			return s;
+		}
+
+	private:
+		//A(r0:r1, j0:j1) -= A(r0:r1, k0:k1) * A(k0:k1, j0:j1), j1 may run into the zero padding
+		void update(unsigned long long r0, unsigned long long r1, unsigned long long j0, unsigned long long j1,
+			unsigned long long k0, unsigned long long k1)
+		{
+			unsigned long long w(lu.width4d);
+			double* d(lu.data);
+			fnmaddMat64d(d + r0 * w + j0, w, d + r0 * w + k0, w, d + k0 * w + j0, w, r1 - r0, j1 - j0, k1 - k0);
+		}
+		bool factorInPlace()
+		{
+			unsigned long long n(dim), w(lu.width4d);
+			double* d(lu.data);
+			singular = false;
+			norm1 = 0;
+			for (unsigned long long c1(0); c1 < n; ++c1)
+			{
+				double s(0);
+				for (unsigned long long c0(0); c0 < n; ++c0)s += abs(d[c0 * w + c1]);
+				if (s > norm1)norm1 = s;
+			}
+			unsigned long long nb(blockSize ? blockSize : 64);
+			for (unsigned long long k(0); k < n; k += nb)
+			{
+				unsigned long long kEnd(k + nb < n ? k + nb : n);
+				//panel
+				for (unsigned long long c0(k); c0 < kEnd; ++c0)
+				{
+					unsigned long long p(c0);
+					double mx(abs(d[c0 * w + c0]));
+					for (unsigned long long c1(c0 + 1); c1 < n; ++c1)
+						if (abs(d[c1 * w + c0]) > mx)
+						{
+							mx = abs(d[c1 * w + c0]);
+							p = c1;
+						}
+					piv[c0] = p;
+					if (p != c0)
+					{
+						double* ra(d + c0 * w);
+						double* rb(d + p * w);
+						for (unsigned long long c1(0); c1 < w; c1 += 4)
+						{
+							__m256d t(_mm256_load_pd(ra + c1));
+							_mm256_store_pd(ra + c1, _mm256_load_pd(rb + c1));
+							_mm256_store_pd(rb + c1, t);
+						}
+					}
+					if (mx == 0)
+					{
+						singular = true;
+						continue;
+					}
+					double s(1 / d[c0 * w + c0]);
+					for (unsigned long long c1(c0 + 1); c1 < n; ++c1)
+					{
+						double l(d[c1 * w + c0] *= s);
+						if (l != 0)fmadd64d(d + c1 * w + c0 + 1, -l, d + c0 * w + c0 + 1, kEnd - c0 - 1);
+					}
+				}
+				if (kEnd == n)break;
+				//U12 = L11^-1 A12
+				constexpr unsigned long long tile(256);
+				unsigned long long cols(w - kEnd);
+				parallelFor((cols + tile - 1) / tile, [&](unsigned long long t, unsigned long long)
+					{
+						unsigned long long j0(kEnd + t * tile);
+						unsigned long long len(w - j0 < tile ? w - j0 : tile);
+						for (unsigned long long c0(k + 1); c0 < kEnd; ++c0)
+							for (unsigned long long c1(k); c1 < c0; ++c1)
+								fmadd64d(d + c0 * w + j0, -d[c0 * w + c1], d + c1 * w + j0, len);
+					});
+				//A22 -= L21 U12
+				constexpr unsigned long long rowTile(64);
+				unsigned long long rowTiles((n - kEnd + rowTile - 1) / rowTile);
+				unsigned long long colTiles((cols + tile - 1) / tile);
+				parallelFor(rowTiles * colTiles, [&](unsigned long long t, unsigned long long)
+					{
+						unsigned long long r0(kEnd + (t / colTiles) * rowTile);
+						unsigned long long j0(kEnd + (t % colTiles) * tile);
+						unsigned long long r1(r0 + rowTile < n ? r0 + rowTile : n);
+						unsigned long long j1(j0 + tile < w ? j0 + tile : w);
+						update(r0, r1, j0, j1, k, kEnd);
+					});
+			}
+			return !singular;
+		}
+	};
+
+	//Householder QR of a tall mat (height >= width): A = Q R
+	//TSQR: row blocks are factored independently on all threads, then their R are merged pairwise up a binary tree
+	//Householder vectors stay in qr (leaf blocks, LAPACK style with implicit 1) and in nodes (tree merges),
+	//the final R is in the upper part of the first width rows of qr
+	struct matQR
+	{
+		mat qr;
+		mat* nodes;//[R_a; R_b] of every merge, 2 * width rows
+		double* tau;//blocks * width for leaves, then nodeNum * width
+		unsigned long long* blockBegin;//blocks + 1
+		unsigned long long width;
+		unsigned long long height;
+		unsigned long long blocks;
+		unsigned long long nodeNum;
+
+		matQR() :qr(), nodes(nullptr), tau(nullptr), blockBegin(nullptr), width(0), height(0), blocks(0), nodeNum(0) {}
+		matQR(mat const& a) :matQR()
+		{
+			factor(a);
+		}
+		matQR(matQR const&) = delete;
+		~matQR()
+		{
+			release();
+		}
+
+		bool factor(mat const& a)
+		{
+			release();
+			if (a.matType >= MatType::BandMat || !a.width || a.height < a.width)return false;
+			width = a.width;
+			height = a.height;
+			qr = a;
+			unsigned long long n(width), w(qr.width4d);
+			unsigned long long leafRows(16384 / w);
+			if (leafRows < 2 * n)leafRows = 2 * n;
+			blocks = height / leafRows;
+			if (!blocks)blocks = 1;
+			nodeNum = blocks - 1;
+			blockBegin = (unsigned long long*)::malloc((blocks + 1) * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 <= blocks; ++c0)
+				blockBegin[c0] = c0 * height / blocks;
+			tau = malloc64d((blocks + nodeNum) * n);
+			if (nodeNum)nodes = new mat[nodeNum];
+			parallelFor(blocks, [&](unsigned long long b, unsigned long long)
+				{
+					double* base(qr.data + blockBegin[b] * w);
+					localQR([&](unsigned long long i) {return base + i * w; },
+						blockBegin[b + 1] - blockBegin[b], tau + b * n);
+				});
+			forEachLevel([&](unsigned long long node0, unsigned long long s, unsigned long long cnt)
+				{
+					parallelFor(cnt, [&](unsigned long long c0, unsigned long long)
+						{
+							mat& t(nodes[node0 + c0]);
+							t.reconstruct(n, 2 * n, true);
+							double* ra(qr.data + blockBegin[c0 * 2 * s] * w);
+							double* rb(qr.data + blockBegin[c0 * 2 * s + s] * w);
+							for (unsigned long long c1(0); c1 < n; ++c1)
+							{
+								memcpy64d(t.data + c1 * t.width4d + c1, ra + c1 * w + c1, n - c1);
+								memcpy64d(t.data + (c1 + n) * t.width4d + c1, rb + c1 * w + c1, n - c1);
+							}
+							localQR([&](unsigned long long i) {return t.data + i * t.width4d; },
+								2 * n, tau + (blocks + node0 + c0) * n);
+							for (unsigned long long c1(0); c1 < n; ++c1)
+								memcpy64d(ra + c1 * w + c1, t.data + c1 * t.width4d + c1, n - c1);
+						});
+				});
+			return true;
+		}
+		mat& R(mat& r)const
+		{
+			if (r.width != width || r.height != width)r.reconstruct(width, width, false);
+			for (unsigned long long c0(0); c0 < width; ++c0)
+			{
+				memset64d(r.data + c0 * r.width4d, 0, c0);
+				memcpy64d(r.data + c0 * r.width4d + c0, qr.data + c0 * qr.width4d + c0, width - c0);
+			}
+			return r;
+		}
+		//thin Q (height x width), orthonormal columns
+		mat& Q(mat& q)const
+		{
+			if (!width)return q;
+			if (q.width != width || q.height != height)q.reconstruct(width, height, false);
+			for (unsigned long long c0(0); c0 < height; ++c0)
+				memset64d(q.data + c0 * q.width4d, 0, q.width4d);
+			for (unsigned long long c0(0); c0 < width; ++c0)
+				q.data[c0 * q.width4d + c0] = 1;
+			applyQ(q.data, q.width4d, width);
+			return q;
+		}
+		//x = Q^T x in situ, rows of x (stride apart) hold k values each
+		//afterwards the first width rows are the projection, the rest is the residual (in no particular order)
+		void applyQT(double* x, unsigned long long stride, unsigned long long k)const
+		{
+			unsigned long long n(width), w(qr.width4d);
+			parallelFor(blocks, [&](unsigned long long b, unsigned long long)
+				{
+					double* base(qr.data + blockBegin[b] * w);
+					double* xb(x + blockBegin[b] * stride);
+					double* tp(malloc64d(k));
+					for (unsigned long long c0(0); c0 < n; ++c0)
+						reflect([&](unsigned long long i) {return base + i * w; },
+							[&](unsigned long long i) {return xb + i * stride; },
+							c0, blockBegin[b + 1] - blockBegin[b], tau[b * n + c0], k, tp);
+					_mm_free(tp);
+				});
+			forEachLevel([&](unsigned long long node0, unsigned long long s, unsigned long long cnt)
+				{
+					parallelFor(cnt, [&](unsigned long long c0, unsigned long long)
+						{
+							applyNode(x, stride, k, node0 + c0, c0 * 2 * s, c0 * 2 * s + s, false);
+						});
+				});
+		}
+		//x = Q x in situ
+		void applyQ(double* x, unsigned long long stride, unsigned long long k)const
+		{
+			unsigned long long n(width), w(qr.width4d);
+			unsigned long long levels(0);
+			while ((1llu << levels) < blocks)++levels;
+			for (long long l(levels - 1); l >= 0; --l)
+			{
+				unsigned long long s(1llu << l), node0(0);
+				for (unsigned long long c0(1); c0 < s; c0 <<= 1)node0 += (blocks - c0 - 1) / (2 * c0) + 1;
+				parallelFor((blocks - s - 1) / (2 * s) + 1, [&](unsigned long long c0, unsigned long long)
+					{
+						applyNode(x, stride, k, node0 + c0, c0 * 2 * s, c0 * 2 * s + s, true);
+					});
+			}
+			parallelFor(blocks, [&](unsigned long long b, unsigned long long)
+				{
+					double* base(qr.data + blockBegin[b] * w);
+					double* xb(x + blockBegin[b] * stride);
+					double* tp(malloc64d(k));
+					for (long long c0(n - 1); c0 >= 0; --c0)
+						reflect([&](unsigned long long i) {return base + i * w; },
+							[&](unsigned long long i) {return xb + i * stride; },
+							c0, blockBegin[b + 1] - blockBegin[b], tau[b * n + c0], k, tp);
+					_mm_free(tp);
+				});
+		}
+		//least squares: b = argmin |A b - a|
+		vec& solve(vec const& a, vec& b)const
+		{
+			if (!width || a.dim < height)return b;
+			if (b.dim < width)
+			{
+				if (b.type == Type::Native)b.reconstruct(width, false);
+				else return b;
+			}
+			vec tp(height, false);
+			memcpy64d(tp.data, a.data + a.beginning, height);
+			applyQT(tp.data, 1, 1);
+			double* x(b.data + b.beginning);
+			for (long long c0(width - 1); c0 >= 0; --c0)
+			{
+				double const* r(qr.data + c0 * qr.width4d);
+				x[c0] = (tp.data[c0] - dot64d(r + c0 + 1, x + c0 + 1, width - c0 - 1)) / r[c0];
+			}
+			return b;
+		}
+		//least squares for every column of a (height x k), b is width x k
+		mat& solve(mat const& a, mat& b)const
+		{
+			if (!width || a.height < height || a.matType >= MatType::BandMat)return b;
+			unsigned long long k(a.width);
+			mat tp(a);
+			applyQT(tp.data, tp.width4d, k);
+			if (b.width != k || b.height != width)
+			{
+				if (b.type == Type::Native)b.reconstruct(k, width, false);
+				else return b;
+			}
+			for (long long c0(width - 1); c0 >= 0; --c0)
+			{
+				double const* r(qr.data + c0 * qr.width4d);
+				double* x(b.data + c0 * b.width4d);
+				memcpy64d(x, tp.data + c0 * tp.width4d, k);
+				for (unsigned long long c1(c0 + 1); c1 < width; ++c1)
+					fmadd64d(x, -r[c1], b.data + c1 * b.width4d, k);
+				double s(1 / r[c0]);
+				for (unsigned long long c1(0); c1 < k; ++c1)x[c1] *= s;
+			}
+			return b;
+		}
+
+	private:
+		void release()
+		{
+			delete[] nodes;
+			nodes = nullptr;
+			::free(blockBegin);
+			blockBegin = nullptr;
+			if (tau)_mm_free(tau);
+			tau = nullptr;
+			blocks = nodeNum = 0;
+		}
+		//f(first node, half stride, node count) for every merge level, bottom up
+		template<class F>void forEachLevel(F&& f)const
+		{
+			unsigned long long node0(0);
+			for (unsigned long long s(1); s < blocks; s <<= 1)
+			{
+				unsigned long long cnt((blocks - s - 1) / (2 * s) + 1);
+				f(node0, s, cnt);
+				node0 += cnt;
+			}
+		}
+		//apply reflector c of rows v (len rows) to rows x (k values each), tp is scratch of k
+		template<class V, class X>static void reflect(V const& v, X const& x, unsigned long long c,
+			unsigned long long len, double t, unsigned long long k, double* tp)
+		{
+			if (t == 0)return;
+			memcpy64d(tp, x(c), k);
+			for (unsigned long long c0(c + 1); c0 < len; ++c0)
+				fmadd64d(tp, v(c0)[c], x(c0), k);
+			fmadd64d(x(c), -t, tp, k);
+			for (unsigned long long c0(c + 1); c0 < len; ++c0)
+				fmadd64d(x(c0), -t * v(c0)[c], tp, k);
+		}
+		//unblocked Householder QR of len rows given by a(i), width columns
+		template<class A>void localQR(A const& a, unsigned long long len, double* t)const
+		{
+			unsigned long long n(width);
+			double* tp(malloc64d(n));
+			for (unsigned long long c0(0); c0 < n && c0 < len; ++c0)
+			{
+				double alpha(a(c0)[c0]), sigma(0);
+				for (unsigned long long c1(c0 + 1); c1 < len; ++c1)
+					sigma += a(c1)[c0] * a(c1)[c0];
+				if (sigma == 0)
+				{
+					t[c0] = 0;
+					continue;
+				}
+				double beta(-copysign(::sqrt(alpha * alpha + sigma), alpha));
+				t[c0] = (beta - alpha) / beta;
+				double s(1 / (alpha - beta));
+				for (unsigned long long c1(c0 + 1); c1 < len; ++c1)
+					a(c1)[c0] *= s;
+				a(c0)[c0] = beta;
+				reflect(a, [&](unsigned long long i) {return a(i) + c0 + 1; }, c0, len, t[c0], n - c0 - 1, tp);
+			}
+			_mm_free(tp);
+		}
+		//merge node acting on the first width rows of blocks ba and bb
+		void applyNode(double* x, unsigned long long stride, unsigned long long k,
+			unsigned long long node, unsigned long long ba, unsigned long long bb, bool forward)const
+		{
+			unsigned long long n(width);
+			mat const& t(nodes[node]);
+			double* xa(x + blockBegin[ba] * stride);
+			double* xb(x + blockBegin[bb] * stride);
+			auto v = [&](unsigned long long i) {return t.data + i * t.width4d; };
+			auto xr = [&](unsigned long long i) {return i < n ? xa + i * stride : xb + (i - n) * stride; };
+			double* tp(malloc64d(k));
+			double const* tn(tau + (blocks + node) * n);
+			if (forward)
+				for (long long c0(n - 1); c0 >= 0; --c0)reflect(v, xr, c0, 2 * n, tn[c0], k, tp);
+			else
+				for (unsigned long long c0(0); c0 < n; ++c0)reflect(v, xr, c0, 2 * n, tn[c0], k, tp);
+			_mm_free(tp);
+		}
+	};
+
+	//symmetric indefinite LDL^T with Bunch-Kaufman pivoting: P A P^T = L D L^T
+	//D has 1x1 and 2x2 blocks, L (unit) and D are in the lower part of ld, P is the swap list piv
+	//pivType[c0] is 1 for a 1x1 block, 2 for the first row of a 2x2 block and 0 for its second row
+	struct matLDLT
+	{
+		mat ld;
+		unsigned long long* piv;
+		unsigned char* pivType;
+		unsigned long long dim;
+		bool singular;
+
+		matLDLT() :ld(), piv(nullptr), pivType(nullptr), dim(0), singular(false) {}
+		matLDLT(mat const& a, double shift = 0) :matLDLT()
+		{
+			factor(a, shift);
+		}
+		matLDLT(matLDLT const&) = delete;
+		matLDLT(matLDLT&& a) :ld((mat&&)a.ld), piv(a.piv), pivType(a.pivType), dim(a.dim), singular(a.singular)
+		{
+			a.piv = nullptr;
+			a.pivType = nullptr;
+			a.dim = 0;
+		}
+		~matLDLT()
+		{
+			::free(piv);
+			::free(pivType);
+		}
+		matLDLT& operator=(matLDLT&& a)
+		{
+			::free(piv);
+			::free(pivType);
+			ld = (mat&&)a.ld;
+			piv = a.piv;
+			pivType = a.pivType;
+			dim = a.dim;
+			singular = a.singular;
+			a.piv = nullptr;
+			a.pivType = nullptr;
+			a.dim = 0;
+			return *this;
+		}
+
+		//factors A - shift * I (square part of a, a must be symmetric), returns false if singular
+		bool factor(mat const& a, double shift = 0)
+		{
+			unsigned long long n(a.width < a.height ? a.width : a.height);
+			if (a.matType >= MatType::BandMat || !n)return false;
+			if (n != dim)
+			{
+				::free(piv);
+				::free(pivType);
+				piv = (unsigned long long*)::malloc(n * sizeof(unsigned long long));
+				pivType = (unsigned char*)::malloc(n);
+				dim = n;
+			}
+			if (ld.width != n || ld.height != n)ld.reconstruct(n, n, false);
+			unsigned long long w(ld.width4d);
+			double* d(ld.data);
+			for (unsigned long long c0(0); c0 < n; ++c0)
+			{
+				memcpy64d(d + c0 * w, a.data + c0 * a.width4d, n);
+				d[c0 * w + c0] -= shift;
+			}
+			singular = false;
+			//blocked like LAPACK sytrf (lower): a panel of nb columns is factored against its own delayed update,
+			//column k of the trailing matrix is read as row k of its upper triangle (updated at the end of every
+			//panel), L and D go to the lower part; W = L D of the panel is kept transposed in wt (row p is column p)
+			double const alpha((1 + ::sqrt(17.0)) / 8);
+			unsigned long long nb(n < 64 ? n : 64);
+			mat wt(n, nb, false);
+			unsigned long long lw(wt.width4d);
+			double g[64];
+			//x[k1, n) -= L_{[k1, n), [k0, k1)} W_{c, [k0, k1)}^T: the delayed update of column c of A
+			auto column = [&](double* x, unsigned long long c, unsigned long long k0, unsigned long long k1)
+			{
+				if (k1 == k0)return;
+				for (unsigned long long c0(k0); c0 < k1; ++c0)g[c0 - k0] = wt.data[(c0 - k0) * lw + c];
+				for (unsigned long long c0(k1); c0 < n; ++c0)x[c0] -= dot64d(d + c0 * w + k0, g, k1 - k0);
+			};
+			unsigned long long k(0);
+			while (k < n)
+			{
+				unsigned long long k0(k);
+				bool last(n - k0 <= nb);
+				while (k < n && (last || k - k0 + 1 < nb))
+				{
+					unsigned long long p(k - k0);
+					double* wk(wt.data + p * lw);
+					//column k of A - L W^T
+					memcpy64d(wk + k, d + k * w + k, n - k);
+					column(wk, k, k0, k);
+					double absakk(abs(wk[k])), colmax(0);
+					unsigned long long imax(k);
+					for (unsigned long long c0(k + 1); c0 < n; ++c0)
+						if (abs(wk[c0]) > colmax)
+						{
+							colmax = abs(wk[c0]);
+							imax = c0;
+						}
+					unsigned long long kp(k), kstep(1);
+					if (absakk == 0 && colmax == 0)
+					{
+						singular = true;
+						piv[k] = k;
+						pivType[k] = 1;
+						for (unsigned long long c0(k); c0 < n; ++c0)d[c0 * w + k] = 0;
+						++k;
+						continue;
+					}
+					if (absakk < alpha * colmax)
+					{
+						//column imax of A - L W^T into the next row of wt
+						double* wi(wk + lw);
+						for (unsigned long long c0(k); c0 < imax; ++c0)wi[c0] = d[c0 * w + imax];
+						memcpy64d(wi + imax, d + imax * w + imax, n - imax);
+						column(wi, imax, k0, k);
+						double rowmax(0);
+						for (unsigned long long c0(k); c0 < n; ++c0)
+							if (c0 != imax && abs(wi[c0]) > rowmax)rowmax = abs(wi[c0]);
+						if (absakk * rowmax < alpha * colmax * colmax)
+						{
+							kp = imax;
+							if (abs(wi[imax]) < alpha * rowmax)kstep = 2;
+							else memcpy64d(wk + k, wi + k, n - k);
+						}
+					}
+					unsigned long long kk(k + kstep - 1);
+					if (kp != kk)
+					{
+						//the pivot column is in wt already, only kp needs the old column kk
+						d[kp * w + kp] = d[kk * w + kk];
+						for (unsigned long long c0(kk + 1); c0 < kp; ++c0)d[c0 * w + kp] = d[kk * w + c0];
+						memcpy64d(d + kp * w + kp + 1, d + kk * w + kp + 1, n - kp - 1);
+						for (unsigned long long c0(0); c0 < kk; ++c0)
+						{
+							double t(d[kk * w + c0]); d[kk * w + c0] = d[kp * w + c0]; d[kp * w + c0] = t;
+						}
+						for (unsigned long long c0(0); c0 <= kk - k0; ++c0)
+						{
+							double* r(wt.data + c0 * lw);
+							double t(r[kk]); r[kk] = r[kp]; r[kp] = t;
+						}
+					}
+					piv[kk] = kp;
+					if (kstep == 1)
+					{
+						piv[k] = kp;
+						pivType[k] = 1;
+						double r(1 / wk[k]);
+						d[k * w + k] = wk[k];
+						for (unsigned long long c0(k + 1); c0 < n; ++c0)d[c0 * w + k] = wk[c0] * r;
+					}
+					else
+					{
+						piv[k] = k;
+						pivType[k] = 2;
+						pivType[k + 1] = 0;
+						double const* wi(wk + lw);
+						double a0(wk[k]), b0(wk[k + 1]), c0(wi[k + 1]);
+						double rdet(1 / (a0 * c0 - b0 * b0));
+						for (unsigned long long c1(k + 2); c1 < n; ++c1)
+						{
+							double u(wk[c1]), v(wi[c1]);
+							d[c1 * w + k] = (u * c0 - v * b0) * rdet;
+							d[c1 * w + k + 1] = (v * a0 - u * b0) * rdet;
+						}
+						d[k * w + k] = a0;
+						d[(k + 1) * w + k] = b0;
+						d[(k + 1) * w + k + 1] = c0;
+					}
+					k += kstep;
+				}
+				if (k == n)break;
+				//upper triangle of the trailing matrix -= L W^T, diagonal tiles in full (their lower part is scratch)
+				constexpr unsigned long long tile(128);
+				unsigned long long m(n - k), tiles((m + tile - 1) / tile);
+				parallelFor(tiles * (tiles + 1) / 2, [&](unsigned long long t, unsigned long long)
+					{
+						unsigned long long r(0);
+						while (t >= tiles - r)t -= tiles - r++;
+						unsigned long long r0(k + r * tile), c0(r0 + t * tile);
+						unsigned long long r1(r0 + tile < n ? r0 + tile : n), c1(c0 + tile < n ? c0 + tile : n);
+						fnmaddMat64d(d + r0 * w + c0, w, d + r0 * w + k0, w, wt.data + c0, lw, r1 - r0, c1 - c0, k - k0);
+					}, m >= 512 ? 0 : 1);
+			}
+			return !singular;
+		}
+		//b = (A - shift)^-1 a, a and b may be the same
+		vec& solve(vec const& a, vec& b)const
+		{
+			if (!dim || a.dim < dim)return b;
+			if (b.dim < dim)
+			{
+				if (b.type == Type::Native)b.reconstruct(dim, false);
+				else return b;
+			}
+			if (&a != &b)memcpy64d(b.data + b.beginning, a.data + a.beginning, dim);
+			double* x(b.data + b.beginning);
+			unsigned long long w(ld.width4d);
+			double const* d(ld.data);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+				if (piv[c0] != c0)
+				{
+					double t(x[c0]); x[c0] = x[piv[c0]]; x[piv[c0]] = t;
+				}
+			for (unsigned long long c0(0); c0 < dim; c0 += pivType[c0])
+			{
+				unsigned long long s(pivType[c0]);
+				for (unsigned long long c1(c0 + s); c1 < dim; ++c1)
+				{
+					x[c1] -= d[c1 * w + c0] * x[c0];
+					if (s == 2)x[c1] -= d[c1 * w + c0 + 1] * x[c0 + 1];
+				}
+			}
+			for (unsigned long long c0(0); c0 < dim; c0 += pivType[c0])
+			{
+				if (pivType[c0] == 1)x[c0] /= d[c0 * w + c0];
+				else
+				{
+					double a0(d[c0 * w + c0]), b0(d[(c0 + 1) * w + c0]), c1(d[(c0 + 1) * w + c0 + 1]);
+					double rdet(1 / (a0 * c1 - b0 * b0));
+					double x0(x[c0]), x1(x[c0 + 1]);
+					x[c0] = (c1 * x0 - b0 * x1) * rdet;
+					x[c0 + 1] = (a0 * x1 - b0 * x0) * rdet;
+				}
+			}
+			for (long long c0(dim - 1); c0 >= 0; --c0)
+			{
+				unsigned long long c1(c0);
+				if (!pivType[c0])c1 = c0 - 1;
+				//L^T: column c0 of L is below its block
+				unsigned long long beg(pivType[c1] == 2 ? c1 + 2 : c1 + 1);
+				double s(0);
+				for (unsigned long long c2(beg); c2 < dim; ++c2)s += d[c2 * w + c0] * x[c2];
+				x[c0] -= s;
+			}
+			for (unsigned long long c0(dim); c0-- > 0;)
+				if (piv[c0] != c0)
+				{
+					double t(x[c0]); x[c0] = x[piv[c0]]; x[piv[c0]] = t;
+				}
+			return b;
+		}
+		//number of negative eigenvalues of A - shift (Sylvester's law of inertia)
+		unsigned long long negativeNum()const
+		{
+			unsigned long long cnt(0);
+			unsigned long long w(ld.width4d);
+			for (unsigned long long c0(0); c0 < dim; c0 += pivType[c0])
+			{
+				if (pivType[c0] == 1)cnt += ld.data[c0 * w + c0] < 0;
+				else
+				{
+					double a0(ld.data[c0 * w + c0]), b0(ld.data[(c0 + 1) * w + c0]), c1(ld.data[(c0 + 1) * w + c0 + 1]);
+					double det(a0 * c1 - b0 * b0);
+					if (det < 0)cnt += 1;
+					else if (a0 + c1 < 0)cnt += 2;
+				}
+			}
+			return cnt;
+		}
+	};
+	//eigenvectors of a symmetric mat from known eigenvalues by shift-invert
+	//close eigenvalues form a cluster that is solved as a block (inverse subspace iteration
+	//with reorthogonalisation and Rayleigh-Ritz), so degenerate eigenvectors come out orthogonal
+	//one factor of A - shift per cluster, shared by all of its vectors and iterations
+	struct shiftInvertEigen
+	{
+		mat const& a;
+		matLDLT ldlt;
+		double scale;//inf norm of a
+		double clusterTol;//relative to scale
+		double tol;//relative residual
+		unsigned long long maxIter;
+
+		shiftInvertEigen(mat const& _a, double _clusterTol = 1e-6, double _tol = 1e-12)
+			:
+			a(_a),
+			ldlt(),
+			scale(0),
+			clusterTol(_clusterTol),
+			tol(_tol),
+			maxIter(20)
+		{
+			unsigned long long n(a.width < a.height ? a.width : a.height);
+			for (unsigned long long c0(0); c0 < n; ++c0)
+			{
+				double s(0);
+				for (unsigned long long c1(0); c1 < n; ++c1)s += abs(a.data[c0 * a.width4d + c1]);
+				if (s > scale)scale = s;
+			}
+			if (scale == 0)scale = 1;
+		}
+		shiftInvertEigen(shiftInvertEigen const&) = delete;
+
+		//factor of A - shift
+		matLDLT& factor(double shift)
+		{
+			//never sit exactly on an eigenvalue
+			double s(shift + 1e-10 * scale);
+			while (!ldlt.factor(a, s))s += 1e-8 * scale;
+			return ldlt;
+		}
+		//eigenvectors in rows, row c0 belongs to eigenvalues[c0]
+		mat& eigenvectors(vec const& eigenvalues, mat& eigenvectors)
+		{
+			unsigned long long n(a.width < a.height ? a.width : a.height);
+			unsigned long long m(eigenvalues.dim);
+			if (!n || !m)return eigenvectors;
+			if (eigenvectors.width < n || eigenvectors.height < m)
+			{
+				if (eigenvectors.type == Type::Native)eigenvectors.reconstruct(n, m, false);
+				else return eigenvectors;
+			}
+			unsigned long long* idx((unsigned long long*)::malloc(m * sizeof(unsigned long long)));
+			for (unsigned long long c0(0); c0 < m; ++c0)idx[c0] = c0;
+			double const* ev(eigenvalues.data + eigenvalues.beginning);
+			for (unsigned long long c0(1); c0 < m; ++c0)
+			{
+				unsigned long long t(idx[c0]);
+				long long c1(c0 - 1);
+				for (; c1 >= 0 && ev[idx[c1]] > ev[t]; --c1)idx[c1 + 1] = idx[c1];
+				idx[c1 + 1] = t;
+			}
+			std::mt19937 mt(0);
+			std::uniform_real_distribution<double> rd(-1, 1);
+			unsigned long long done(0);
+			while (done < m)
+			{
+				unsigned long long k(1);
+				while (done + k < m && ev[idx[done + k]] - ev[idx[done + k - 1]] <= clusterTol * scale)++k;
+				double shift(0);
+				for (unsigned long long c0(0); c0 < k; ++c0)shift += ev[idx[done + c0]];
+				shift /= k;
+				matLDLT& f(factor(shift));
+				mat x(n, k, false), y(n, k, false);
+				for (unsigned long long c0(0); c0 < k; ++c0)
+				{
+					vec tp(x.data + c0 * x.width4d, n, Type::Parasitic);
+					for (unsigned long long c1(0); c1 < n; ++c1)tp.data[c1] = rd(mt);
+				}
+				orthonormalize(x, eigenvectors, idx, done);
+				matBatch h(k, k, 1, false), theta, v;
+				for (unsigned long long c0(0); c0 < maxIter; ++c0)
+				{
+					for (unsigned long long c1(0); c1 < k; ++c1)
+					{
+						vec tp(x.data + c1 * x.width4d, n, Type::Parasitic);
+						f.solve(tp, tp);
+					}
+					orthonormalize(x, eigenvectors, idx, done);
+					//Rayleigh-Ritz
+					for (unsigned long long c1(0); c1 < k; ++c1)
+					{
+						vec tx(x.data + c1 * x.width4d, n, Type::Parasitic);
+						vec ty(y.data + c1 * y.width4d, n, Type::Parasitic);
+						a(tx, ty);
+					}
+					for (unsigned long long c1(0); c1 < k; ++c1)
+						for (unsigned long long c2(0); c2 < k; ++c2)
+							h(0, c1, c2) = dot64d(x.data + c1 * x.width4d, y.data + c2 * y.width4d, n);
+					h.eigenSymmetric(theta, v, 1e-15);
+					mat xr(n, k, true), yr(n, k, true);
+					for (unsigned long long c1(0); c1 < k; ++c1)
+						for (unsigned long long c2(0); c2 < k; ++c2)
+						{
+							fmadd64d(xr.data + c1 * xr.width4d, v(0, c1, c2), x.data + c2 * x.width4d, n);
+							fmadd64d(yr.data + c1 * yr.width4d, v(0, c1, c2), y.data + c2 * y.width4d, n);
+						}
+					x = (mat&&)xr;
+					double res(0);
+					for (unsigned long long c1(0); c1 < k; ++c1)
+					{
+						vec ty(yr.data + c1 * yr.width4d, n, Type::Parasitic);
+						ty.fmadd(-theta(0, c1, 0), vec(x.data + c1 * x.width4d, n, Type::Parasitic));
+						double r(ty.norm2());
+						if (r > res)res = r;
+					}
+					if (res <= tol * scale)break;
+				}
+				//ascending Ritz values go to ascending eigenvalues of the cluster
+				for (unsigned long long c0(0); c0 < k; ++c0)
+				{
+					unsigned long long c2(0);
+					for (unsigned long long c1(0); c1 < k; ++c1)
+						if (theta(0, c1, 0) < theta(0, c0, 0) || (theta(0, c1, 0) == theta(0, c0, 0) && c1 < c0))++c2;
+					memcpy64d(eigenvectors.data + idx[done + c2] * eigenvectors.width4d, x.data + c0 * x.width4d, n);
+				}
+				done += k;
+			}
+			::free(idx);
+			return eigenvectors;
+		}
+
+	private:
+		//Gram-Schmidt twice against the rows idx[0, done) of e and then within x
+		void orthonormalize(mat& x, mat const& e, unsigned long long const* idx, unsigned long long done)const
+		{
+			unsigned long long n(x.width);
+			for (unsigned long long c0(0); c0 < x.height; ++c0)
+			{
+				double* p(x.data + c0 * x.width4d);
+				for (unsigned long long c3(0); c3 < 2; ++c3)
+				{
+					for (unsigned long long c1(0); c1 < done; ++c1)
+					{
+						double const* q(e.data + idx[c1] * e.width4d);
+						fmadd64d(p, -dot64d(p, q, n), q, n);
+					}
+					for (unsigned long long c1(0); c1 < c0; ++c1)
+					{
+						double const* q(x.data + c1 * x.width4d);
+						fmadd64d(p, -dot64d(p, q, n), q, n);
+					}
+				}
+				double s(::sqrt(dot64d(p, p, n)));
+				if (s)
+				{
+					s = 1 / s;
+					for (unsigned long long c1(0); c1 < n; ++c1)p[c1] *= s;
+				}
+			}
+		}
+	};
+	inline mat& mat::inversePowerEigenvectors(vec const& eigenvalues, mat& eigenvectors)
+	{
+		if (width && eigenvalues.dim)
+			shiftInvertEigen(*this).eigenvectors(eigenvalues, eigenvectors);
+		return eigenvectors;
+	}
+
+	//symmetric reordering of a square SparseMat (COO sorted by row, symmetric pattern)
+	//perm[new] = old, iperm[old] = new
+	struct matOrdering
+	{
+		unsigned long long* perm;
+		unsigned long long* iperm;
+		unsigned long long dim;
+
+		matOrdering() :perm(nullptr), iperm(nullptr), dim(0) {}
+		//reverse Cuthill-McKee by default
+		matOrdering(mat const& a, unsigned long long _dim, bool _minimumDegree = false) :matOrdering()
+		{
+			if (_minimumDegree)minimumDegree(a, _dim);
+			else reverseCuthillMcKee(a, _dim);
+		}
+		matOrdering(matOrdering const&) = delete;
+		matOrdering(matOrdering&& a) :perm(a.perm), iperm(a.iperm), dim(a.dim)
+		{
+			a.perm = a.iperm = nullptr;
+			a.dim = 0;
+		}
+		~matOrdering()
+		{
+			::free(perm);
+			::free(iperm);
+		}
+
+		void identity(unsigned long long _dim)
+		{
+			alloc(_dim);
+			for (unsigned long long c0(0); c0 < dim; ++c0)perm[c0] = iperm[c0] = c0;
+		}
+		//bandwidth reduction, every connected component starts from a pseudo-peripheral node
+		matOrdering& reverseCuthillMcKee(mat const& a, unsigned long long _dim)
+		{
+			alloc(_dim);
+			if (!dim)return *this;
+			unsigned long long* bgn;
+			unsigned long long* adj;
+			graph(a, bgn, adj);
+			unsigned long long* level((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* queue((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			for (unsigned long long c0(0); c0 < dim; ++c0)iperm[c0] = dim;
+			auto degree = [&](unsigned long long v) {return bgn[v + 1] - bgn[v]; };
+			//breadth first search from s over unnumbered nodes, returns the eccentricity of s
+			unsigned long long stamp(0);
+			for (unsigned long long c0(0); c0 < dim; ++c0)level[c0] = 0;
+			auto bfs = [&](unsigned long long s, unsigned long long& last)
+			{
+				++stamp;
+				unsigned long long head(0), tail(0), depth(0), levelBegin(0), levelEnd(1);
+				queue[tail++] = s;
+				level[s] = stamp;
+				while (head < tail)
+				{
+					if (head == levelEnd)
+					{
+						++depth;
+						levelBegin = head;
+						levelEnd = tail;
+					}
+					unsigned long long v(queue[head++]);
+					for (unsigned long long c0(bgn[v]); c0 < bgn[v + 1]; ++c0)
+					{
+						unsigned long long u(adj[c0]);
+						if (iperm[u] == dim && level[u] != stamp)
+						{
+							level[u] = stamp;
+							queue[tail++] = u;
+						}
+					}
+				}
+				//the last level node with the smallest degree
+				last = queue[levelBegin];
+				for (unsigned long long c0(levelBegin + 1); c0 < tail; ++c0)
+					if (degree(queue[c0]) < degree(last))last = queue[c0];
+				return depth;
+			};
+			unsigned long long n(0);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				if (iperm[c0] != dim)continue;
+				//pseudo-peripheral node (George-Liu)
+				unsigned long long s(c0), last;
+				for (unsigned long long c1(c0 + 1); c1 < dim; ++c1)
+					if (iperm[c1] == dim && degree(c1) < degree(s))s = c1;
+				unsigned long long ecc(bfs(s, last));
+				for (unsigned long long c1(0); c1 < 8; ++c1)
+				{
+					unsigned long long last1;
+					unsigned long long ecc1(bfs(last, last1));
+					if (ecc1 <= ecc)break;
+					s = last;
+					ecc = ecc1;
+					last = last1;
+				}
+				//Cuthill-McKee from s, neighbours by increasing degree
+				unsigned long long head(n);
+				perm[n] = s;
+				iperm[s] = n++;
+				while (head < n)
+				{
+					unsigned long long v(perm[head++]);
+					unsigned long long first(n);
+					for (unsigned long long c1(bgn[v]); c1 < bgn[v + 1]; ++c1)
+					{
+						unsigned long long u(adj[c1]);
+						if (iperm[u] == dim)
+						{
+							perm[n] = u;
+							iperm[u] = n++;
+						}
+					}
+					for (unsigned long long c1(first + 1); c1 < n; ++c1)
+					{
+						unsigned long long u(perm[c1]);
+						long long c2(c1 - 1);
+						for (; c2 >= long long(first) && degree(perm[c2]) > degree(u); --c2)perm[c2 + 1] = perm[c2];
+						perm[c2 + 1] = u;
+					}
+				}
+			}
+			for (unsigned long long c0(0); c0 < dim / 2; ++c0)
+			{
+				unsigned long long t(perm[c0]);
+				perm[c0] = perm[dim - 1 - c0];
+				perm[dim - 1 - c0] = t;
+			}
+			for (unsigned long long c0(0); c0 < dim; ++c0)iperm[perm[c0]] = c0;
+			::free(level);
+			::free(queue);
+			::free(bgn);
+			::free(adj);
+			return *this;
+		}
+		//fill reduction for sparse factorisation: minimum degree on the explicit elimination graph
+		matOrdering& minimumDegree(mat const& a, unsigned long long _dim)
+		{
+			alloc(_dim);
+			if (!dim)return *this;
+			unsigned long long* bgn;
+			unsigned long long* adj;
+			graph(a, bgn, adj);
+			std::vector<std::vector<unsigned long long>> g(dim);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+				g[c0].assign(adj + bgn[c0], adj + bgn[c0 + 1]);
+			::free(bgn);
+			::free(adj);
+			std::priority_queue<std::pair<unsigned long long, unsigned long long>,
+				std::vector<std::pair<unsigned long long, unsigned long long>>,
+				std::greater<std::pair<unsigned long long, unsigned long long>>> heap;
+			for (unsigned long long c0(0); c0 < dim; ++c0)heap.push({ g[c0].size(), c0 });
+			for (unsigned long long c0(0); c0 < dim; ++c0)iperm[c0] = dim;
+			std::vector<unsigned long long> merged;
+			unsigned long long n(0);
+			while (n < dim)
+			{
+				auto top(heap.top());
+				heap.pop();
+				unsigned long long v(top.second);
+				if (iperm[v] != dim || top.first != g[v].size())continue;
+				perm[n] = v;
+				iperm[v] = n++;
+				std::vector<unsigned long long>& nv(g[v]);
+				for (unsigned long long u : nv)
+				{
+					//adj(u) = adj(u) + adj(v) - {u, v}
+					std::vector<unsigned long long>& nu(g[u]);
+					merged.clear();
+					std::set_union(nu.begin(), nu.end(), nv.begin(), nv.end(), std::back_inserter(merged));
+					nu.clear();
+					for (unsigned long long w : merged)
+						if (w != u && w != v)nu.push_back(w);
+					heap.push({ nu.size(), u });
+				}
+				std::vector<unsigned long long>().swap(nv);
+			}
+			return *this;
+		}
+		//fill reduction for grid-like graphs: recursive bisection by level structures (George),
+		//the middle level of a breadth first search from a pseudo-peripheral node is the separator,
+		//both halves are numbered first and the separator last
+		matOrdering& nestedDissection(mat const& a, unsigned long long _dim, unsigned long long leafSize = 64)
+		{
+			alloc(_dim);
+			if (!dim)return *this;
+			unsigned long long* bgn;
+			unsigned long long* adj;
+			graph(a, bgn, adj);
+			unsigned long long* nodes((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* tp((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* owner((unsigned long long*)::calloc(dim, sizeof(unsigned long long)));
+			unsigned long long* seen((unsigned long long*)::calloc(dim, sizeof(unsigned long long)));
+			unsigned long long* level((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* queue((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			for (unsigned long long c0(0); c0 < dim; ++c0)nodes[c0] = c0;
+			unsigned long long task(0), stamp(0);
+			//returns the depth, tail is the number of reached nodes, last is a far node of small degree
+			auto bfs = [&](unsigned long long s, unsigned long long& tail, unsigned long long& last)
+			{
+				++stamp;
+				unsigned long long head(0), depth(0), levelBegin(0), levelEnd(1);
+				tail = 0;
+				queue[tail++] = s;
+				seen[s] = stamp;
+				level[s] = 0;
+				while (head < tail)
+				{
+					if (head == levelEnd)
+					{
+						++depth;
+						levelBegin = head;
+						levelEnd = tail;
+					}
+					unsigned long long v(queue[head++]);
+					for (unsigned long long c0(bgn[v]); c0 < bgn[v + 1]; ++c0)
+					{
+						unsigned long long u(adj[c0]);
+						if (owner[u] == task && seen[u] != stamp)
+						{
+							seen[u] = stamp;
+							level[u] = level[v] + 1;
+							queue[tail++] = u;
+						}
+					}
+				}
+				last = queue[levelBegin];
+				for (unsigned long long c0(levelBegin + 1); c0 < tail; ++c0)
+					if (bgn[queue[c0] + 1] - bgn[queue[c0]] < bgn[last + 1] - bgn[last])last = queue[c0];
+				return depth;
+			};
+			std::vector<std::pair<unsigned long long, unsigned long long>> stack;
+			stack.push_back({ 0, dim });
+			while (stack.size())
+			{
+				unsigned long long off(stack.back().first), cnt(stack.back().second);
+				stack.pop_back();
+				if (!cnt)continue;
+				++task;
+				for (unsigned long long c0(off); c0 < off + cnt; ++c0)owner[nodes[c0]] = task;
+				unsigned long long depth(0), reached(0), last(nodes[off]);
+				if (cnt > leafSize)
+				{
+					depth = bfs(nodes[off], reached, last);
+					for (unsigned long long c0(0); c0 < 2 && reached == cnt; ++c0)
+					{
+						unsigned long long last1;
+						depth = bfs(last, reached, last1);
+						last = last1;
+					}
+				}
+				if (cnt > leafSize && reached < cnt)
+				{
+					//disconnected: the reached component and the rest
+					unsigned long long n0(0), n1(reached);
+					for (unsigned long long c0(off); c0 < off + cnt; ++c0)
+					{
+						unsigned long long v(nodes[c0]);
+						tp[seen[v] == stamp ? n0++ : n1++] = v;
+					}
+					memcpy(nodes + off, tp, cnt * sizeof(unsigned long long));
+					stack.push_back({ off, reached });
+					stack.push_back({ off + reached, cnt - reached });
+					continue;
+				}
+				if (cnt <= leafSize || depth < 2)
+				{
+					for (unsigned long long c0(off); c0 < off + cnt; ++c0)perm[c0] = nodes[c0];
+					continue;
+				}
+				unsigned long long mid(depth / 2);
+				//separator nodes without a neighbour beyond the separator join the near half
+				for (unsigned long long c0(off); c0 < off + cnt; ++c0)
+				{
+					unsigned long long v(nodes[c0]);
+					if (level[v] != mid)continue;
+					bool far(false);
+					for (unsigned long long c1(bgn[v]); c1 < bgn[v + 1] && !far; ++c1)
+						far = owner[adj[c1]] == task && level[adj[c1]] == mid + 1;
+					if (!far)level[v] = mid - 1;
+				}
+				unsigned long long na(0), nb(0);
+				for (unsigned long long c0(off); c0 < off + cnt; ++c0)
+				{
+					unsigned long long l(level[nodes[c0]]);
+					if (l < mid)++na;
+					else if (l > mid)++nb;
+				}
+				unsigned long long ia(0), ib(na), is(na + nb);
+				for (unsigned long long c0(off); c0 < off + cnt; ++c0)
+				{
+					unsigned long long v(nodes[c0]), l(level[v]);
+					tp[l < mid ? ia++ : (l > mid ? ib++ : is++)] = v;
+				}
+				memcpy(nodes + off, tp, cnt * sizeof(unsigned long long));
+				for (unsigned long long c0(off + na + nb); c0 < off + cnt; ++c0)perm[c0] = nodes[c0];
+				stack.push_back({ off, na });
+				stack.push_back({ off + na, nb });
+			}
+			for (unsigned long long c0(0); c0 < dim; ++c0)iperm[perm[c0]] = c0;
+			::free(nodes);
+			::free(tp);
+			::free(owner);
+			::free(seen);
+			::free(level);
+			::free(queue);
+			::free(bgn);
+			::free(adj);
+			return *this;
+		}
+		//half band width of a under this ordering
+		unsigned long long halfBandWidth(mat const& a)const
+		{
+			unsigned long long hb(0);
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+			{
+				unsigned long long r(iperm[a.rowIndice[c0]]), c(iperm[a.colIndice[c0]]);
+				unsigned long long d(r > c ? r - c : c - r);
+				if (d > hb)hb = d;
+			}
+			return hb;
+		}
+		//P A P^T into the narrowest LBandMat
+		mat& toLBand(mat const& a, mat& b)const
+		{
+			unsigned long long hb(halfBandWidth(a));
+			b = mat(hb, dim, MatType::LBandMat, true);
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+			{
+				unsigned long long r(iperm[a.rowIndice[c0]]), c(iperm[a.colIndice[c0]]);
+				if (c <= r)b.LBandEleRef(r, c) += a.data[c0];
+			}
+			return b;
+		}
+		//P A P^T as SparseMat, sorted by row then column
+		mat& toSparse(mat const& a, mat& b)const
+		{
+			mat r(MatType::SparseMat, a.elementNum);
+			unsigned long long* cnt((unsigned long long*)::calloc(dim + 1, sizeof(unsigned long long)));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+				cnt[iperm[a.rowIndice[c0]] + 1]++;
+			for (unsigned long long c0(0); c0 < dim; ++c0)cnt[c0 + 1] += cnt[c0];
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+			{
+				unsigned long long row(iperm[a.rowIndice[c0]]);
+				unsigned long long p(cnt[row]++);
+				r.rowIndice[p] = row;
+				r.colIndice[p] = iperm[a.colIndice[c0]];
+				r.data[p] = a.data[c0];
+			}
+			unsigned long long c1(0);
+			for (unsigned long long c0(0); c0 < a.elementNum; c0 = c1)
+			{
+				for (c1 = c0 + 1; c1 < a.elementNum && r.rowIndice[c1] == r.rowIndice[c0]; ++c1);
+				for (unsigned long long c2(c0 + 1); c2 < c1; ++c2)
+				{
+					unsigned long long tc(r.colIndice[c2]);
+					double td(r.data[c2]);
+					long long c3(c2 - 1);
+					for (; c3 >= long long(c0) && r.colIndice[c3] > tc; --c3)
+					{
+						r.colIndice[c3 + 1] = r.colIndice[c3];
+						r.data[c3 + 1] = r.data[c3];
+					}
+					r.colIndice[c3 + 1] = tc;
+					r.data[c3 + 1] = td;
+				}
+			}
+			::free(cnt);
+			b = (mat&&)r;
+			return b;
+		}
+		//b = P a (b[new] = a[old])
+		vec& permute(vec const& a, vec& b)const
+		{
+			if (a.dim < dim)return b;
+			if (b.dim < dim)
+			{
+				if (b.type == Type::Native)b.reconstruct(dim, false);
+				else return b;
+			}
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+				b.data[b.beginning + c0] = a.data[a.beginning + perm[c0]];
+			return b;
+		}
+		//b = P^T a (b[old] = a[new])
+		vec& permuteBack(vec const& a, vec& b)const
+		{
+			if (a.dim < dim)return b;
+			if (b.dim < dim)
+			{
+				if (b.type == Type::Native)b.reconstruct(dim, false);
+				else return b;
+			}
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+				b.data[b.beginning + perm[c0]] = a.data[a.beginning + c0];
+			return b;
+		}
+
+	private:
+		void alloc(unsigned long long _dim)
+		{
+			if (_dim != dim)
+			{
+				::free(perm);
+				::free(iperm);
+				perm = (unsigned long long*)::malloc(_dim * sizeof(unsigned long long));
+				iperm = (unsigned long long*)::malloc(_dim * sizeof(unsigned long long));
+				dim = _dim;
+			}
+		}
+		//symmetric adjacency without self loops (CSR, sorted, unique)
+		void graph(mat const& a, unsigned long long*& bgn, unsigned long long*& adj)const
+		{
+			bgn = (unsigned long long*)::calloc(dim + 1, sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+				if (a.rowIndice[c0] != a.colIndice[c0])
+				{
+					bgn[a.rowIndice[c0] + 1]++;
+					bgn[a.colIndice[c0] + 1]++;
+				}
+			for (unsigned long long c0(0); c0 < dim; ++c0)bgn[c0 + 1] += bgn[c0];
+			adj = (unsigned long long*)::malloc((bgn[dim] ? bgn[dim] : 1) * sizeof(unsigned long long));
+			unsigned long long* pos((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			memcpy(pos, bgn, dim * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+				if (a.rowIndice[c0] != a.colIndice[c0])
+				{
+					adj[pos[a.rowIndice[c0]]++] = a.colIndice[c0];
+					adj[pos[a.colIndice[c0]]++] = a.rowIndice[c0];
+				}
+			unsigned long long n(0);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				std::sort(adj + bgn[c0], adj + bgn[c0 + 1]);
+				unsigned long long b0(n);
+				for (unsigned long long c1(bgn[c0]); c1 < bgn[c0 + 1]; ++c1)
+					if (n == b0 || adj[n - 1] != adj[c1])adj[n++] = adj[c1];
+				bgn[c0] = b0;
+			}
+			bgn[dim] = n;
+			::free(pos);
+		}
+	};
+
+	//supernodal multifrontal Cholesky of a sparse SPD SparseMat (full symmetric pattern): P A P^T = L L^T
+	//nested dissection + postordered elimination tree, fundamental supernodes, dense fronts factored
+	//with AVX2 kernels, independent subtrees on all threads (big fronts use all threads themselves)
+	//analyze() once per pattern, factor() for new values on that pattern, solve() for any number of RHS
+	struct sparseCholesky
+	{
+		matOrdering ordering;
+		unsigned long long dim;
+		unsigned long long superNum;
+		unsigned long long* superBegin;//superNum + 1, first column of every supernode
+		unsigned long long* superParent;//superNum for a root
+		unsigned long long* childBegin;//superNum + 1
+		unsigned long long* child;
+		unsigned long long* rowBegin;//superNum + 1
+		unsigned long long* rows;//columns of the supernode and then the rows below, ascending
+		unsigned long long* lBegin;//superNum + 1
+		double* l;//panel of every supernode: rows x columns, row major
+		unsigned long long* entryBegin;//superNum + 1
+		unsigned long long* entry;//index in a of every lower entry, grouped by supernode
+		unsigned long long* levelBegin;//supernodes grouped by height in the supernode tree
+		unsigned long long* levelSuper;
+		unsigned long long levelNum;
+		std::atomic<bool> positive;
+
+		sparseCholesky()
+			:
+			ordering(), dim(0), superNum(0), superBegin(nullptr), superParent(nullptr),
+			childBegin(nullptr), child(nullptr), rowBegin(nullptr), rows(nullptr),
+			lBegin(nullptr), l(nullptr), entryBegin(nullptr), entry(nullptr),
+			levelBegin(nullptr), levelSuper(nullptr), levelNum(0), positive(false)
+		{
+		}
+		sparseCholesky(mat const& a, unsigned long long _dim) :sparseCholesky()
+		{
+			analyze(a, _dim);
+			factor(a);
+		}
+		sparseCholesky(sparseCholesky const&) = delete;
+		~sparseCholesky()
+		{
+			release();
+		}
+
+		//symbolic part: ordering, elimination tree, supernodes and the structure of L
+		void analyze(mat const& a, unsigned long long _dim)
+		{
+			release();
+			dim = _dim;
+			if (!dim || a.matType != MatType::SparseMat)return;
+			ordering.nestedDissection(a, dim);
+			unsigned long long* parent((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* cBgn;
+			unsigned long long* cRow;
+			//postorder the elimination tree so that every subtree is contiguous
+			pattern(a, cBgn, cRow);
+			etree(cBgn, cRow, parent);
+			{
+				unsigned long long* head((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+				unsigned long long* next((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+				unsigned long long* stack((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+				unsigned long long* post((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+				for (unsigned long long c0(0); c0 < dim; ++c0)head[c0] = dim;
+				for (long long c0(dim - 1); c0 >= 0; --c0)
+					if (parent[c0] != dim)
+					{
+						next[c0] = head[parent[c0]];
+						head[parent[c0]] = c0;
+					}
+				unsigned long long k(0);
+				for (unsigned long long c0(0); c0 < dim; ++c0)
+				{
+					if (parent[c0] != dim)continue;
+					unsigned long long top(0);
+					stack[top++] = c0;
+					while (top)
+					{
+						unsigned long long v(stack[top - 1]);
+						if (head[v] == dim)
+						{
+							post[k++] = v;
+							--top;
+						}
+						else
+						{
+							unsigned long long u(head[v]);
+							head[v] = next[u];
+							stack[top++] = u;
+						}
+					}
+				}
+				for (unsigned long long c0(0); c0 < dim; ++c0)next[c0] = ordering.perm[post[c0]];
+				memcpy(ordering.perm, next, dim * sizeof(unsigned long long));
+				for (unsigned long long c0(0); c0 < dim; ++c0)ordering.iperm[ordering.perm[c0]] = c0;
+				::free(head);
+				::free(next);
+				::free(stack);
+				::free(post);
+			}
+			::free(cBgn);
+			::free(cRow);
+			pattern(a, cBgn, cRow);
+			etree(cBgn, cRow, parent);
+			//column structures and fundamental supernodes
+			unsigned long long* childNum((unsigned long long*)::calloc(dim, sizeof(unsigned long long)));
+			unsigned long long* head((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* next((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* colCount((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			unsigned long long* superOf((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			for (unsigned long long c0(0); c0 < dim; ++c0)head[c0] = dim;
+			for (long long c0(dim - 1); c0 >= 0; --c0)
+				if (parent[c0] != dim)
+				{
+					childNum[parent[c0]]++;
+					next[c0] = head[parent[c0]];
+					head[parent[c0]] = c0;
+				}
+			std::vector<std::vector<unsigned long long>> cs(dim);
+			std::vector<unsigned long long> sBegin, rBegin, rowList;
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				std::vector<unsigned long long>& s(cs[c0]);
+				s.assign(cRow + cBgn[c0], cRow + cBgn[c0 + 1]);
+				for (unsigned long long c1(head[c0]); c1 != dim; c1 = next[c1])
+				{
+					for (unsigned long long r : cs[c1])if (r != c0)s.push_back(r);
+					std::vector<unsigned long long>().swap(cs[c1]);
+				}
+				std::sort(s.begin(), s.end());
+				s.erase(std::unique(s.begin(), s.end()), s.end());
+				colCount[c0] = s.size();
+				if (!(c0 && parent[c0 - 1] == c0 && childNum[c0] == 1 && colCount[c0 - 1] == colCount[c0] + 1))
+				{
+					sBegin.push_back(c0);
+					rBegin.push_back(rowList.size());
+					rowList.push_back(c0);
+					rowList.insert(rowList.end(), s.begin(), s.end());
+				}
+				superOf[c0] = sBegin.size() - 1;
+			}
+			std::vector<std::vector<unsigned long long>>().swap(cs);
+			superNum = sBegin.size();
+			superBegin = (unsigned long long*)::malloc((superNum + 1) * sizeof(unsigned long long));
+			rowBegin = (unsigned long long*)::malloc((superNum + 1) * sizeof(unsigned long long));
+			memcpy(superBegin, sBegin.data(), superNum * sizeof(unsigned long long));
+			memcpy(rowBegin, rBegin.data(), superNum * sizeof(unsigned long long));
+			superBegin[superNum] = dim;
+			rowBegin[superNum] = rowList.size();
+			rows = (unsigned long long*)::malloc(rowList.size() * sizeof(unsigned long long));
+			memcpy(rows, rowList.data(), rowList.size() * sizeof(unsigned long long));
+			superParent = (unsigned long long*)::malloc(superNum * sizeof(unsigned long long));
+			lBegin = (unsigned long long*)::malloc((superNum + 1) * sizeof(unsigned long long));
+			lBegin[0] = 0;
+			for (unsigned long long c0(0); c0 < superNum; ++c0)
+			{
+				unsigned long long p(parent[superBegin[c0 + 1] - 1]);
+				superParent[c0] = p == dim ? superNum : superOf[p];
+				lBegin[c0 + 1] = lBegin[c0] + (rowBegin[c0 + 1] - rowBegin[c0]) * (superBegin[c0 + 1] - superBegin[c0]);
+			}
+			l = malloc64d(lBegin[superNum] ? lBegin[superNum] : 1);
+			//supernode tree: children and heights
+			childBegin = (unsigned long long*)::calloc(superNum + 1, sizeof(unsigned long long));
+			child = (unsigned long long*)::malloc((superNum ? superNum : 1) * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < superNum; ++c0)
+				if (superParent[c0] != superNum)childBegin[superParent[c0] + 1]++;
+			for (unsigned long long c0(0); c0 < superNum; ++c0)childBegin[c0 + 1] += childBegin[c0];
+			memcpy(head, childBegin, superNum * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < superNum; ++c0)
+				if (superParent[c0] != superNum)child[head[superParent[c0]]++] = c0;
+			unsigned long long* height((unsigned long long*)::calloc(superNum, sizeof(unsigned long long)));
+			levelNum = 0;
+			for (unsigned long long c0(0); c0 < superNum; ++c0)
+			{
+				if (height[c0] + 1 > levelNum)levelNum = height[c0] + 1;
+				if (superParent[c0] != superNum && height[superParent[c0]] < height[c0] + 1)
+					height[superParent[c0]] = height[c0] + 1;
+			}
+			levelBegin = (unsigned long long*)::calloc(levelNum + 1, sizeof(unsigned long long));
+			levelSuper = (unsigned long long*)::malloc((superNum ? superNum : 1) * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < superNum; ++c0)levelBegin[height[c0] + 1]++;
+			for (unsigned long long c0(0); c0 < levelNum; ++c0)levelBegin[c0 + 1] += levelBegin[c0];
+			memcpy(head, levelBegin, levelNum * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < superNum; ++c0)levelSuper[head[height[c0]]++] = c0;
+			//lower entries of a by supernode
+			entryBegin = (unsigned long long*)::calloc(superNum + 1, sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+			{
+				unsigned long long r(ordering.iperm[a.rowIndice[c0]]), c(ordering.iperm[a.colIndice[c0]]);
+				if (r >= c)entryBegin[superOf[c] + 1]++;
+			}
+			for (unsigned long long c0(0); c0 < superNum; ++c0)entryBegin[c0 + 1] += entryBegin[c0];
+			entry = (unsigned long long*)::malloc((entryBegin[superNum] ? entryBegin[superNum] : 1) * sizeof(unsigned long long));
+			memcpy(head, entryBegin, superNum * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+			{
+				unsigned long long r(ordering.iperm[a.rowIndice[c0]]), c(ordering.iperm[a.colIndice[c0]]);
+				if (r >= c)entry[head[superOf[c]]++] = c0;
+			}
+			::free(height);
+			::free(childNum);
+			::free(head);
+			::free(next);
+			::free(colCount);
+			::free(superOf);
+			::free(parent);
+			::free(cBgn);
+			::free(cRow);
+		}
+		//numeric part, a must have the pattern given to analyze(), returns false if not positive definite
+		bool factor(mat const& a)
+		{
+			if (!superNum)return false;
+			unsigned long long threads(threadNum());
+			double** update((double**)::calloc(superNum, sizeof(double*)));
+			positive = true;
+			for (unsigned long long c0(0); c0 < levelNum; ++c0)
+			{
+				unsigned long long n(levelBegin[c0 + 1] - levelBegin[c0]);
+				unsigned long long const* s(levelSuper + levelBegin[c0]);
+				if (n >= 2 * threads)
+					parallelFor(n, [&](unsigned long long c1, unsigned long long)
+						{
+							front(a, s[c1], update, 1);
+						});
+				else
+					for (unsigned long long c1(0); c1 < n; ++c1)
+						front(a, s[c1], update, 0);
+			}
+			::free(update);
+			return positive;
+		}
+		//b = A^-1 a, a and b may be the same
+		vec& solve(vec const& a, vec& b)const
+		{
+			if (!superNum || a.dim < dim)return b;
+			if (b.dim < dim)
+			{
+				if (b.type == Type::Native)b.reconstruct(dim, false);
+				else return b;
+			}
+			double* x(malloc64d(dim));
+			for (unsigned long long c0(0); c0 < dim; ++c0)x[c0] = a.data[a.beginning + ordering.perm[c0]];
+			solvePermuted(x);
+			for (unsigned long long c0(0); c0 < dim; ++c0)b.data[b.beginning + ordering.perm[c0]] = x[c0];
+			_mm_free(x);
+			return b;
+		}
+		//multi-RHS: every column of a (dim x k) is a right hand side
+		//columns go through the substitutions in blocks, so every entry of L is loaded once per block
+		mat& solve(mat const& a, mat& b)const
+		{
+			if (!superNum || a.height < dim || a.matType >= MatType::BandMat)return b;
+			unsigned long long k(a.width);
+			if (&a != &b && (b.width != k || b.height != dim))
+			{
+				if (b.type == Type::Native)b.reconstruct(k, dim, false);
+				else return b;
+			}
+			constexpr unsigned long long block(32);
+			unsigned long long threads(threadNum());
+			unsigned long long bs((k + threads - 1) / threads);
+			bs = bs < block ? (bs > 4 ? ceiling4(bs) : bs) : block;
+			parallelFor((k + bs - 1) / bs, [&](unsigned long long c0, unsigned long long)
+				{
+					unsigned long long k0(c0 * bs), kb(k0 + bs < k ? bs : k - k0);
+					double* x(malloc64d(dim * bs));
+					for (unsigned long long c1(0); c1 < dim; ++c1)
+						memcpy64d(x + c1 * bs, a.data + ordering.perm[c1] * a.width4d + k0, kb);
+					solvePermuted(x, kb, bs);
+					for (unsigned long long c1(0); c1 < dim; ++c1)
+						memcpy64d(b.data + ordering.perm[c1] * b.width4d + k0, x + c1 * bs, kb);
+					_mm_free(x);
+				});
+			return b;
+		}
+		//entries in L
+		unsigned long long nonZeros()const
+		{
+			unsigned long long s(0);
+			for (unsigned long long c0(0); c0 < superNum; ++c0)
+			{
+				unsigned long long nc(superBegin[c0 + 1] - superBegin[c0]);
+				s += lBegin[c0 + 1] - lBegin[c0] - nc * (nc - 1) / 2;
+			}
+			return s;
+		}
+
+	private:
+		void release()
+		{
+			::free(superBegin);
+			::free(superParent);
+			::free(childBegin);
+			::free(child);
+			::free(rowBegin);
+			::free(rows);
+			::free(lBegin);
+			if (l)_mm_free(l);
+			::free(entryBegin);
+			::free(entry);
+			::free(levelBegin);
+			::free(levelSuper);
+			superBegin = superParent = childBegin = child = rowBegin = rows = lBegin = nullptr;
+			entryBegin = entry = levelBegin = levelSuper = nullptr;
+			l = nullptr;
+			superNum = levelNum = 0;
+		}
+		//rows below the diagonal of every column of P A P^T (CSC, sorted, unique)
+		void pattern(mat const& a, unsigned long long*& bgn, unsigned long long*& row)const
+		{
+			unsigned long long const* ip(ordering.iperm);
+			bgn = (unsigned long long*)::calloc(dim + 1, sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+			{
+				unsigned long long r(ip[a.rowIndice[c0]]), c(ip[a.colIndice[c0]]);
+				if (r != c)bgn[(r < c ? r : c) + 1]++;
+			}
+			for (unsigned long long c0(0); c0 < dim; ++c0)bgn[c0 + 1] += bgn[c0];
+			row = (unsigned long long*)::malloc((bgn[dim] ? bgn[dim] : 1) * sizeof(unsigned long long));
+			unsigned long long* pos((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			memcpy(pos, bgn, dim * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)
+			{
+				unsigned long long r(ip[a.rowIndice[c0]]), c(ip[a.colIndice[c0]]);
+				if (r != c)row[pos[r < c ? r : c]++] = r < c ? c : r;
+			}
+			unsigned long long n(0);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				std::sort(row + bgn[c0], row + bgn[c0 + 1]);
+				unsigned long long b0(n);
+				for (unsigned long long c1(bgn[c0]); c1 < bgn[c0 + 1]; ++c1)
+					if (n == b0 || row[n - 1] != row[c1])row[n++] = row[c1];
+				bgn[c0] = b0;
+			}
+			bgn[dim] = n;
+			::free(pos);
+		}
+		//elimination tree (Liu) from the column pattern, dim for a root
+		void etree(unsigned long long const* bgn, unsigned long long const* row, unsigned long long* parent)const
+		{
+			//row k of the lower part is needed, so walk the columns and bucket by row
+			unsigned long long* rBgn((unsigned long long*)::calloc(dim + 1, sizeof(unsigned long long)));
+			for (unsigned long long c0(0); c0 < bgn[dim]; ++c0)rBgn[row[c0] + 1]++;
+			for (unsigned long long c0(0); c0 < dim; ++c0)rBgn[c0 + 1] += rBgn[c0];
+			unsigned long long* col((unsigned long long*)::malloc((bgn[dim] ? bgn[dim] : 1) * sizeof(unsigned long long)));
+			unsigned long long* pos((unsigned long long*)::malloc(dim * sizeof(unsigned long long)));
+			memcpy(pos, rBgn, dim * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+				for (unsigned long long c1(bgn[c0]); c1 < bgn[c0 + 1]; ++c1)
+					col[pos[row[c1]]++] = c0;
+			unsigned long long* ancestor(pos);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				parent[c0] = dim;
+				ancestor[c0] = dim;
+				for (unsigned long long c1(rBgn[c0]); c1 < rBgn[c0 + 1]; ++c1)
+				{
+					unsigned long long r(col[c1]);
+					while (r != dim && r != c0)
+					{
+						unsigned long long t(ancestor[r]);
+						ancestor[r] = c0;
+						if (t == dim)parent[r] = c0;
+						r = t;
+					}
+				}
+			}
+			::free(rBgn);
+			::free(col);
+			::free(pos);
+		}
+		//dense partial Cholesky of the first nc columns of the m x m front f (lower part, stride w)
+		//the trailing part becomes the Schur complement
+		bool partialCholesky(double* f, unsigned long long w, unsigned long long m, unsigned long long nc,
+			unsigned long long threads)const
+		{
+			constexpr unsigned long long panel(32);
+			bool ok(true);
+			double tk[panel];
+			double* t(malloc64d(panel * w));
+			for (unsigned long long kb(0); kb < nc; kb += panel)
+			{
+				unsigned long long ke(kb + panel < nc ? kb + panel : nc);
+				for (unsigned long long k(kb); k < ke; ++k)
+				{
+					double d(f[k * w + k]);
+					if (!(d > 0))
+					{
+						ok = false;
+						d = 1e-300;
+					}
+					d = ::sqrt(d);
+					f[k * w + k] = d;
+					double r(1 / d);
+					unsigned long long len(ke - k - 1);
+					for (unsigned long long c0(0); c0 < len; ++c0)
+						tk[c0] = f[(k + 1 + c0) * w + k] *= r;
+					for (unsigned long long c0(k + 1 + len); c0 < m; ++c0)
+						f[c0 * w + k] *= r;
+					if (len)
+						for (unsigned long long c0(k + 1); c0 < m; ++c0)
+							fmadd64d(f + c0 * w + k + 1, -f[c0 * w + k], tk, c0 < ke ? c0 - k : len);
+				}
+				if (ke == m)continue;
+				unsigned long long mt(m - ke), tw1(ceiling4(mt));
+				for (unsigned long long k(kb); k < ke; ++k)
+					for (unsigned long long c0(0); c0 < mt; ++c0)
+						t[(k - kb) * tw1 + c0] = f[(ke + c0) * w + k];
+				constexpr unsigned long long rowTile(64), colTile(256);
+				parallelFor((mt + rowTile - 1) / rowTile, [&](unsigned long long c0, unsigned long long)
+					{
+						unsigned long long i0(ke + c0 * rowTile);
+						unsigned long long i1(i0 + rowTile < m ? i0 + rowTile : m);
+						for (unsigned long long j0(ke); j0 < i1; j0 += colTile)
+						{
+							unsigned long long j1(j0 + colTile < i1 ? j0 + colTile : i1);
+							fnmaddMat64d(f + i0 * w + j0, w, f + i0 * w + kb, w, t + (j0 - ke), tw1,
+								i1 - i0, j1 - j0, ke - kb);
+						}
+					}, threads);
+			}
+			_mm_free(t);
+			return ok;
+		}
+		//assemble, factor and pass on the Schur complement of supernode s
+		//rows of s are ascending and every child's update rows are a subset of them, so a front only
+		//needs a scratch of its own size for the local indices, not a dense map over all of dim
+		void front(mat const& a, unsigned long long s, double** update, unsigned long long threads)
+		{
+			unsigned long long f0(superBegin[s]), nc(superBegin[s + 1] - f0);
+			unsigned long long const* r(rows + rowBegin[s]);
+			unsigned long long m(rowBegin[s + 1] - rowBegin[s]), w(ceiling4(m));
+			double* f(malloc64d(m * w));
+			unsigned long long* rel((unsigned long long*)::malloc(m * sizeof(unsigned long long)));
+			memset64d(f, 0, m * w);
+			for (unsigned long long c0(entryBegin[s]); c0 < entryBegin[s + 1]; ++c0)
+			{
+				unsigned long long e(entry[c0]);
+				unsigned long long ri(ordering.iperm[a.rowIndice[e]]), ci(ordering.iperm[a.colIndice[e]]);
+				unsigned long long i(std::lower_bound(r, r + m, ri) - r), j(ci - f0);
+				f[i * w + j] += a.data[e];
+			}
+			//extend-add
+			for (unsigned long long c0(childBegin[s]); c0 < childBegin[s + 1]; ++c0)
+			{
+				unsigned long long c(child[c0]);
+				unsigned long long ncc(superBegin[c + 1] - superBegin[c]);
+				unsigned long long du(rowBegin[c + 1] - rowBegin[c] - ncc);
+				unsigned long long const* rc(rows + rowBegin[c] + ncc);
+				double* u(update[c]);
+				if (!u)continue;
+				for (unsigned long long c1(0), c2(0); c1 < du; ++c1)
+				{
+					while (r[c2] != rc[c1])++c2;
+					rel[c1] = c2;
+				}
+				for (unsigned long long c1(0); c1 < du; ++c1)
+				{
+					double* fr(f + rel[c1] * w);
+					for (unsigned long long c2(0); c2 <= c1; ++c2)
+						fr[rel[c2]] += u[c1 * du + c2];
+				}
+				_mm_free(u);
+				update[c] = nullptr;
+			}
+			::free(rel);
+			if (!partialCholesky(f, w, m, nc, threads))positive = false;
+			double* lp(l + lBegin[s]);
+			for (unsigned long long c0(0); c0 < m; ++c0)
+			{
+				memcpy64d(lp + c0 * nc, f + c0 * w, nc);
+				for (unsigned long long c1(c0 + 1); c1 < nc; ++c1)lp[c0 * nc + c1] = 0;
+			}
+			unsigned long long du(m - nc);
+			if (du && superParent[s] != superNum)
+			{
+				double* u(malloc64d(du * du));
+				for (unsigned long long c0(0); c0 < du; ++c0)
+					memcpy64d(u + c0 * du, f + (nc + c0) * w + nc, c0 + 1);
+				update[s] = u;
+			}
+			_mm_free(f);
+		}
+		//L L^T x = x in the permuted numbering
+		void solvePermuted(double* x)const
+		{
+			for (unsigned long long s(0); s < superNum; ++s)
+			{
+				unsigned long long f0(superBegin[s]), nc(superBegin[s + 1] - f0);
+				unsigned long long const* r(rows + rowBegin[s]);
+				unsigned long long m(rowBegin[s + 1] - rowBegin[s]);
+				double const* lp(l + lBegin[s]);
+				double* xs(x + f0);
+				for (unsigned long long c0(0); c0 < nc; ++c0)
+					xs[c0] = (xs[c0] - dot64d(lp + c0 * nc, xs, c0)) / lp[c0 * nc + c0];
+				for (unsigned long long c0(nc); c0 < m; ++c0)
+					x[r[c0]] -= dot64d(lp + c0 * nc, xs, nc);
+			}
+			for (long long s(superNum - 1); s >= 0; --s)
+			{
+				unsigned long long f0(superBegin[s]), nc(superBegin[s + 1] - f0);
+				unsigned long long const* r(rows + rowBegin[s]);
+				unsigned long long m(rowBegin[s + 1] - rowBegin[s]);
+				double const* lp(l + lBegin[s]);
+				double* xs(x + f0);
+				for (unsigned long long c0(nc); c0 < m; ++c0)
+					fmadd64d(xs, -x[r[c0]], lp + c0 * nc, nc);
+				for (long long c0(nc - 1); c0 >= 0; --c0)
+				{
+					xs[c0] /= lp[c0 * nc + c0];
+					fmadd64d(xs, -xs[c0], lp + c0 * nc, c0);
+				}
+			}
+		}
+		//the same for k right hand sides at once, row c0 of x (stride ldx) holds unknown c0 of all of them
+		void solvePermuted(double* x, unsigned long long k, unsigned long long ldx)const
+		{
+			for (unsigned long long s(0); s < superNum; ++s)
+			{
+				unsigned long long f0(superBegin[s]), nc(superBegin[s + 1] - f0);
+				unsigned long long const* r(rows + rowBegin[s]);
+				unsigned long long m(rowBegin[s + 1] - rowBegin[s]);
+				double const* lp(l + lBegin[s]);
+				double* xs(x + f0 * ldx);
+				for (unsigned long long c0(0); c0 < nc; ++c0)
+				{
+					double* xr(xs + c0 * ldx);
+					for (unsigned long long c1(0); c1 < c0; ++c1)
+						fmadd64d(xr, -lp[c0 * nc + c1], xs + c1 * ldx, k);
+					double d(1 / lp[c0 * nc + c0]);
+					for (unsigned long long c1(0); c1 < k; ++c1)xr[c1] *= d;
+				}
+				for (unsigned long long c0(nc); c0 < m; ++c0)
+				{
+					double* xr(x + r[c0] * ldx);
+					for (unsigned long long c1(0); c1 < nc; ++c1)
+						fmadd64d(xr, -lp[c0 * nc + c1], xs + c1 * ldx, k);
+				}
+			}
+			for (long long s(superNum - 1); s >= 0; --s)
+			{
+				unsigned long long f0(superBegin[s]), nc(superBegin[s + 1] - f0);
+				unsigned long long const* r(rows + rowBegin[s]);
+				unsigned long long m(rowBegin[s + 1] - rowBegin[s]);
+				double const* lp(l + lBegin[s]);
+				double* xs(x + f0 * ldx);
+				for (unsigned long long c0(nc); c0 < m; ++c0)
+				{
+					double const* xr(x + r[c0] * ldx);
+					for (unsigned long long c1(0); c1 < nc; ++c1)
+						fmadd64d(xs + c1 * ldx, -lp[c0 * nc + c1], xr, k);
+				}
+				for (long long c0(nc - 1); c0 >= 0; --c0)
+				{
+					double* xr(xs + c0 * ldx);
+					double d(1 / lp[c0 * nc + c0]);
+					for (unsigned long long c1(0); c1 < k; ++c1)xr[c1] *= d;
+					for (long long c1(0); c1 < c0; ++c1)
+						fmadd64d(xs + c1 * ldx, -lp[c0 * nc + c1], xr, k);
+				}
+			}
+		}
+	};
+
+	//complex sparse matrix in CSR form: re and im share one pattern, values are stored as (re, im) pairs
+	//a product walks the indices once, where a SparseMat matCplx walks two index arrays
+	struct matCplxCSR
+	{
+		unsigned long long height;
+		unsigned long long width;
+		unsigned long long elementNum;
+		unsigned long long* rowBegin;//height + 1
+		unsigned long long* colIndice;
+		double* data;//2 * elementNum
+		bool symmetric;//A^T == A, then A^H a = conj(A) a runs row by row
+
+		matCplxCSR() :height(0), width(0), elementNum(0), rowBegin(nullptr), colIndice(nullptr), data(nullptr), symmetric(false) {}
+		matCplxCSR(matCplx const& a, unsigned long long _dim) :matCplxCSR()
+		{
+			set(a, _dim);
+		}
+		matCplxCSR(matCplxCSR const&) = delete;
+		~matCplxCSR()
+		{
+			release();
+		}
+
+		//a: SparseMat matCplx of dimension _dim, entries in any order, duplicates are summed
+		matCplxCSR& set(matCplx const& a, unsigned long long _dim)
+		{
+			release();
+			if (a.matType != MatType::SparseMat || !_dim)return *this;
+			height = width = _dim;
+			unsigned long long num(a.re.elementNum + a.im.elementNum);
+			rowBegin = (unsigned long long*)::calloc(height + 1, sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.re.elementNum; ++c0)rowBegin[a.re.rowIndice[c0] + 1]++;
+			for (unsigned long long c0(0); c0 < a.im.elementNum; ++c0)rowBegin[a.im.rowIndice[c0] + 1]++;
+			for (unsigned long long c0(0); c0 < height; ++c0)rowBegin[c0 + 1] += rowBegin[c0];
+			unsigned long long* pos((unsigned long long*)::malloc((height + 1) * sizeof(unsigned long long)));
+			::memcpy(pos, rowBegin, (height + 1) * sizeof(unsigned long long));
+			colIndice = (unsigned long long*)::malloc((num ? num : 1) * sizeof(unsigned long long));
+			data = malloc64d(2 * (num ? num : 1));
+			for (unsigned long long c0(0); c0 < a.re.elementNum; ++c0)
+			{
+				unsigned long long p(pos[a.re.rowIndice[c0]]++);
+				colIndice[p] = a.re.colIndice[c0];
+				data[2 * p] = a.re.data[c0];
+				data[2 * p + 1] = 0;
+			}
+			for (unsigned long long c0(0); c0 < a.im.elementNum; ++c0)
+			{
+				unsigned long long p(pos[a.im.rowIndice[c0]]++);
+				colIndice[p] = a.im.colIndice[c0];
+				data[2 * p] = 0;
+				data[2 * p + 1] = a.im.data[c0];
+			}
+			//sort every row by column and merge the re and im entries of the same column
+			std::vector<unsigned long long> order;
+			std::vector<unsigned long long> col;
+			std::vector<double> val;
+			unsigned long long cnt(0);
+			for (unsigned long long c0(0); c0 < height; ++c0)
+			{
+				unsigned long long bgn(rowBegin[c0]), end(rowBegin[c0 + 1]);
+				order.resize(end - bgn);
+				for (unsigned long long c1(0); c1 < end - bgn; ++c1)order[c1] = bgn + c1;
+				std::sort(order.begin(), order.end(), [this](unsigned long long x, unsigned long long y)
+					{
+						return colIndice[x] < colIndice[y];
+					});
+				col.clear();
+				val.clear();
+				for (unsigned long long c1 : order)
+				{
+					if (col.size() && col.back() == colIndice[c1])
+					{
+						val[val.size() - 2] += data[2 * c1];
+						val.back() += data[2 * c1 + 1];
+					}
+					else
+					{
+						col.push_back(colIndice[c1]);
+						val.push_back(data[2 * c1]);
+						val.push_back(data[2 * c1 + 1]);
+					}
+				}
+				rowBegin[c0] = cnt;
+				for (unsigned long long c1(0); c1 < col.size(); ++c1, ++cnt)
+				{
+					colIndice[cnt] = col[c1];
+					data[2 * cnt] = val[2 * c1];
+					data[2 * cnt + 1] = val[2 * c1 + 1];
+				}
+			}
+			rowBegin[height] = elementNum = cnt;
+			::free(pos);
+			symmetric = true;
+			for (unsigned long long c0(0); c0 < height && symmetric; ++c0)
+				for (unsigned long long c1(rowBegin[c0]); c1 < rowBegin[c0 + 1]; ++c1)
+				{
+					unsigned long long c(colIndice[c1]);
+					unsigned long long const* p(std::lower_bound(colIndice + rowBegin[c], colIndice + rowBegin[c + 1], c0));
+					unsigned long long q(p - colIndice);
+					if (q == rowBegin[c + 1] || *p != c0 || data[2 * q] != data[2 * c1] || data[2 * q + 1] != data[2 * c1 + 1])
+					{
+						symmetric = false;
+						break;
+					}
+				}
+			return *this;
+		}
+		void release()
+		{
+			::free(rowBegin);
+			::free(colIndice);
+			if (data)_mm_free(data);
+			rowBegin = colIndice = nullptr;
+			data = nullptr;
+			height = width = elementNum = 0;
+			symmetric = false;
+		}
+
+		//b = A a, a and b may be the same
+		vecCplx& operator()(vecCplx const& a, vecCplx& b)const
+		{
+			if (!height || a.dim < width)return b;
+			if (b.dim < height)
+			{
+				if (b.type != Type::Native)return b;
+				b.reconstruct(height, false);
+				b.dim = height;
+			}
+			double* x(interleave(a));
+			double* yr(b.re.data + b.re.beginning);
+			double* yi(b.im.data + b.im.beginning);
+			parallelFor((height + 4095) / 4096, [&](unsigned long long c0, unsigned long long)
+				{
+					unsigned long long end(c0 * 4096 + 4096 < height ? c0 * 4096 + 4096 : height);
+					for (unsigned long long c1(c0 * 4096); c1 < end; ++c1)
+					{
+						cplx s(rowMult<false>(c1, x));
+						yr[c1] = s.re;
+						yi[c1] = s.im;
+					}
+				});
+			_mm_free(x);
+			return b;
+		}
+		//b = A^H a, a and b may be the same
+		vecCplx& daggerMult(vecCplx const& a, vecCplx& b)const
+		{
+			if (!height || a.dim < height)return b;
+			if (b.dim < width)
+			{
+				if (b.type != Type::Native)return b;
+				b.reconstruct(width, false);
+				b.dim = width;
+			}
+			double* x(interleave(a));
+			if (symmetric)
+			{
+				double* yr(b.re.data + b.re.beginning);
+				double* yi(b.im.data + b.im.beginning);
+				parallelFor((height + 4095) / 4096, [&](unsigned long long c0, unsigned long long)
+					{
+						unsigned long long end(c0 * 4096 + 4096 < height ? c0 * 4096 + 4096 : height);
+						for (unsigned long long c1(c0 * 4096); c1 < end; ++c1)
+						{
+							cplx s(rowMult<true>(c1, x));
+							yr[c1] = s.re;
+							yi[c1] = s.im;
+						}
+					});
+				_mm_free(x);
+				return b;
+			}
+			double* y(malloc64d(2 * width));
+			memset64d(y, 0, 2 * width);
+			//scatter: y[col] += conj(v) x[row], two entries per step
+			for (unsigned long long c0(0); c0 < height; ++c0)
+			{
+				__m256d xr(_mm256_set1_pd(x[2 * c0]));
+				__m256d xi(_mm256_set1_pd(x[2 * c0 + 1]));
+				unsigned long long c1(rowBegin[c0]), end(rowBegin[c0 + 1]);
+				for (; c1 + 1 < end; c1 += 2)
+				{
+					__m256d v(_mm256_loadu_pd(data + 2 * c1));
+					//(re, im) = (vr xr + vi xi, vr xi - vi xr)
+					__m256d t(_mm256_fmsubadd_pd(_mm256_permute_pd(v, 5), xi, _mm256_mul_pd(v, xr)));
+					double* p0(y + 2 * colIndice[c1]);
+					double* p1(y + 2 * colIndice[c1 + 1]);
+					_mm_storeu_pd(p0, _mm_add_pd(_mm_loadu_pd(p0), _mm256_castpd256_pd128(t)));
+					_mm_storeu_pd(p1, _mm_add_pd(_mm_loadu_pd(p1), _mm256_extractf128_pd(t, 1)));
+				}
+				if (c1 < end)
+				{
+					double vr(data[2 * c1]), vi(data[2 * c1 + 1]);
+					double* p0(y + 2 * colIndice[c1]);
+					p0[0] += vr * x[2 * c0] + vi * x[2 * c0 + 1];
+					p0[1] += vr * x[2 * c0 + 1] - vi * x[2 * c0];
+				}
+			}
+			double* yr(b.re.data + b.re.beginning);
+			double* yi(b.im.data + b.im.beginning);
+			for (unsigned long long c0(0); c0 < width; ++c0)
+			{
+				yr[c0] = y[2 * c0];
+				yi[c0] = y[2 * c0 + 1];
+			}
+			_mm_free(x);
+			_mm_free(y);
+			return b;
+		}
+		//same iteration as matCplx::solveConjugateGradient (COCG, for complex symmetric A)
+		vecCplx& solveConjugateGradient(vecCplx const& a, vecCplx& b, double _eps)const
+		{
+			unsigned long long minDim(height > a.dim ? a.dim : height);
+			if (!minDim || b.dim < minDim)return b;
+			vecCplx x0(b.re.data + b.re.beginning, b.im.data + b.im.beginning, minDim, Type::Parasitic);
+			vecCplx r(minDim, false);
+			vecCplx p(minDim, false);
+			vecCplx Ap(minDim, false);
+			x0 = cplx{ 0, 0 };
+			(*this)(x0, r);
+			r -= a;
+			p = r;
+			cplx rNorm(r.normSquare());
+			for (unsigned long long c0(0); c0 < 100000; ++c0)
+			{
+				if (abs(rNorm.re) + abs(rNorm.im) < minDim * _eps * _eps)
+				{
+					::printf("iters:\t%llu\n", c0);
+					return b;
+				}
+				(*this)(p, Ap);
+				cplx alpha(-rNorm / (Ap, p));
+				x0.fmadd(alpha, p);
+				r.fmadd(alpha, Ap);
+				cplx rNorm1(rNorm);
+				rNorm = r.normSquare();
+				cplx beta(rNorm / rNorm1);
+				p *= beta;
+				p += r;
+			}
+			return b;
+		}
+		//same iteration as matCplx::solveConjugateGradientDagger (CG on A^H A)
+		vecCplx& solveConjugateGradientDagger(vecCplx const& a, vecCplx& b, double _eps)const
+		{
+			unsigned long long minDim(height > a.dim ? a.dim : height);
+			if (!minDim || b.dim < minDim)return b;
+			vecCplx a1(minDim, false);
+			vecCplx x0(b.re.data + b.re.beginning, b.im.data + b.im.beginning, minDim, Type::Parasitic);
+			vecCplx r(minDim, false);
+			vecCplx p(minDim, false);
+			vecCplx Ap(minDim, false);
+			vecCplx tp(minDim, false);
+			daggerMult(a, a1);
+			x0 = cplx{ 0, 0 };
+			(*this)(x0, tp);
+			daggerMult(tp, r);
+			r -= a1;
+			p = r;
+			double rNorm(r.normSquareConjugate().re);
+			for (unsigned long long c0(0); c0 < 100000; ++c0)
+			{
+				if (rNorm < minDim * _eps * _eps)
+				{
+					::printf("iters:\t%llu\n", c0);
+					return b;
+				}
+				(*this)(p, tp);
+				double tpd(tp.normSquareConjugate().re);
+				daggerMult(tp, Ap);
+				double alpha(-rNorm / tpd);
+				x0.fmadd(alpha, p);
+				r.fmadd(alpha, Ap);
+				double rNorm1(rNorm);
+				rNorm = r.normSquareConjugate().re;
+				double beta(rNorm / rNorm1);
+				p.re *= beta;
+				p.im *= beta;
+				p += r;
+			}
+			return b;
+		}
+
+	private:
+		double* interleave(vecCplx const& a)const
+		{
+			unsigned long long n(a.dim);
+			double* x(malloc64d(2 * n));
+			double const* xr(a.re.data + a.re.beginning);
+			double const* xi(a.im.data + a.im.beginning);
+			for (unsigned long long c0(0); c0 < n; ++c0)
+			{
+				x[2 * c0] = xr[c0];
+				x[2 * c0 + 1] = xi[c0];
+			}
+			return x;
+		}
+		//row c0 (conjugated if conj) times x (interleaved), two entries per step
+		template<bool conj>cplx rowMult(unsigned long long c0, double const* x)const
+		{
+			__m256d sr(_mm256_setzero_pd());
+			__m256d si(_mm256_setzero_pd());
+			unsigned long long c1(rowBegin[c0]), end(rowBegin[c0 + 1]);
+			for (; c1 + 1 < end; c1 += 2)
+			{
+				__m256d v(_mm256_loadu_pd(data + 2 * c1));
+				__m256d t(_mm256_set_m128d(_mm_loadu_pd(x + 2 * colIndice[c1 + 1]), _mm_loadu_pd(x + 2 * colIndice[c1])));
+				sr = _mm256_fmadd_pd(v, _mm256_movedup_pd(t), sr);
+				si = _mm256_fmadd_pd(_mm256_permute_pd(v, 5), _mm256_permute_pd(t, 15), si);
+			}
+			//sr = (vr xr, vi xr), si = (vi xi, vr xi)
+			__m256d s;
+			if (conj)s = _mm256_add_pd(si, _mm256_xor_pd(sr, _mm256_setr_pd(0, -0.0, 0, -0.0)));
+			else s = _mm256_addsub_pd(sr, si);
+			__m128d h(_mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1)));
+			cplx r(h.m128d_f64[0], h.m128d_f64[1]);
+			if (c1 < end)
+			{
+				double vr(data[2 * c1]), vi(conj ? -data[2 * c1 + 1] : data[2 * c1 + 1]);
+				double xr(x[2 * colIndice[c1]]), xi(x[2 * colIndice[c1] + 1]);
+				r.re += vr * xr - vi * xi;
+				r.im += vi * xr + vr * xi;
+			}
+			return r;
+		}
+	};
+
+	//no preconditioning: z = r
+	struct identityPreconditioner
+	{
+		vecCplx& operator()(vecCplx const& r, vecCplx& z)const
+		{
+			z = r;
+			return z;
+		}
+	};
+	//Jacobi preconditioner z = D^-1 r, symmetric, so it also keeps COCG valid
+	struct jacobiCplx
+	{
+		vecCplx inv;
+
+		//a: SparseMat or LBandMat
+		jacobiCplx(matCplx const& a, unsigned long long _dim) :inv(_dim, true)
+		{
+			if (a.matType == MatType::SparseMat)
+			{
+				for (unsigned long long c0(0); c0 < a.re.elementNum; ++c0)
+					if (a.re.rowIndice[c0] == a.re.colIndice[c0] && a.re.rowIndice[c0] < _dim)
+						inv.re.data[a.re.rowIndice[c0]] += a.re.data[c0];
+				for (unsigned long long c0(0); c0 < a.im.elementNum; ++c0)
+					if (a.im.rowIndice[c0] == a.im.colIndice[c0] && a.im.rowIndice[c0] < _dim)
+						inv.im.data[a.im.rowIndice[c0]] += a.im.data[c0];
+			}
+			else if (a.matType == MatType::LBandMat)
+			{
+				for (unsigned long long c0(0); c0 < _dim && c0 < a.re.height; ++c0)
+				{
+					inv.re.data[c0] = a.re.LBandEle(c0, c0);
+					inv.im.data[c0] = a.im.LBandEle(c0, c0);
+				}
+			}
+			invert();
+		}
+		jacobiCplx(matCplxCSR const& a) :inv(a.height, true)
+		{
+			for (unsigned long long c0(0); c0 < a.height; ++c0)
+				for (unsigned long long c1(a.rowBegin[c0]); c1 < a.rowBegin[c0 + 1]; ++c1)
+					if (a.colIndice[c1] == c0)
+					{
+						inv.re.data[c0] = a.data[2 * c1];
+						inv.im.data[c0] = a.data[2 * c1 + 1];
+					}
+			invert();
+		}
+		vecCplx& operator()(vecCplx const& r, vecCplx& z)const
+		{
+			z = r;
+			z *= inv;
+			return z;
+		}
+
+	private:
+		void invert()
+		{
+			for (unsigned long long c0(0); c0 < inv.dim; ++c0)
+			{
+				double re(inv.re.data[c0]), im(inv.im.data[c0]);
+				double d(re * re + im * im);
+				if (d == 0)
+				{
+					inv.re.data[c0] = 1;
+					inv.im.data[c0] = 0;
+				}
+				else
+				{
+					inv.re.data[c0] = re / d;
+					inv.im.data[c0] = -im / d;
+				}
+			}
+		}
+	};
+	//Krylov solvers for complex A x = b
+	//A: anything with vecCplx& operator()(vecCplx const&, vecCplx&)const, e.g. matCplx or matCplxCSR
+	//m: preconditioner m(r, z) applying M^-1, identityPreconditioner for none
+	//cocg: complex symmetric A (A^T = A, M^T = M), one product per iteration
+	//bicgstab: general A, two products per iteration
+	//gmres: general A, restarted every restart iterations, right preconditioned
+	struct krylovCplx
+	{
+		double eps;//stop when |b - A x| <= eps |b|
+		unsigned long long maxIter;
+		unsigned long long restart;
+		bool warmStart;//start from the x passed in instead of 0
+		bool verbose;//print the iteration count as solveConjugateGradient does
+		std::function<void(unsigned long long, double)> monitor;//called with (iteration, |r| / |b|)
+		//result of the last solve
+		unsigned long long iters;
+		double residual;
+		bool converged;
+
+		krylovCplx(double _eps = 1e-12, unsigned long long _maxIter = 100000, unsigned long long _restart = 50)
+			:
+			eps(_eps), maxIter(_maxIter), restart(_restart ? _restart : 1), warmStart(false), verbose(false),
+			monitor(), iters(0), residual(0), converged(false)
+		{
+		}
+
+		template<class A, class M = identityPreconditioner>
+		vecCplx& cocg(A const& a, vecCplx const& b, vecCplx& x, M const& m = M())
+		{
+			unsigned long long n(b.dim);
+			double bNorm;
+			if (!begin(b, x, bNorm))return x;
+			vecCplx r(n, false), z(n, false), p(n, false), q(n, false);
+			residualOf(a, b, x, r);
+			if (check(0, r, bNorm))return finish(x);
+			m(r, z);
+			p = z;
+			cplx rho((r, z));
+			for (unsigned long long c0(1); c0 <= maxIter; ++c0)
+			{
+				a(p, q);
+				cplx pq((p, q));
+				if (pq.re == 0 && pq.im == 0)break;
+				cplx alpha(rho / pq);
+				x.fmadd(alpha, p);
+				r.fmadd(-alpha, q);
+				if (check(c0, r, bNorm))break;
+				m(r, z);
+				cplx rho1((r, z));
+				if (rho.re == 0 && rho.im == 0)break;
+				cplx beta(rho1 / rho);
+				rho = rho1;
+				p *= beta;
+				p += z;
+			}
+			return finish(x);
+		}
+		template<class A, class M = identityPreconditioner>
+		vecCplx& bicgstab(A const& a, vecCplx const& b, vecCplx& x, M const& m = M())
+		{
+			unsigned long long n(b.dim);
+			double bNorm;
+			if (!begin(b, x, bNorm))return x;
+			vecCplx r(n, false), r0(n, false), p(n, true), v(n, true), s(n, false), t(n, false), y(n, false);
+			residualOf(a, b, x, r);
+			if (check(0, r, bNorm))return finish(x);
+			r0 = r;
+			cplx rho(1, 0), alpha(1, 0), omega(1, 0);
+			for (unsigned long long c0(1); c0 <= maxIter; ++c0)
+			{
+				cplx rho1(r0.dotConjugate(r));
+				if ((rho1.re == 0 && rho1.im == 0) || (omega.re == 0 && omega.im == 0))break;
+				cplx beta((rho1 / rho) * (alpha / omega));
+				rho = rho1;
+				//p = r + beta (p - omega v)
+				p.fmadd(-omega, v);
+				p *= beta;
+				p += r;
+				m(p, y);
+				a(y, v);
+				cplx rv(r0.dotConjugate(v));
+				if (rv.re == 0 && rv.im == 0)break;
+				alpha = rho / rv;
+				x.fmadd(alpha, y);
+				s = r;
+				s.fmadd(-alpha, v);
+				if (check(c0, s, bNorm, false))
+				{
+					r = s;
+					check(c0, r, bNorm);
+					break;
+				}
+				m(s, y);
+				a(y, t);
+				double tt(t.normSquareConjugate().re);
+				omega = tt == 0 ? cplx(0, 0) : t.dotConjugate(s) / tt;
+				x.fmadd(omega, y);
+				r = s;
+				r.fmadd(-omega, t);
+				if (check(c0, r, bNorm))break;
+			}
+			return finish(x);
+		}
+		template<class A, class M = identityPreconditioner>
+		vecCplx& gmres(A const& a, vecCplx const& b, vecCplx& x, M const& m = M())
+		{
+			unsigned long long n(b.dim);
+			double bNorm;
+			if (!begin(b, x, bNorm))return x;
+			unsigned long long k(restart);
+			std::vector<vecCplx> v;
+			v.reserve(k + 1);
+			for (unsigned long long c0(0); c0 <= k; ++c0)v.emplace_back(n, false);
+			vecCplx r(n, false), w(n, false), z(n, false);
+			//Hessenberg column j at h[j * (k + 1)], rotations (cs real, sn complex), right hand side g
+			std::vector<cplx> h((k + 1) * k, cplx(0, 0)), sn(k, cplx(0, 0)), g(k + 1, cplx(0, 0));
+			std::vector<double> cs(k, 0);
+			residualOf(a, b, x, r);
+			if (check(0, r, bNorm))return finish(x);
+			unsigned long long it(0);
+			while (it < maxIter)
+			{
+				double beta(::sqrt(r.normSquareConjugate().re));
+				v[0] = r;
+				v[0] *= cplx(1 / beta, 0);
+				for (unsigned long long c0(0); c0 <= k; ++c0)g[c0] = cplx(0, 0);
+				g[0] = cplx(beta, 0);
+				unsigned long long j(0);
+				bool done(false);
+				for (; j < k && it < maxIter; ++j)
+				{
+					++it;
+					cplx* hj(h.data() + j * (k + 1));
+					m(v[j], z);
+					a(z, w);
+					//modified Gram-Schmidt
+					for (unsigned long long c0(0); c0 <= j; ++c0)
+					{
+						hj[c0] = v[c0].dotConjugate(w);
+						w.fmadd(-hj[c0], v[c0]);
+					}
+					double hn(::sqrt(w.normSquareConjugate().re));
+					hj[j + 1] = cplx(hn, 0);
+					for (unsigned long long c0(0); c0 < j; ++c0)
+					{
+						cplx t0(hj[c0] * cs[c0] + sn[c0] * hj[c0 + 1]);
+						hj[c0 + 1] = hj[c0 + 1] * cs[c0] - cplx(sn[c0].re, -sn[c0].im) * hj[c0];
+						hj[c0] = t0;
+					}
+					//rotation that zeroes hj[j + 1]
+					double an(hj[j].norm()), bn(hj[j + 1].norm());
+					double rn(::sqrt(an * an + bn * bn));
+					if (rn == 0)
+					{
+						done = true;
+						break;
+					}
+					if (an == 0)
+					{
+						cs[j] = 0;
+						sn[j] = cplx(1, 0);
+						hj[j] = hj[j + 1];
+					}
+					else
+					{
+						cplx u(hj[j] / an);
+						cs[j] = an / rn;
+						sn[j] = u * cplx(hj[j + 1].re, -hj[j + 1].im) / rn;
+						hj[j] = u * rn;
+					}
+					hj[j + 1] = cplx(0, 0);
+					g[j + 1] = -(cplx(sn[j].re, -sn[j].im) * g[j]);
+					g[j] = g[j] * cs[j];
+					residual = g[j + 1].norm() / bNorm;
+					if (monitor)monitor(it, residual);
+					if (residual <= eps || hn == 0)
+					{
+						++j;
+						done = true;
+						break;
+					}
+					v[j + 1] = w;
+					v[j + 1] *= cplx(1 / hn, 0);
+				}
+				//x += M^-1 V y, H y = g
+				std::vector<cplx> y(j, cplx(0, 0));
+				for (long long c0(j - 1); c0 >= 0; --c0)
+				{
+					cplx s(g[c0]);
+					for (unsigned long long c1(c0 + 1); c1 < j; ++c1)s -= h[c1 * (k + 1) + c0] * y[c1];
+					y[c0] = s / h[c0 * (k + 1) + c0];
+				}
+				w = cplx(0, 0);
+				for (unsigned long long c0(0); c0 < j; ++c0)w.fmadd(y[c0], v[c0]);
+				m(w, z);
+				x += z;
+				residualOf(a, b, x, r);
+				residual = ::sqrt(r.normSquareConjugate().re) / bNorm;
+				if (residual <= eps || done)break;
+			}
+			iters = it;
+			return finish(x);
+		}
+
+	private:
+		bool begin(vecCplx const& b, vecCplx& x, double& bNorm)
+		{
+			iters = 0;
+			residual = 0;
+			converged = false;
+			if (!b.dim)return false;
+			if (x.dim < b.dim)
+			{
+				if (x.type != Type::Native)return false;
+				x.reconstruct(b.dim, true);
+				x.dim = b.dim;
+			}
+			else if (!warmStart)x = cplx(0, 0);
+			bNorm = ::sqrt(b.normSquareConjugate().re);
+			if (bNorm == 0)bNorm = 1;
+			return true;
+		}
+		template<class A>void residualOf(A const& a, vecCplx const& b, vecCplx const& x, vecCplx& r)
+		{
+			vecCplx xs(x.re.data + x.re.beginning, x.im.data + x.im.beginning, b.dim, Type::Parasitic);
+			a(xs, r);
+			r *= cplx(-1, 0);
+			r += b;
+		}
+		bool check(unsigned long long it, vecCplx const& r, double bNorm, bool report = true)
+		{
+			double res(::sqrt(r.normSquareConjugate().re) / bNorm);
+			if (!report)return res <= eps;
+			iters = it;
+			residual = res;
+			if (monitor)monitor(it, res);
+			return converged = res <= eps;
+		}
+		vecCplx& finish(vecCplx& x)
+		{
+			converged = residual <= eps;
+			if (verbose)::printf("iters:\t%llu\tresidual:\t%.3e\n", iters, residual);
+			return x;
+		}
+	};
+
+	//L D L^T of a complex symmetric (A^T = A, not Hermitian) LBandMat matCplx, no pivoting
+	//the factor keeps its own storage, so a is left untouched and a sweep over many matrices of the same shape allocates once
+	//row i holds L(i, i - halfBandWidth .. i - 1) and D(i) in the last slot, re and im in separate arrays
+	struct matLDLTCplxBand
+	{
+		unsigned long long dim;
+		unsigned long long halfBandWidth;
+		unsigned long long width4d;
+		double* re;
+		double* im;
+		bool singular;
+
+		matLDLTCplxBand() :dim(0), halfBandWidth(0), width4d(0), re(nullptr), im(nullptr), singular(true) {}
+		matLDLTCplxBand(matCplx const& a) :matLDLTCplxBand()
+		{
+			factor(a);
+		}
+		matLDLTCplxBand(matLDLTCplxBand const&) = delete;
+		~matLDLTCplxBand()
+		{
+			release();
+		}
+
+		//false if a pivot vanishes
+		bool factor(matCplx const& a)
+		{
+			if (a.matType != MatType::LBandMat || !a.re.height)
+			{
+				release();
+				return false;
+			}
+			unsigned long long n(a.re.height), hb(a.re.halfBandWidth);
+			if (n != dim || hb != halfBandWidth)
+			{
+				release();
+				dim = n;
+				halfBandWidth = hb;
+				width4d = ceiling4(hb + 1);
+				re = malloc64d(n * width4d);
+				im = malloc64d(n * width4d);
+			}
+			singular = false;
+			//W(i, k) = L(i, k) D(k) of the current row
+			double* wr(malloc64d(width4d));
+			double* wi(malloc64d(width4d));
+			for (unsigned long long c0(0); c0 < n; ++c0)
+			{
+				unsigned long long lo(c0 > hb ? c0 - hb : 0);
+				double* lr(re + c0 * width4d + hb - c0);//lr[k] = L(c0, k)
+				double* li(im + c0 * width4d + hb - c0);
+				double* tr(wr + hb - c0);
+				double* ti(wi + hb - c0);
+				for (unsigned long long c1(0); c1 < hb - (c0 - lo); ++c1)
+					re[c0 * width4d + c1] = im[c0 * width4d + c1] = 0;
+				for (unsigned long long c1(lo); c1 < c0; ++c1)
+				{
+					//W(c0, c1) = A(c0, c1) - sum_k W(c0, k) L(c1, k)
+					double sr, si;
+					dotCplx(tr + lo, ti + lo, re + c1 * width4d + hb - c1 + lo, im + c1 * width4d + hb - c1 + lo, c1 - lo, sr, si);
+					tr[c1] = a.re.LBandEle(c0, c1) - sr;
+					ti[c1] = a.im.LBandEle(c0, c1) - si;
+					//L(c0, c1) = W(c0, c1) / D(c1)
+					double dr(re[c1 * width4d + hb]), di(im[c1 * width4d + hb]);
+					double dd(dr * dr + di * di);
+					lr[c1] = (tr[c1] * dr + ti[c1] * di) / dd;
+					li[c1] = (ti[c1] * dr - tr[c1] * di) / dd;
+				}
+				double sr, si;
+				dotCplx(tr + lo, ti + lo, lr + lo, li + lo, c0 - lo, sr, si);
+				lr[c0] = a.re.LBandEle(c0, c0) - sr;
+				li[c0] = a.im.LBandEle(c0, c0) - si;
+				if (lr[c0] == 0 && li[c0] == 0)
+				{
+					singular = true;
+					break;
+				}
+			}
+			_mm_free(wr);
+			_mm_free(wi);
+			return !singular;
+		}
+		//b = A^-1 a, a and b may be the same
+		vecCplx& solve(vecCplx const& a, vecCplx& b)const
+		{
+			if (singular || a.dim < dim)return b;
+			if (b.dim < dim)
+			{
+				if (b.type != Type::Native)return b;
+				b.reconstruct(dim, false);
+				b.dim = dim;
+			}
+			unsigned long long hb(halfBandWidth);
+			double* xr(malloc64d(dim));
+			double* xi(malloc64d(dim));
+			memcpy64d(xr, a.re.data + a.re.beginning, dim);
+			memcpy64d(xi, a.im.data + a.im.beginning, dim);
+			//L y = a
+			for (unsigned long long c0(1); c0 < dim; ++c0)
+			{
+				unsigned long long lo(c0 > hb ? c0 - hb : 0);
+				double sr, si;
+				dotCplx(re + c0 * width4d + hb - c0 + lo, im + c0 * width4d + hb - c0 + lo, xr + lo, xi + lo, c0 - lo, sr, si);
+				xr[c0] -= sr;
+				xi[c0] -= si;
+			}
+			//D z = y
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				double dr(re[c0 * width4d + hb]), di(im[c0 * width4d + hb]);
+				double dd(dr * dr + di * di);
+				double tr(xr[c0]), ti(xi[c0]);
+				xr[c0] = (tr * dr + ti * di) / dd;
+				xi[c0] = (ti * dr - tr * di) / dd;
+			}
+			//L^T x = z, row c0 of L is subtracted once x[c0] is final
+			for (unsigned long long c0(dim - 1); c0 > 0; --c0)
+			{
+				unsigned long long lo(c0 > hb ? c0 - hb : 0);
+				fnmaddCplx(xr + lo, xi + lo, xr[c0], xi[c0],
+					re + c0 * width4d + hb - c0 + lo, im + c0 * width4d + hb - c0 + lo, c0 - lo);
+			}
+			memcpy64d(b.re.data + b.re.beginning, xr, dim);
+			memcpy64d(b.im.data + b.im.beginning, xi, dim);
+			_mm_free(xr);
+			_mm_free(xi);
+			return b;
+		}
+		//log det A = sum log D(i), the product itself overflows for lattice sized systems, im is not reduced to (-Pi, Pi]
+		cplx logDet()const
+		{
+			cplx s(0, 0);
+			for (unsigned long long c0(0); c0 < dim; ++c0)
+			{
+				double dr(re[c0 * width4d + halfBandWidth]), di(im[c0 * width4d + halfBandWidth]);
+				s.re += 0.5 * ::log(dr * dr + di * di);
+				s.im += ::atan2(di, dr);
+			}
+			return s;
+		}
+		void release()
+		{
+			if (re)_mm_free(re);
+			if (im)_mm_free(im);
+			re = im = nullptr;
+			dim = halfBandWidth = width4d = 0;
+			singular = true;
+		}
+
+	private:
+		//s = sum a[k] b[k] (no conjugate), split re/im
+		static void dotCplx(double const* ar, double const* ai, double const* br, double const* bi, unsigned long long len, double& sr, double& si)
+		{
+			__m256d r0(_mm256_setzero_pd()), r1(_mm256_setzero_pd());
+			__m256d i0(_mm256_setzero_pd()), i1(_mm256_setzero_pd());
+			unsigned long long c0(0);
+			for (; c0 + 4 <= len; c0 += 4)
+			{
+				__m256d xr(_mm256_loadu_pd(ar + c0)), xi(_mm256_loadu_pd(ai + c0));
+				__m256d yr(_mm256_loadu_pd(br + c0)), yi(_mm256_loadu_pd(bi + c0));
+				r0 = _mm256_fmadd_pd(xr, yr, r0);
+				r1 = _mm256_fmadd_pd(xi, yi, r1);
+				i0 = _mm256_fmadd_pd(xr, yi, i0);
+				i1 = _mm256_fmadd_pd(xi, yr, i1);
+			}
+			r0 = _mm256_sub_pd(r0, r1);
+			i0 = _mm256_add_pd(i0, i1);
+			sr = r0.m256d_f64[0] + r0.m256d_f64[1] + r0.m256d_f64[2] + r0.m256d_f64[3];
+			si = i0.m256d_f64[0] + i0.m256d_f64[1] + i0.m256d_f64[2] + i0.m256d_f64[3];
+			for (; c0 < len; ++c0)
+			{
+				sr += ar[c0] * br[c0] - ai[c0] * bi[c0];
+				si += ar[c0] * bi[c0] + ai[c0] * br[c0];
+			}
+		}
+		//y -= s x
+		static void fnmaddCplx(double* yr, double* yi, double sr, double si, double const* xr, double const* xi, unsigned long long len)
+		{
+			__m256d vr(_mm256_set1_pd(sr)), vi(_mm256_set1_pd(si));
+			unsigned long long c0(0);
+			for (; c0 + 4 <= len; c0 += 4)
+			{
+				__m256d ar(_mm256_loadu_pd(xr + c0)), ai(_mm256_loadu_pd(xi + c0));
+				__m256d tr(_mm256_loadu_pd(yr + c0)), ti(_mm256_loadu_pd(yi + c0));
+				tr = _mm256_fnmadd_pd(ar, vr, tr);
+				tr = _mm256_fmadd_pd(ai, vi, tr);
+				ti = _mm256_fnmadd_pd(ar, vi, ti);
+				ti = _mm256_fnmadd_pd(ai, vr, ti);
+				_mm256_storeu_pd(yr + c0, tr);
+				_mm256_storeu_pd(yi + c0, ti);
+			}
+			for (; c0 < len; ++c0)
+			{
+				double ar(xr[c0]), ai(xi[c0]);
+				yr[c0] -= ar * sr - ai * si;
+				yi[c0] -= ar * si + ai * sr;
+			}
+		}
+	};
+
+	//(A + sigma_k B) x_k = b for many shifts sigma_k from one Krylov space
+	//with K = A + sigma0 B factored once, A + sigma B = K (I + tau M), M = K^-1 B, tau = sigma - sigma0,
+	//so every x_k minimises |c - (I + tau_k M) x| over the same space K_m(M, c), c = K^-1 b
+	//kInv(a, b): b = K^-1 a, bMult(a, b): b = B a
+	//every shift runs its own Givens rotations on the shared Hessenberg matrix (shifted GMRES), no restarts
+	//residuals are those of the K^-1 preconditioned systems, relative to |c|
+	struct multiShiftCplx
+	{
+		double eps;
+		unsigned long long maxDim;//largest basis
+		bool verbose;
+		//result of the last solve
+		unsigned long long iters;
+		std::vector<double> residual;
+		std::vector<unsigned long long> shiftIters;//basis size used by every shift
+
+		multiShiftCplx(double _eps = 1e-10, unsigned long long _maxDim = 200)
+			:
+			eps(_eps), maxDim(_maxDim ? _maxDim : 1), verbose(false), iters(0), residual(), shiftIters()
+		{
+		}
+
+		//true if every shift converged
+		template<class KInv, class BMult>
+		bool solve(KInv const& kInv, BMult const& bMult, vecCplx const& b, cplx sigma0,
+			std::vector<cplx> const& sigma, std::vector<vecCplx>& x)
+		{
+			unsigned long long n(b.dim), ns(sigma.size()), m(maxDim);
+			iters = 0;
+			residual.assign(ns, 1);
+			shiftIters.assign(ns, 0);
+			x.resize(ns);
+			for (vecCplx& xk : x)
+			{
+				if (xk.dim != n)
+				{
+					xk.reconstruct(n, true);
+					xk.dim = n;
+				}
+				else xk = cplx(0, 0);
+			}
+			if (!n || !ns)return true;
+			std::vector<vecCplx> v;
+			v.reserve(m + 1);
+			v.emplace_back(n, false);
+			kInv(b, v[0]);
+			double beta(::sqrt(v[0].normSquareConjugate().re));
+			if (beta == 0)return true;
+			v[0] *= cplx(1 / beta, 0);
+			vecCplx w(n, false), t(n, false);
+			//column j of H at h[j * (m + 1)]
+			std::vector<cplx> h((m + 1) * m, cplx(0, 0));
+			std::vector<cplx> tau(ns, cplx(0, 0));
+			for (unsigned long long c0(0); c0 < ns; ++c0)tau[c0] = sigma[c0] - sigma0;
+			//rotations and right hand sides of every shift
+			std::vector<double> cs(ns * m, 0);
+			std::vector<cplx> sn(ns * m, cplx(0, 0)), g(ns * (m + 1), cplx(0, 0)), col(m + 1, cplx(0, 0));
+			for (unsigned long long c0(0); c0 < ns; ++c0)g[c0 * (m + 1)] = cplx(1, 0);
+			std::vector<unsigned char> done(ns, 0);
+			unsigned long long left(ns);
+			unsigned long long j(0);
+			for (; j < m && left; ++j)
+			{
+				bMult(v[j], t);
+				kInv(t, w);
+				cplx* hj(h.data() + j * (m + 1));
+				for (unsigned long long c0(0); c0 <= j; ++c0)
+				{
+					hj[c0] = v[c0].dotConjugate(w);
+					w.fmadd(-hj[c0], v[c0]);
+				}
+				//second Gram-Schmidt pass, the basis has to stay orthogonal for every shift at once
+				for (unsigned long long c0(0); c0 <= j; ++c0)
+				{
+					cplx s(v[c0].dotConjugate(w));
+					hj[c0] += s;
+					w.fmadd(-s, v[c0]);
+				}
+				double hn(::sqrt(w.normSquareConjugate().re));
+				hj[j + 1] = cplx(hn, 0);
+				++iters;
+				for (unsigned long long c0(0); c0 < ns; ++c0)
+				{
+					if (done[c0])continue;
+					double res(rotate(tau[c0], hj, j, cs.data() + c0 * m, sn.data() + c0 * m, g.data() + c0 * (m + 1), col.data()));
+					residual[c0] = res;
+					shiftIters[c0] = j + 1;
+					if (res <= eps || hn == 0)
+					{
+						done[c0] = 1;
+						--left;
+					}
+				}
+				if (hn == 0)break;
+				v.emplace_back(n, false);
+				v[j + 1] = w;
+				v[j + 1] *= cplx(1 / hn, 0);
+			}
+			//x_k = beta V y_k, (I + tau_k H) y_k = g_k rebuilt from the stored rotations
+			std::vector<cplx> r(m * m, cplx(0, 0)), y(m, cplx(0, 0));
+			for (unsigned long long c0(0); c0 < ns; ++c0)
+			{
+				unsigned long long k(shiftIters[c0]);
+				double const* csk(cs.data() + c0 * m);
+				cplx const* snk(sn.data() + c0 * m);
+				cplx const* gk(g.data() + c0 * (m + 1));
+				for (unsigned long long c1(0); c1 < k; ++c1)
+				{
+					cplx const* hc(h.data() + c1 * (m + 1));
+					for (unsigned long long c2(0); c2 <= c1 + 1; ++c2)col[c2] = hc[c2] * tau[c0];
+					col[c1] += cplx(1, 0);
+					for (unsigned long long c2(0); c2 < c1; ++c2)
+					{
+						cplx t0(col[c2] * csk[c2] + snk[c2] * col[c2 + 1]);
+						col[c2 + 1] = col[c2 + 1] * csk[c2] - cplx(snk[c2].re, -snk[c2].im) * col[c2];
+						col[c2] = t0;
+					}
+					col[c1] = col[c1] * csk[c1] + snk[c1] * col[c1 + 1];
+					for (unsigned long long c2(0); c2 <= c1; ++c2)r[c2 * m + c1] = col[c2];
+				}
+				for (long long c1(k - 1); c1 >= 0; --c1)
+				{
+					cplx s(gk[c1]);
+					for (unsigned long long c2(c1 + 1); c2 < k; ++c2)s -= r[c1 * m + c2] * y[c2];
+					y[c1] = s / r[c1 * m + c1];
+				}
+				for (unsigned long long c1(0); c1 < k; ++c1)x[c0].fmadd(y[c1] * beta, v[c1]);
+			}
+			unsigned long long ok(0);
+			for (double res : residual)ok += res <= eps;
+			if (verbose)::printf("basis:\t%llu\tconverged:\t%llu / %llu\n", iters, ok, ns);
+			return ok == ns;
+		}
+
+	private:
+		//append column j of I + tau H to the QR of one shift, returns |residual| / |c|
+		static double rotate(cplx tau, cplx const* hj, unsigned long long j, double* cs, cplx* sn, cplx* g, cplx* col)
+		{
+			for (unsigned long long c0(0); c0 <= j + 1; ++c0)col[c0] = hj[c0] * tau;
+			col[j] += cplx(1, 0);
+			for (unsigned long long c0(0); c0 < j; ++c0)
+			{
+				cplx t0(col[c0] * cs[c0] + sn[c0] * col[c0 + 1]);
+				col[c0 + 1] = col[c0 + 1] * cs[c0] - cplx(sn[c0].re, -sn[c0].im) * col[c0];
+				col[c0] = t0;
+			}
+			double an(col[j].norm()), bn(col[j + 1].norm());
+			double rn(::sqrt(an * an + bn * bn));
+			if (rn == 0)
+			{
+				cs[j] = 1;
+				sn[j] = cplx(0, 0);
+				return g[j].norm();
+			}
+			if (an == 0)
+			{
+				cs[j] = 0;
+				sn[j] = cplx(1, 0);
+			}
+			else
+			{
+				cplx u(col[j] / an);
+				cs[j] = an / rn;
+				sn[j] = u * cplx(col[j + 1].re, -col[j + 1].im) / rn;
+			}
+			g[j + 1] = -(cplx(sn[j].re, -sn[j].im) * g[j]);
+			g[j] = g[j] * cs[j];
+			return g[j + 1].norm();
+		}
+	};
+
+	//block CSR of a square SparseMat with bs x bs blocks (bs = 2, 3 or 4), one column index per block
+	//blocks are column major, a column padded to 4 doubles when bs = 3, so A x is one broadcast fmadd per block column
+	//fits systems whose nonzeros come in aligned blocks, e.g. the 2 x 2 real form of a complex matrix
+	template<unsigned long long bs>struct matBSR
+	{
+		static_assert(bs >= 2 && bs <= 4, "block size must be 2, 3 or 4");
+		static constexpr unsigned long long colStride = bs == 3 ? 4 : bs;
+		static constexpr unsigned long long blockSize = colStride * bs;
+
+		unsigned long long height;
+		unsigned long long blockRows;
+		unsigned long long blockNum;
+		unsigned long long elementNum;//nonzeros of the source
+		unsigned long long* rowBegin;//blockRows + 1
+		unsigned long long* colIndice;//block columns
+		double* data;//blockSize per block
+
+		matBSR() :height(0), blockRows(0), blockNum(0), elementNum(0), rowBegin(nullptr), colIndice(nullptr), data(nullptr) {}
+		matBSR(mat const& a, unsigned long long _dim) :matBSR()
+		{
+			set(a, _dim);
+		}
+		matBSR(matBSR const&) = delete;
+		~matBSR()
+		{
+			release();
+		}
+
+		//a: SparseMat of dimension _dim, entries in any order, duplicates are summed
+		matBSR& set(mat const& a, unsigned long long _dim)
+		{
+			release();
+			if (a.matType != MatType::SparseMat || !_dim)return *this;
+			height = _dim;
+			blockRows = (_dim + bs - 1) / bs;
+			elementNum = a.elementNum;
+			//entries bucketed by block row
+			unsigned long long* bgn((unsigned long long*)::calloc(blockRows + 1, sizeof(unsigned long long)));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)bgn[a.rowIndice[c0] / bs + 1]++;
+			for (unsigned long long c0(0); c0 < blockRows; ++c0)bgn[c0 + 1] += bgn[c0];
+			unsigned long long* pos((unsigned long long*)::malloc((blockRows + 1) * sizeof(unsigned long long)));
+			unsigned long long* order((unsigned long long*)::malloc((a.elementNum ? a.elementNum : 1) * sizeof(unsigned long long)));
+			::memcpy(pos, bgn, (blockRows + 1) * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < a.elementNum; ++c0)order[pos[a.rowIndice[c0] / bs]++] = c0;
+			//distinct block columns of every block row, marker[bc] == br + 1 once seen in block row br
+			unsigned long long* marker((unsigned long long*)::calloc(blockRows, sizeof(unsigned long long)));
+			unsigned long long* slot((unsigned long long*)::malloc(blockRows * sizeof(unsigned long long)));
+			rowBegin = (unsigned long long*)::malloc((blockRows + 1) * sizeof(unsigned long long));
+			rowBegin[0] = 0;
+			for (unsigned long long c0(0); c0 < blockRows; ++c0)
+			{
+				unsigned long long num(0);
+				for (unsigned long long c1(bgn[c0]); c1 < bgn[c0 + 1]; ++c1)
+				{
+					unsigned long long bc(a.colIndice[order[c1]] / bs);
+					if (marker[bc] != c0 + 1)
+					{
+						marker[bc] = c0 + 1;
+						num++;
+					}
+				}
+				rowBegin[c0 + 1] = rowBegin[c0] + num;
+			}
+			blockNum = rowBegin[blockRows];
+			colIndice = (unsigned long long*)::malloc((blockNum ? blockNum : 1) * sizeof(unsigned long long));
+			data = malloc64d((blockNum ? blockNum : 1) * blockSize);
+			memset64d(data, 0, (blockNum ? blockNum : 1) * blockSize);
+			::memset(marker, 0, blockRows * sizeof(unsigned long long));
+			for (unsigned long long c0(0); c0 < blockRows; ++c0)
+			{
+				unsigned long long* cols(colIndice + rowBegin[c0]);
+				unsigned long long num(0);
+				for (unsigned long long c1(bgn[c0]); c1 < bgn[c0 + 1]; ++c1)
+				{
+					unsigned long long bc(a.colIndice[order[c1]] / bs);
+					if (marker[bc] != c0 + 1)
+					{
+						marker[bc] = c0 + 1;
+						cols[num++] = bc;
+					}
+				}
+				std::sort(cols, cols + num);
+				for (unsigned long long c1(0); c1 < num; ++c1)slot[cols[c1]] = rowBegin[c0] + c1;
+				for (unsigned long long c1(bgn[c0]); c1 < bgn[c0 + 1]; ++c1)
+				{
+					unsigned long long e(order[c1]), r(a.rowIndice[e]), c(a.colIndice[e]);
+					data[slot[c / bs] * blockSize + (c % bs) * colStride + r % bs] += a.data[e];
+				}
+			}
+			::free(bgn);
+			::free(pos);
+			::free(order);
+			::free(marker);
+			::free(slot);
+			return *this;
+		}
+		//stored scalars per nonzero of the source, 1 when every block is full
+		double fill()const
+		{
+			return elementNum ? double(blockNum * bs * bs) / elementNum : 0;
+		}
+		//bytes of data and indices, against 24 per nonzero for the SparseMat
+		unsigned long long bytes()const
+		{
+			return blockNum * (blockSize * sizeof(double) + sizeof(unsigned long long)) + (blockRows + 1) * sizeof(unsigned long long);
+		}
+		void release()
+		{
+			::free(rowBegin);
+			::free(colIndice);
+			if (data)_mm_free(data);
+			rowBegin = colIndice = nullptr;
+			data = nullptr;
+			height = blockRows = blockNum = elementNum = 0;
+		}
+		//b = A a
+		vec& operator()(vec const& a, vec& b)const
+		{
+			if (!height || a.dim < height)return b;
+			if (b.dim < height)
+			{
+				if (b.type != Type::Native)return b;
+				b.reconstruct(height, false);
+				b.dim = height;
+			}
+			unsigned long long padded(blockRows * bs);
+			double const* x(a.data + a.beginning);
+			double* y(b.data + b.beginning);
+			double* xp(nullptr);
+			double* yp(nullptr);
+			//the last block row or column is cut short, or a and b overlap
+			if (padded != height || x == y)
+			{
+				xp = malloc64d(padded);
+				memcpy64d(xp, x, height);
+				memset64d(xp + height, 0, padded - height);
+				x = xp;
+				if (padded != height)y = yp = malloc64d(padded + 4);
+			}
+			//about 4096 rows per task, as the CSR products
+			constexpr unsigned long long chunk(4096 / bs);
+			parallelFor((blockRows + chunk - 1) / chunk, [&](unsigned long long t, unsigned long long)
+				{
+					unsigned long long r0(t * chunk), r1(r0 + chunk < blockRows ? r0 + chunk : blockRows);
+					if (bs == 2)
+					{
+						for (unsigned long long c0(r0); c0 < r1; ++c0)
+						{
+							__m256d s0(_mm256_setzero_pd()), s1(_mm256_setzero_pd());
+							unsigned long long c1(rowBegin[c0]), end(rowBegin[c0 + 1]);
+							for (; c1 + 1 < end; c1 += 2)
+							{
+								//(x0, x0, x1, x1) against the columns (a00, a10), (a01, a11)
+								__m256d x0(_mm256_permute4x64_pd(_mm256_castpd128_pd256(_mm_loadu_pd(x + 2 * colIndice[c1])), 0x50));
+								__m256d x1(_mm256_permute4x64_pd(_mm256_castpd128_pd256(_mm_loadu_pd(x + 2 * colIndice[c1 + 1])), 0x50));
+								s0 = _mm256_fmadd_pd(_mm256_load_pd(data + 4 * c1), x0, s0);
+								s1 = _mm256_fmadd_pd(_mm256_load_pd(data + 4 * c1 + 4), x1, s1);
+							}
+							if (c1 < end)
+							{
+								__m256d x0(_mm256_permute4x64_pd(_mm256_castpd128_pd256(_mm_loadu_pd(x + 2 * colIndice[c1])), 0x50));
+								s0 = _mm256_fmadd_pd(_mm256_load_pd(data + 4 * c1), x0, s0);
+							}
+							s0 = _mm256_add_pd(s0, s1);
+							_mm_storeu_pd(y + 2 * c0, _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1)));
+						}
+					}
+					else
+					{
+						__m256i mask(_mm256_set_epi64x(bs == 4 ? -1 : 0, -1, -1, -1));
+						for (unsigned long long c0(r0); c0 < r1; ++c0)
+						{
+							__m256d s0(_mm256_setzero_pd()), s1(_mm256_setzero_pd());
+							for (unsigned long long c1(rowBegin[c0]); c1 < rowBegin[c0 + 1]; ++c1)
+							{
+								double const* d(data + c1 * blockSize);
+								double const* xc(x + bs * colIndice[c1]);
+								s0 = _mm256_fmadd_pd(_mm256_load_pd(d), _mm256_broadcast_sd(xc), s0);
+								s1 = _mm256_fmadd_pd(_mm256_load_pd(d + colStride), _mm256_broadcast_sd(xc + 1), s1);
+								s0 = _mm256_fmadd_pd(_mm256_load_pd(d + 2 * colStride), _mm256_broadcast_sd(xc + 2), s0);
+								if (bs == 4)s1 = _mm256_fmadd_pd(_mm256_load_pd(d + 3 * colStride), _mm256_broadcast_sd(xc + 3), s1);
+							}
+							_mm256_maskstore_pd(y + bs * c0, mask, _mm256_add_pd(s0, s1));
+						}
+					}
+				});
+			if (yp)memcpy64d(b.data + b.beginning, yp, height);
+			if (xp)_mm_free(xp);
+			if (yp)_mm_free(yp);
+			return b;
+		}
+		//same iteration as mat::solveConjugateGradient
+		vec& solveConjugateGradient(vec const& a, vec& b, double _eps)const
+		{
+			unsigned long long minDim(height > a.dim ? a.dim : height);
+			if (!minDim || minDim < height || b.dim < minDim)return b;
+			vec x0(b.data + b.beginning, minDim, Type::Parasitic);
+			vec r(minDim, false);
+			vec p(minDim, false);
+			vec Ap(minDim, false);
+			x0 = 0;
+			(*this)(x0, r);
+			r -= a;
+			p = r;
+			double rNorm(r.norm2Square());
+			for (unsigned long long c0(0); c0 < 100000; ++c0)
+			{
+				if (rNorm / minDim < _eps * _eps)
+				{
+					::printf("iters:\t%llu\n", c0);
+					return b;
+				}
+				(*this)(p, Ap);
+				double alpha(-rNorm / (Ap, p));
+				x0.fmadd(alpha, p);
+				r.fmadd(alpha, Ap);
+				double rNorm1(rNorm);
+				rNorm = r.norm2Square();
+				double beta(rNorm / rNorm1);
+				p *= beta;
+				p += r;
+			}
+			return b;
+		}
+	};
+	//block size (2, 3 or 4) that stores a SparseMat in the fewest bytes as matBSR, 1 if the SparseMat itself is smaller
+	inline unsigned long long blockSizeBSR(mat const& a, unsigned long long _dim)
+	{
+		if (a.matType != MatType::SparseMat || !_dim)return 1;
+		unsigned long long best(1), bestBytes(a.elementNum * (sizeof(double) + 2 * sizeof(unsigned long long)));
+		auto test = [&](unsigned long long size, unsigned long long bytes)
+		{
+			if (bytes < bestBytes)
+			{
+				best = size;
+				bestBytes = bytes;
+			}
+		};
+		test(2, matBSR<2>(a, _dim).bytes());
+		test(3, matBSR<3>(a, _dim).bytes());
+		test(4, matBSR<4>(a, _dim).bytes());
+		return best;
+	}
+
+	//binary checkpoint: header, a table of named double arrays, then the arrays, each starting on a 32 byte boundary
+	//so the whole payload is read with one fread and the arrays are used in place as vecs;
+	//native byte order, an FNV-1a sum over the payload words catches a torn file
+	struct checkpointHeader
+	{
+		char magic[8];//"BLASCKPT"
+		unsigned long long version;
+		unsigned long long entryNum;
+		unsigned long long payload;//doubles
+		unsigned long long checksum;
+		unsigned long long reserved[3];
+	};
+	struct checkpointEntry
+	{
+		char name[40];
+		unsigned long long dim;
+		unsigned long long offset;//doubles from the start of the payload
+		unsigned long long reserved;
+	};
+	inline unsigned long long checkpointSum(double const* a, unsigned long long n)
+	{
+		unsigned long long h(14695981039346656037llu);
+		unsigned long long const* p((unsigned long long const*)a);
+		for (unsigned long long c0(0); c0 < n; ++c0)
+		{
+			h ^= p[c0];
+			h *= 1099511628211llu;
+		}
+		return h;
+	}
+	//arrays are copied in when added, so a snapshot can be written while its owner goes on;
+	//storage is kept between snapshots
+	struct checkpointWriter
+	{
+		std::vector<checkpointEntry> entries;
+		double* data;
+		unsigned long long payload;
+		unsigned long long capacity;
+
+		checkpointWriter() :entries(), data(nullptr), payload(0), capacity(0) {}
+		checkpointWriter(checkpointWriter const&) = delete;
+		~checkpointWriter()
+		{
+			if (data)_mm_free(data);
+		}
+		void clear()
+		{
+			entries.clear();
+			payload = 0;
+		}
+		//room for dim doubles under name, filled by the caller before the next add
+		double* array(char const* name, unsigned long long dim)
+		{
+			unsigned long long need(payload + ceiling4(dim));
+			if (need > capacity)
+			{
+				unsigned long long c(need > 2 * capacity ? need : 2 * capacity);
+				double* d(malloc64d(c));
+				if (payload)memcpy64d(d, data, payload);
+				if (data)_mm_free(data);
+				data = d;
+				capacity = c;
+			}
+			checkpointEntry e;
+			memset(&e, 0, sizeof(e));
+			strncpy(e.name, name, sizeof(e.name) - 1);
+			e.dim = dim;
+			e.offset = payload;
+			entries.push_back(e);
+			//padding is written too, keep it deterministic
+			for (unsigned long long c0(dim); c0 < ceiling4(dim); ++c0)data[payload + c0] = 0;
+			payload = need;
+			return data + e.offset;
+		}
+		void add(char const* name, vec const& a)
+		{
+			double* p(array(name, a.dim));
+			if (a.dim)memcpy64d(p, a.data + a.beginning, a.dim);
+		}
+		void add(char const* name, double a)
+		{
+			*array(name, 1) = a;
+		}
+		//written to file.tmp, then moved over file: a kill leaves either the old or the new checkpoint
+		bool save(char const* file)const
+		{
+			std::string tmp(std::string(file) + ".tmp");
+			FILE* fp(::fopen(tmp.c_str(), "wb"));
+			if (!fp)return false;
+			checkpointHeader h;
+			memset(&h, 0, sizeof(h));
+			memcpy(h.magic, "BLASCKPT", 8);
+			h.version = 1;
+			h.entryNum = entries.size();
+			h.payload = payload;
+			h.checksum = checkpointSum(data, payload);
+			bool ok(::fwrite(&h, sizeof(h), 1, fp) == 1);
+			if (ok && h.entryNum)ok = ::fwrite(entries.data(), sizeof(checkpointEntry), h.entryNum, fp) == h.entryNum;
+			if (ok && payload)ok = ::fwrite(data, sizeof(double), payload, fp) == payload;
+			ok = (::fclose(fp) == 0) && ok;
+			if (!ok)return false;
+			::remove(file);
+			return ::rename(tmp.c_str(), file) == 0;
+		}
+	};
+	struct checkpointReader
+	{
+		std::vector<checkpointEntry> entries;
+		double* data;
+		unsigned long long payload;
+
+		checkpointReader() :entries(), data(nullptr), payload(0) {}
+		checkpointReader(checkpointReader const&) = delete;
+		~checkpointReader()
+		{
+			if (data)_mm_free(data);
+		}
+		//file, or file.tmp if a kill came between the two steps of checkpointWriter::save; false if neither is valid
+		bool load(char const* file)
+		{
+			return loadFile(file) || loadFile((std::string(file) + ".tmp").c_str());
+		}
+		checkpointEntry const* find(char const* name)const
+		{
+			for (checkpointEntry const& e : entries)
+				if (!strncmp(e.name, name, sizeof(e.name)))return &e;
+			return nullptr;
+		}
+		//in place, no copy: valid while the reader lives, dim 0 if there is no such array
+		vec view(char const* name)const
+		{
+			checkpointEntry const* e(find(name));
+			if (!e)return vec(data, 0, Type::Parasitic);
+			return vec(data + e->offset, e->dim, Type::Parasitic);
+		}
+		//copy into a (resized if Native), false if missing or a is too short
+		bool get(char const* name, vec& a)const
+		{
+			checkpointEntry const* e(find(name));
+			if (!e)return false;
+			if (a.dim != e->dim)
+			{
+				if (a.type != Type::Native)return false;
+				a.reconstruct(e->dim, false);
+				a.dim = e->dim;
+			}
+			if (e->dim)memcpy64d(a.data + a.beginning, data + e->offset, e->dim);
+			return true;
+		}
+		double scalar(char const* name, double fallback = 0)const
+		{
+			checkpointEntry const* e(find(name));
+			return e && e->dim ? data[e->offset] : fallback;
+		}
+
+	private:
+		bool loadFile(char const* file)
+		{
+			FILE* fp(::fopen(file, "rb"));
+			if (!fp)return false;
+			checkpointHeader h;
+			bool ok(::fread(&h, sizeof(h), 1, fp) == 1 && !memcmp(h.magic, "BLASCKPT", 8) && h.version == 1);
+			std::vector<checkpointEntry> e;
+			double* d(nullptr);
+			if (ok)
+			{
+				e.resize(h.entryNum);
+				ok = !h.entryNum || ::fread(e.data(), sizeof(checkpointEntry), h.entryNum, fp) == h.entryNum;
+			}
+			if (ok && h.payload)
+			{
+				d = malloc64d(h.payload);
+				ok = ::fread(d, sizeof(double), h.payload, fp) == h.payload;
+			}
+			::fclose(fp);
+			if (ok)ok = checkpointSum(d, h.payload) == h.checksum;
+			for (unsigned long long c0(0); ok && c0 < e.size(); ++c0)
+				ok = e[c0].offset + e[c0].dim <= h.payload;
+			if (!ok)
+			{
+				if (d)_mm_free(d);
+				return false;
+			}
+			if (data)_mm_free(data);
+			data = d;
+			payload = h.payload;
+			entries.swap(e);
+			return true;
+		}
+	};
+	//periodic checkpoints written by a background thread: offer(fill) runs fill(writer) on the caller's thread
+	//(a copy of the state) only when period seconds have passed and the last snapshot is on disk,
+	//the file is written while the caller goes on
+	struct checkpointThread
+	{
+		std::string file;
+		double period;//seconds
+		unsigned long long snapshots;
+		unsigned long long written;
+		unsigned long long failed;
+
+		checkpointThread(char const* _file, double _period)
+			:
+			file(_file),
+			period(_period),
+			snapshots(0),
+			written(0),
+			failed(0),
+			writer(),
+			last(std::chrono::steady_clock::now()),
+			pending(false),
+			quit(false),
+			worker([this]() { work(); })
+		{
+		}
+		checkpointThread(checkpointThread const&) = delete;
+		~checkpointThread()
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				quit = true;
+			}
+			wake.notify_all();
+			worker.join();
+		}
+		//true if a snapshot was taken, force: whatever the time, after waiting for the last one
+		template<class F>bool offer(F&& fill, bool force = false)
+		{
+			if (force)flush();
+			else
+			{
+				std::chrono::duration<double> dt(std::chrono::steady_clock::now() - last);
+				if (dt.count() < period)return false;
+				std::lock_guard<std::mutex> guard(lock);
+				if (pending)return false;
+			}
+			writer.clear();
+			fill(writer);
+			last = std::chrono::steady_clock::now();
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				pending = true;
+				snapshots++;
+			}
+			wake.notify_all();
+			return true;
+		}
+		//wait until the last snapshot is on disk
+		void flush()
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this]() { return !pending; });
+		}
+
+	private:
+		checkpointWriter writer;
+		std::chrono::steady_clock::time_point last;
+		std::mutex lock;
+		std::condition_variable wake;
+		bool pending;
+		bool quit;
+		std::thread worker;
+
+		void work()
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			for (;;)
+			{
+				wake.wait(guard, [this]() { return pending || quit; });
+				if (pending)
+				{
+					guard.unlock();
+					bool ok(writer.save(file.c_str()));
+					guard.lock();
+					if (ok)written++;
+					else failed++;
+					pending = false;
+					wake.notify_all();
+				}
+				else if (quit)return;
+			}
+		}
+	};
+
+	//limited memory BFGS for min f(x), f(x, g) returns f(x) and writes the gradient into g
+	//two loop recursion over the last m pairs (s, y), scaled by (s, y) / (y, y),
+	//steps from the More-Thuente line search (strong Wolfe conditions, safeguarded cubic and quadratic steps)
+	struct lbfgs
+	{
+		unsigned long long m;//history
+		double eps;//stop when |g| <= eps max(1, |x|)
+		unsigned long long maxIter;
+		double ftol;//sufficient decrease
+		double gtol;//curvature
+		double xtol;//relative width of the bracket
+		double fnoise;//relative rounding noise of f: near the minimum a step that keeps the curvature condition
+		//and raises f by at most fnoise |f| is taken (approximate Wolfe, Hager and Zhang)
+		unsigned long long maxLineSearch;
+		bool verbose;
+		std::function<void(unsigned long long, double, double)> monitor;//called with (iteration, f, |g|)
+		std::function<void(lbfgs const&, vec const&)> progress;//called after every step with the new x, e.g. to checkpoint
+		//pairs (s, y) in a ring, kept between calls: minimize(f, x, true) goes on with them (see save, load)
+		std::vector<vec> s, y;
+		std::vector<double> rho;
+		unsigned long long head;
+		unsigned long long size;
+		//result of the last minimize
+		unsigned long long iters;
+		unsigned long long evaluations;
+		double value;
+		double gNorm;
+		bool converged;
+
+		lbfgs(unsigned long long _m = 8, double _eps = 1e-10, unsigned long long _maxIter = 100000)
+			:
+			m(_m ? _m : 1), eps(_eps), maxIter(_maxIter), ftol(1e-4), gtol(0.9), xtol(1e-16), fnoise(1e-12), maxLineSearch(40),
+			verbose(false), monitor(), progress(), s(), y(), rho(m, 0), head(0), size(0),
+			iters(0), evaluations(0), value(0), gNorm(0), converged(false)
+		{
+		}
+
+		//x: start in, minimiser out; returns f(x); resume: keep the pairs of the last call or of load
+		template<class F>double minimize(F&& f, vec& x, bool resume = false)
+		{
+			unsigned long long n(x.dim);
+			iters = evaluations = 0;
+			converged = false;
+			vec g(n, false), d(n, false), xt(n, false), gt(n, false);
+			std::vector<double> alpha(m, 0);
+			if (!resume || (s.size() && s[0].dim != n))
+			{
+				s.clear();
+				y.clear();
+				rho.assign(m, 0);
+				head = size = 0;
+			}
+			value = f(x, g);
+			evaluations++;
+			gNorm = ::sqrt(g.norm2Square());
+			for (; iters < maxIter; ++iters)
+			{
+				if (monitor)monitor(iters, value, gNorm);
+				if (gNorm <= eps * (x.norm2() > 1 ? x.norm2() : 1))
+				{
+					converged = true;
+					break;
+				}
+				//d = -H g
+				d = g;
+				for (unsigned long long c0(0); c0 < size; ++c0)
+				{
+					unsigned long long k((head + m - 1 - c0) % m);
+					alpha[k] = rho[k] * (s[k], d);
+					d.fmadd(-alpha[k], y[k]);
+				}
+				if (size)
+				{
+					unsigned long long k((head + m - 1) % m);
+					d *= 1 / (rho[k] * y[k].norm2Square());
+				}
+				for (unsigned long long c0(size); c0 > 0; --c0)
+				{
+					unsigned long long k((head + m - c0) % m);
+					double beta(rho[k] * (y[k], d));
+					d.fmadd(alpha[k] - beta, s[k]);
+				}
+				d.neg();
+				double dg((d, g));
+				if (dg >= 0)
+				{
+					//lost descent, start over from steepest descent
+					size = 0;
+					d = g;
+					d.neg();
+					dg = -gNorm * gNorm;
+				}
+				double stp(size ? 1 : 1 / gNorm);
+				double ft;
+				if (!lineSearch(f, x, d, value, dg, stp, xt, gt, ft))break;
+				//s = xt - x, y = gt - g
+				if (s.size() < m)
+				{
+					s.emplace_back(n, false);
+					y.emplace_back(n, false);
+				}
+				vec& sk(s[head]);
+				vec& yk(y[head]);
+				sk = xt;
+				sk -= x;
+				yk = gt;
+				yk -= g;
+				double sy((sk, yk));
+				if (sy > 0)
+				{
+					rho[head] = 1 / sy;
+					head = (head + 1) % m;
+					if (size < m)size++;
+				}
+				x = xt;
+				g = gt;
+				value = ft;
+				gNorm = ::sqrt(g.norm2Square());
+				if (progress)progress(*this, x);
+			}
+			if (verbose)::printf("iters:\t%llu\tevaluations:\t%llu\n", iters, evaluations);
+			return value;
+		}
+		//the pairs, oldest first
+		void save(checkpointWriter& w)const
+		{
+			unsigned long long n(size ? s[0].dim : 0);
+			double* p(w.array("lbfgs.s", size * n));
+			for (unsigned long long c0(0); c0 < size; ++c0)memcpy64d(p + c0 * n, s[(head + m - size + c0) % m].data, n);
+			p = w.array("lbfgs.y", size * n);
+			for (unsigned long long c0(0); c0 < size; ++c0)memcpy64d(p + c0 * n, y[(head + m - size + c0) % m].data, n);
+			p = w.array("lbfgs.rho", size);
+			for (unsigned long long c0(0); c0 < size; ++c0)p[c0] = rho[(head + m - size + c0) % m];
+		}
+		//pairs for vectors of dim n, false if the checkpoint has none that fit
+		bool load(checkpointReader const& r, unsigned long long n)
+		{
+			checkpointEntry const* es(r.find("lbfgs.s")), * ey(r.find("lbfgs.y")), * er(r.find("lbfgs.rho"));
+			s.clear();
+			y.clear();
+			rho.assign(m, 0);
+			head = size = 0;
+			if (!es || !ey || !er || !n || es->dim != er->dim * n || ey->dim != es->dim)return false;
+			//the newest m if the checkpoint kept more
+			unsigned long long num(er->dim), skip(num > m ? num - m : 0);
+			for (unsigned long long c0(skip); c0 < num; ++c0)
+			{
+				s.emplace_back(n, false);
+				y.emplace_back(n, false);
+				memcpy64d(s.back().data, r.data + es->offset + c0 * n, n);
+				memcpy64d(y.back().data, r.data + ey->offset + c0 * n, n);
+				rho[size++] = r.data[er->offset + c0];
+			}
+			head = size % m;
+			return true;
+		}
+
+	private:
+		//More and Thuente (1994), as dcsrch of MINPACK-2; false if no acceptable step was found
+		template<class F>bool lineSearch(F&& f, vec const& x, vec const& d, double f0, double g0, double& stp,
+			vec& xt, vec& gt, double& ft)
+		{
+			constexpr double xtrapl = 1.1, xtrapu = 4.0;
+			double stpmin(0), stpmax(1e20);
+			bool brackt(false);
+			unsigned long long stage(1);
+			double gtest(ftol * g0);
+			double width(stpmax - stpmin), width1(2 * width);
+			double stx(0), fx(f0), gx(g0);
+			double sty(0), fy(f0), gy(g0);
+			double stmin(0), stmax(stp + xtrapu * stp);
+			for (unsigned long long c0(0); c0 < maxLineSearch; ++c0)
+			{
+				xt.fmadd(stp, d, x);
+				ft = f(xt, gt);
+				evaluations++;
+				double gp((d, gt));
+				double ftest(f0 + stp * gtest);
+				if (stage == 1 && ft <= ftest && gp >= 0)stage = 2;
+				if (abs(gp) <= gtol * (-g0) && (ft <= ftest || ft <= f0 + fnoise * abs(f0)))return true;
+				if (brackt && (stp <= stmin || stp >= stmax))return ft < f0;
+				if (brackt && stmax - stmin <= xtol * stmax)return ft < f0;
+				if (stp == stpmax && ft <= ftest && gp <= gtest)return true;
+				if (stp == stpmin && (ft > ftest || gp >= gtest))return false;
+				if (stage == 1 && ft <= fx && ft > ftest)
+				{
+					//modified function psi(a) = f(a) - f0 - a gtest
+					double fm(ft - stp * gtest), fxm(fx - stx * gtest), fym(fy - sty * gtest);
+					double gm(gp - gtest), gxm(gx - gtest), gym(gy - gtest);
+					step(stx, fxm, gxm, sty, fym, gym, stp, fm, gm, brackt, stmin, stmax);
+					fx = fxm + stx * gtest;
+					fy = fym + sty * gtest;
+					gx = gxm + gtest;
+					gy = gym + gtest;
+				}
+				else step(stx, fx, gx, sty, fy, gy, stp, ft, gp, brackt, stmin, stmax);
+				if (brackt)
+				{
+					if (abs(sty - stx) >= 0.66 * width1)stp = stx + 0.5 * (sty - stx);
+					width1 = width;
+					width = abs(sty - stx);
+					stmin = stx < sty ? stx : sty;
+					stmax = stx < sty ? sty : stx;
+				}
+				else
+				{
+					stmin = stp + xtrapl * (stp - stx);
+					stmax = stp + xtrapu * (stp - stx);
+				}
+				if (stp < stpmin)stp = stpmin;
+				if (stp > stpmax)stp = stpmax;
+				if ((brackt && (stp <= stmin || stp >= stmax)) || (brackt && stmax - stmin <= xtol * stmax))stp = stx;
+			}
+			//out of evaluations: keep the best point if it went down
+			if (fx < f0 && stx > 0)
+			{
+				xt.fmadd(stx, d, x);
+				ft = f(xt, gt);
+				evaluations++;
+				stp = stx;
+				return true;
+			}
+			return false;
+		}
+		//dcstep: new trial step from the bracket [stx, sty] and the trial stp, interval updated
+		static void step(double& stx, double& fx, double& dx, double& sty, double& fy, double& dy,
+			double& stp, double fp, double dp, bool& brackt, double stpmin, double stpmax)
+		{
+			double sgnd(dp * (dx / abs(dx)));
+			double stpf;
+			if (fp > fx)
+			{
+				//higher function value: the minimum is bracketed
+				double theta(3 * (fx - fp) / (stp - stx) + dx + dp);
+				double s(max3(abs(theta), abs(dx), abs(dp)));
+				double gamma(s * ::sqrt((theta / s) * (theta / s) - (dx / s) * (dp / s)));
+				if (stp < stx)gamma = -gamma;
+				double p((gamma - dx) + theta), q(((gamma - dx) + gamma) + dp);
+				double stpc(stx + (p / q) * (stp - stx));
+				double stpq(stx + ((dx / ((fx - fp) / (stp - stx) + dx)) / 2) * (stp - stx));
+				stpf = abs(stpc - stx) < abs(stpq - stx) ? stpc : stpc + (stpq - stpc) / 2;
+				brackt = true;
+			}
+			else if (sgnd < 0)
+			{
+				//derivatives of opposite sign: bracketed
+				double theta(3 * (fx - fp) / (stp - stx) + dx + dp);
+				double s(max3(abs(theta), abs(dx), abs(dp)));
+				double gamma(s * ::sqrt((theta / s) * (theta / s) - (dx / s) * (dp / s)));
+				if (stp > stx)gamma = -gamma;
+				double p((gamma - dp) + theta), q(((gamma - dp) + gamma) + dx);
+				double stpc(stp + (p / q) * (stx - stp));
+				double stpq(stp + (dp / (dp - dx)) * (stx - stp));
+				stpf = abs(stpc - stp) > abs(stpq - stp) ? stpc : stpq;
+				brackt = true;
+			}
+			else if (abs(dp) < abs(dx))
+			{
+				//same sign, derivative decreasing in magnitude
+				double theta(3 * (fx - fp) / (stp - stx) + dx + dp);
+				double s(max3(abs(theta), abs(dx), abs(dp)));
+				double t((theta / s) * (theta / s) - (dx / s) * (dp / s));
+				double gamma(s * ::sqrt(t > 0 ? t : 0));
+				if (stp > stx)gamma = -gamma;
+				double p((gamma - dp) + theta), q((gamma + (dx - dp)) + gamma);
+				double r(p / q);
+				double stpc;
+				if (r < 0 && gamma != 0)stpc = stp + r * (stx - stp);
+				else stpc = stp > stx ? stpmax : stpmin;
+				double stpq(stp + (dp / (dp - dx)) * (stx - stp));
+				if (brackt)
+				{
+					stpf = abs(stpc - stp) < abs(stpq - stp) ? stpc : stpq;
+					double lim(stp + 0.66 * (sty - stp));
+					if (stp > stx)stpf = stpf < lim ? stpf : lim;
+					else stpf = stpf > lim ? stpf : lim;
+				}
+				else
+				{
+					stpf = abs(stpc - stp) > abs(stpq - stp) ? stpc : stpq;
+					if (stpf > stpmax)stpf = stpmax;
+					if (stpf < stpmin)stpf = stpmin;
+				}
+			}
+			else
+			{
+				//same sign, derivative not decreasing
+				if (brackt)
+				{
+					double theta(3 * (fp - fy) / (sty - stp) + dy + dp);
+					double s(max3(abs(theta), abs(dy), abs(dp)));
+					double gamma(s * ::sqrt((theta / s) * (theta / s) - (dy / s) * (dp / s)));
+					if (stp > sty)gamma = -gamma;
+					double p((gamma - dp) + theta), q(((gamma - dp) + gamma) + dy);
+					stpf = stp + (p / q) * (sty - stp);
+				}
+				else stpf = stp > stx ? stpmax : stpmin;
+			}
+			if (fp > fx)
+			{
+				sty = stp;
+				fy = fp;
+				dy = dp;
+			}
+			else
+			{
+				if (sgnd < 0)
+				{
+					sty = stx;
+					fy = fx;
+					dy = dx;
+				}
+				stx = stp;
+				fx = fp;
+				dx = dp;
+			}
+			stp = stpf;
+		}
+		static double max3(double a, double b, double c)
+		{
+			double r(a > b ? a : b);
+			return r > c ? r : c;
+		}
+	};
+
+	//k lowest eigenpairs of a symmetric operator known only by op(x, y): y = A x, so A is never stored
+	//block Krylov space grown from p random vectors, each new vector is orthogonalised twice against the whole basis
+	//and against the rows of deflate; the Gram-Schmidt coefficients are T = Q^T A Q, which gives the Ritz pairs
+	//and their residuals; p >= the multiplicity of an eigenvalue finds all its eigenvectors,
+	//a full basis is thick restarted from the lowest Ritz vectors and the last block
+	struct blockLanczos
+	{
+		unsigned long long k;//wanted
+		unsigned long long p;//block
+		unsigned long long maxBasis;
+		unsigned long long check;//Rayleigh-Ritz every check products
+		unsigned long long maxRestart;
+		double tol;//residual relative to the largest Ritz value
+		bool verbose;
+		//result of the last run
+		unsigned long long products;
+		unsigned long long restarts;
+		unsigned long long converged;
+
+		blockLanczos(unsigned long long _k, unsigned long long _p = 4, unsigned long long _maxBasis = 0, double _tol = 1e-8)
+			:
+			k(_k ? _k : 1), p(_p ? _p : 1),
+			maxBasis(_maxBasis ? _maxBasis : 8 * (k + p) > 64 ? 8 * (k + p) : 64),
+			check(16), maxRestart(100), tol(_tol), verbose(false), products(0), restarts(0), converged(0)
+		{
+		}
+
+		//values: the k lowest eigenvalues in ascending order, vectors (if not null): their eigenvectors in rows
+		//deflate: orthonormal rows of width n that are left out of the search, e.g. known zero modes
+		template<class A>vec& lowest(A&& op, unsigned long long n, vec& values, mat* vectors = nullptr, mat const* deflate = nullptr)
+		{
+			products = restarts = converged = 0;
+			unsigned long long cap(maxBasis > k + 2 * p ? maxBasis : k + 2 * p);
+			if (cap > n)cap = n;
+			mat q(n, cap + p, false);
+			mat t(cap + p, cap + p, true);
+			vec w(n, false);
+			std::mt19937 mt(0);
+			std::uniform_real_distribution<double> rd(-1, 1);
+			unsigned long long size(0);
+			for (unsigned long long c0(0); c0 < p && size < cap; ++c0)
+			{
+				for (unsigned long long c1(0); c1 < n; ++c1)w.data[c1] = rd(mt);
+				double h[1];
+				if (append(q, size, w, deflate, h, 0))size++;
+			}
+			unsigned long long c(0);//vectors [0, c) have been multiplied by A
+			unsigned long long next(check);
+			vec theta;
+			mat s;
+			std::vector<unsigned long long> order;
+			std::vector<double> hw(cap + p);
+			bool done(false);
+			while (!done)
+			{
+				if (c < size && size < cap + p && c < cap)
+				{
+					vec qc(q.data + c * q.width4d, n, Type::Parasitic);
+					op(qc, w);
+					products++;
+					bool grown(append(q, size, w, deflate, hw.data(), size));
+					for (unsigned long long c1(0); c1 < size; ++c1)t(c1, c) = t(c, c1) = hw[c1];
+					if (grown)
+					{
+						t(size, c) = t(c, size) = hw[size];
+						size++;
+					}
+					c++;
+					if (c < next && c < size && c < cap)continue;
+				}
+				next = c + check;
+				//Rayleigh-Ritz on the first c vectors, rows [c, size) of t hold the residuals
+				ritz(t, c, theta, s, order);
+				double scale(0);
+				for (unsigned long long c0(0); c0 < c; ++c0)
+					if (abs(theta[c0]) > scale)scale = abs(theta[c0]);
+				unsigned long long want(k < c ? k : c);
+				converged = 0;
+				while (converged < want && residual(t, c, size, s, order[converged]) <= tol * scale)converged++;
+				if (verbose)::printf("lanczos: %llu products, basis %llu, %llu converged, lowest %.10e\n",
+					products, c, converged, c ? theta[order[0]] : 0.0);
+				if ((converged == k && c >= k) || c == size)break;
+				if (c < cap && size < cap + p)continue;
+				if (restarts == maxRestart)break;
+				//thick restart: the lowest Ritz vectors, then the unexpanded vectors [c, size)
+				restarts++;
+				unsigned long long keep(k + p > cap / 2 ? k + p : cap / 2);
+				if (keep > c)keep = c;
+				unsigned long long rest(size - c);
+				mat y(n, keep + rest, true);
+				for (unsigned long long c0(0); c0 < keep; ++c0)
+					for (unsigned long long c1(0); c1 < c; ++c1)
+						fmadd64d(y.data + c0 * y.width4d, s(order[c0], c1), q.data + c1 * q.width4d, n);
+				for (unsigned long long c0(0); c0 < rest; ++c0)
+					memcpy64d(y.data + (keep + c0) * y.width4d, q.data + (c + c0) * q.width4d, n);
+				mat tn(cap + p, cap + p, true);
+				for (unsigned long long c0(0); c0 < keep; ++c0)
+				{
+					tn(c0, c0) = theta[order[c0]];
+					for (unsigned long long c1(0); c1 < rest; ++c1)
+					{
+						double r(0);
+						for (unsigned long long c2(0); c2 < c; ++c2)r += t(c + c1, c2) * s(order[c0], c2);
+						tn(keep + c1, c0) = tn(c0, keep + c1) = r;
+					}
+				}
+				for (unsigned long long c0(0); c0 < keep + rest; ++c0)
+					memcpy64d(q.data + c0 * q.width4d, y.data + c0 * y.width4d, n);
+				t = (mat&&)tn;
+				c = keep;
+				size = keep + rest;
+				next = c + check;
+			}
+			unsigned long long m(k < c ? k : c);
+			values.reconstruct(m, false);
+			for (unsigned long long c0(0); c0 < m; ++c0)values[c0] = theta[order[c0]];
+			if (vectors)
+			{
+				if (vectors->width != n || vectors->height != m)vectors->reconstruct(n, m, true);
+				else vectors->clear();
+				for (unsigned long long c0(0); c0 < m; ++c0)
+					for (unsigned long long c1(0); c1 < c; ++c1)
+						fmadd64d(vectors->data + c0 * vectors->width4d, s(order[c0], c1), q.data + c1 * q.width4d, n);
+			}
+			return values;
+		}
+
+	private:
+		//orthogonalise w twice against deflate and rows [0, size) of q, h[c0] gets the coefficient of row c0 and
+		//h[size] the norm of what is left; appends it as row size unless it is lost in rounding
+		bool append(mat& q, unsigned long long size, vec& w, mat const* deflate, double* h, unsigned long long hNum)const
+		{
+			unsigned long long n(w.dim);
+			double norm0(::sqrt(dot64d(w.data, w.data, n)));
+			for (unsigned long long c0(0); c0 < hNum; ++c0)h[c0] = 0;
+			for (unsigned long long c3(0); c3 < 2; ++c3)
+			{
+				if (deflate)
+					for (unsigned long long c0(0); c0 < deflate->height; ++c0)
+					{
+						double const* d(deflate->data + c0 * deflate->width4d);
+						fmadd64d(w.data, -dot64d(w.data, d, n), d, n);
+					}
+				for (unsigned long long c0(0); c0 < size; ++c0)
+				{
+					double const* r(q.data + c0 * q.width4d);
+					double a(dot64d(w.data, r, n));
+					fmadd64d(w.data, -a, r, n);
+					if (c0 < hNum)h[c0] += a;
+				}
+			}
+			double norm(::sqrt(dot64d(w.data, w.data, n)));
+			h[hNum] = norm;
+			if (norm <= 1e-10 * norm0 || norm == 0 || size == q.height)return false;
+			double* r(q.data + size * q.width4d);
+			for (unsigned long long c0(0); c0 < n; ++c0)r[c0] = w.data[c0] / norm;
+			return true;
+		}
+		//eigenpairs of the leading c x c block of t, order: indices by ascending eigenvalue
+		static void ritz(mat const& t, unsigned long long c, vec& theta, mat& s, std::vector<unsigned long long>& order)
+		{
+			mat h(c, c, false);
+			for (unsigned long long c0(0); c0 < c; ++c0)memcpy64d(h.data + c0 * h.width4d, t.data + c0 * t.width4d, c);
+			h.eigenSymmetric(theta, s);
+			order.resize(c);
+			for (unsigned long long c0(0); c0 < c; ++c0)order[c0] = c0;
+			std::sort(order.begin(), order.end(), [&theta](unsigned long long a, unsigned long long b)
+				{
+					return theta.data[a] < theta.data[b];
+				});
+		}
+		//|A y - theta y| of Ritz vector j: the part of A y outside the first c vectors
+		static double residual(mat const& t, unsigned long long c, unsigned long long size, mat const& s, unsigned long long j)
+		{
+			double r2(0);
+			for (unsigned long long c0(c); c0 < size; ++c0)
+			{
+				double r(0);
+				for (unsigned long long c1(0); c1 < c; ++c1)r += t.data[c0 * t.width4d + c1] * s.data[j * s.width4d + c1];
+				r2 += r * r;
+			}
+			return ::sqrt(r2);
+		}
+	};
+
+	//explicit integrators on batches kept structure of arrays: the state is a mat with one row per component and one
+	//column (lane) per system, so every stage update is a sweep over contiguous rows; the lanes are independent small
+	//systems, or all of them make up one system (e.g. 3 rows x N particles)
+
+	//q' = v, v' = a(q), kick-drift compositions: kick k[0], drift d[0], kick k[1], ..., drift d[s - 1], kick k[s];
+	//leapfrog is kick-drift-kick, Yoshida4 the triple jump of it (order 4, 3 evaluations of a per step);
+	//the last a of a step is kept for the first kick of the next
+	struct odeSymplectic
+	{
+		enum class Scheme
+		{
+			Leapfrog,
+			Yoshida4,
+		};
+		Scheme scheme;
+		mat a;
+		bool fresh;//a belongs to the current q
+		unsigned long long evaluations;
+
+		odeSymplectic(Scheme _scheme = Scheme::Leapfrog)
+			:
+			scheme(_scheme), a(), fresh(false), evaluations(0)
+		{
+		}
+		//k: s + 1 kicks, d: s drifts, returns s
+		static unsigned long long coefficients(Scheme scheme, double* k, double* d)
+		{
+			if (scheme == Scheme::Leapfrog)
+			{
+				k[0] = k[1] = 0.5;
+				d[0] = 1;
+				return 1;
+			}
+			double w1(1 / (2 - ::cbrt(2.0))), w0(1 - 2 * w1);
+			k[0] = k[3] = w1 / 2;
+			k[1] = k[2] = (w0 + w1) / 2;
+			d[0] = d[2] = w1;
+			d[1] = w0;
+			return 3;
+		}
+		//acc(q, a) fills a, which has the shape of q
+		template<class A>void step(A&& acc, mat& q, mat& v, double h)
+		{
+			unsigned long long n(q.height * q.width4d);
+			if (a.width != q.width || a.height != q.height)
+			{
+				a.reconstruct(q.width, q.height, true);
+				fresh = false;
+			}
+			if (!fresh)
+			{
+				acc(q, a);
+				evaluations++;
+			}
+			double k[4], d[3];
+			unsigned long long s(coefficients(scheme, k, d));
+			for (unsigned long long c0(0); c0 < s; ++c0)
+			{
+				fmadd64d(v.data, k[c0] * h, a.data, n);
+				fmadd64d(q.data, d[c0] * h, v.data, n);
+				acc(q, a);
+				evaluations++;
+			}
+			fmadd64d(v.data, k[s] * h, a.data, n);
+			fresh = true;
+		}
+		template<class A>void run(A&& acc, mat& q, mat& v, double h, unsigned long long steps)
+		{
+			for (unsigned long long c0(0); c0 < steps; ++c0)step(acc, q, v, h);
+		}
+		//call after changing q from outside
+		void touch()
+		{
+			fresh = false;
+		}
+	};
+	//y' = f(t, y): f(t, y, dy) with t the time of every lane (a vec of y.width), classical fourth order
+	struct odeRK4
+	{
+		mat k1, k2, k3, k4, yt;
+		vec t;
+		unsigned long long evaluations;
+
+		odeRK4() :k1(), k2(), k3(), k4(), yt(), t(), evaluations(0) {}
+		template<class F>void step(F&& f, double t0, mat& y, double h)
+		{
+			unsigned long long n(y.height * y.width4d);
+			if (k1.width != y.width || k1.height != y.height)
+			{
+				k1.reconstruct(y.width, y.height, true);
+				k2.reconstruct(y.width, y.height, true);
+				k3.reconstruct(y.width, y.height, true);
+				k4.reconstruct(y.width, y.height, true);
+				yt.reconstruct(y.width, y.height, true);
+			}
+			if (t.dim != y.width)t.reconstruct(y.width, false);
+			auto eval = [&](double tc, mat const& yc, mat& dy)
+			{
+				for (unsigned long long c0(0); c0 < t.dim; ++c0)t.data[c0] = tc;
+				f((vec const&)t, yc, dy);
+				evaluations++;
+			};
+			eval(t0, y, k1);
+			memcpy64d(yt.data, y.data, n);
+			fmadd64d(yt.data, h / 2, k1.data, n);
+			eval(t0 + h / 2, yt, k2);
+			memcpy64d(yt.data, y.data, n);
+			fmadd64d(yt.data, h / 2, k2.data, n);
+			eval(t0 + h / 2, yt, k3);
+			memcpy64d(yt.data, y.data, n);
+			fmadd64d(yt.data, h, k3.data, n);
+			eval(t0 + h, yt, k4);
+			__m256d h6(_mm256_set1_pd(h / 6)), two(_mm256_set1_pd(2));
+			for (unsigned long long c0(0); c0 < n; c0 += 4)
+			{
+				__m256d s(_mm256_add_pd(_mm256_load_pd(k1.data + c0), _mm256_load_pd(k4.data + c0)));
+				s = _mm256_fmadd_pd(two, _mm256_add_pd(_mm256_load_pd(k2.data + c0), _mm256_load_pd(k3.data + c0)), s);
+				_mm256_store_pd(y.data + c0, _mm256_fmadd_pd(h6, s, _mm256_load_pd(y.data + c0)));
+			}
+		}
+		template<class F>void run(F&& f, double t0, double t1, mat& y, unsigned long long steps)
+		{
+			double h((t1 - t0) / steps);
+			for (unsigned long long c0(0); c0 < steps; ++c0)step(f, t0 + c0 * h, y, h);
+		}
+	};
+	//y' = f(t, y) by Dormand-Prince 5(4) with FSAL: every lane takes its own steps under
+	//rms_r |err_r| / (atol + rtol max(|y_r|, |y_new_r|)) <= 1, lanes that are done or rejected keep their y while the
+	//others go on, so a batch of small systems runs as one; shared: one step size for the whole mat (one system);
+	//f(t, y, dy) as in odeRK4 with the time of every lane
+	struct odeDoPri
+	{
+		//Butcher tableau; a function-local static needs no out-of-class definition before C++17
+		struct Tableau
+		{
+			double c[7];
+			double a[7][6];
+			double e[7];//fifth minus fourth order weights
+		};
+		static Tableau const& tableau()
+		{
+			static constexpr Tableau t
+			{
+				{ 0, 1.0 / 5, 3.0 / 10, 4.0 / 5, 8.0 / 9, 1, 1 },
+				{
+					{ 0 },
+					{ 1.0 / 5 },
+					{ 3.0 / 40, 9.0 / 40 },
+					{ 44.0 / 45, -56.0 / 15, 32.0 / 9 },
+					{ 19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729 },
+					{ 9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656 },
+					{ 35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84 },
+				},
+				{ 71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525, -1.0 / 40 },
+			};
+			return t;
+		}
+		double rtol;
+		double atol;
+		double safety;
+		double minFactor;
+		double maxFactor;
+		double hMax;//0: t1 - t0
+		unsigned long long maxSteps;//attempts per lane
+		bool shared;
+		mat k[7];
+		mat yt;
+		vec t, h, hs, ts, err;
+		vec mask;//accepted lanes
+		//statistics of the last run, summed over lanes
+		unsigned long long steps;
+		unsigned long long rejects;
+		unsigned long long evaluations;//calls of f
+
+		odeDoPri(double _rtol = 1e-8, double _atol = 1e-10)
+			:
+			rtol(_rtol), atol(_atol), safety(0.9), minFactor(0.2), maxFactor(5), hMax(0), maxSteps(1000000),
+			shared(false), k(), yt(), t(), h(), hs(), ts(), err(), mask(),
+			steps(0), rejects(0), evaluations(0)
+		{
+		}
+		//y at t0 in, at t1 out; false if a lane ran out of steps or its step fell below the rounding of t
+		template<class F>bool run(F&& f, double t0, double t1, mat& y)
+		{
+			unsigned long long w(y.width), w4(y.width4d), rows(y.height);
+			if (yt.width != w || yt.height != rows)
+			{
+				for (unsigned long long c0(0); c0 < 7; ++c0)k[c0].reconstruct(w, rows, true);
+				yt.reconstruct(w, rows, true);
+			}
+			t.reconstruct(w4, false);
+			h.reconstruct(w4, false);
+			mask.reconstruct(w4, true);
+			hs.reconstruct(w4, false);
+			ts.reconstruct(w4, false);
+			err.reconstruct(w4, false);
+			steps = rejects = evaluations = 0;
+			if (!(t1 > t0))return t1 == t0;
+			double hm(hMax > 0 ? hMax : t1 - t0);
+			for (unsigned long long c0(0); c0 < w4; ++c0)t.data[c0] = c0 < w ? t0 : t1;
+			eval(f, t, y, k[0]);
+			//first step of every lane from |y| and |f| (Hairer, Norsett and Wanner)
+			weightedSquares(&y, y, y, err);
+			weightedSquares(k, y, y, hs);
+			double hMin(hm);
+			for (unsigned long long c0(0); c0 < w; ++c0)
+			{
+				double d0(::sqrt(err.data[c0] / rows)), d1(::sqrt(hs.data[c0] / rows));
+				double h0(d0 < 1e-5 || d1 < 1e-5 ? 1e-6 : 0.01 * d0 / d1);
+				h.data[c0] = h0 < hm ? h0 : hm;
+				if (h.data[c0] < hMin)hMin = h.data[c0];
+			}
+			if (shared)for (unsigned long long c0(0); c0 < w; ++c0)h.data[c0] = hMin;
+			for (unsigned long long round(0); round < maxSteps; ++round)
+			{
+				unsigned long long active(0);
+				for (unsigned long long c0(0); c0 < w4; ++c0)
+				{
+					double left(t1 - t.data[c0]);
+					hs.data[c0] = c0 < w && left > 0 ? (h.data[c0] < left ? h.data[c0] : left) : 0;
+					if (hs.data[c0] > 0)
+					{
+						active++;
+						if (t.data[c0] + hs.data[c0] == t.data[c0])return false;
+					}
+				}
+				if (!active)return true;
+				for (unsigned long long s(1); s < 7; ++s)
+				{
+					stage(y, s);
+					for (unsigned long long c0(0); c0 < w4; ++c0)ts.data[c0] = t.data[c0] + tableau().c[s] * hs.data[c0];
+					eval(f, ts, yt, k[s]);
+				}
+				//yt is the fifth order solution, k[6] its slope
+				weightedSquares(nullptr, y, yt, err);
+				double all(0);
+				if (shared)
+				{
+					for (unsigned long long c0(0); c0 < w; ++c0)all += err.data[c0];
+					all = ::sqrt(all / (rows * w));
+				}
+				for (unsigned long long c0(0); c0 < w; ++c0)
+				{
+					unsigned long long& m(((unsigned long long*)mask.data)[c0]);
+					m = 0;
+					if (!(hs.data[c0] > 0))continue;
+					double r(shared ? all : ::sqrt(err.data[c0] / rows));
+					//NaN rejects with the smallest factor
+					double factor(r > 0 ? safety * ::pow(r, -0.2) : (r == 0 ? maxFactor : minFactor));
+					if (factor > maxFactor)factor = maxFactor;
+					if (!(factor >= minFactor))factor = minFactor;
+					if (r <= 1)
+					{
+						t.data[c0] += hs.data[c0];
+						steps++;
+						m = ~0ull;
+					}
+					else
+					{
+						if (factor > 1)factor = 1;
+						rejects++;
+					}
+					h.data[c0] = hs.data[c0] * factor < hm ? hs.data[c0] * factor : hm;
+				}
+				blend(y);
+			}
+			return false;
+		}
+
+	private:
+		template<class F>void eval(F&& f, vec const& tc, mat const& yc, mat& dy)
+		{
+			f(tc, yc, dy);
+			evaluations++;
+		}
+		//yt = y + hs (a[s][0] k[0] + ... + a[s][s - 1] k[s - 1]), hs per lane
+		void stage(mat const& y, unsigned long long s)
+		{
+			Tableau const& tb(tableau());
+			unsigned long long w4(y.width4d);
+			for (unsigned long long c0(0); c0 < y.height; ++c0)
+				for (unsigned long long c1(0); c1 < w4; c1 += 4)
+				{
+					unsigned long long p(c0 * w4 + c1);
+					__m256d sum(_mm256_mul_pd(_mm256_set1_pd(tb.a[s][0]), _mm256_load_pd(k[0].data + p)));
+					for (unsigned long long c2(1); c2 < s; ++c2)
+						sum = _mm256_fmadd_pd(_mm256_set1_pd(tb.a[s][c2]), _mm256_load_pd(k[c2].data + p), sum);
+					_mm256_store_pd(yt.data + p, _mm256_fmadd_pd(_mm256_load_pd(hs.data + c1), sum, _mm256_load_pd(y.data + p)));
+				}
+		}
+		//sq[lane] = sum over rows of (x / (atol + rtol max(|y|, |z|)))^2, x = hs (e[0] k[0] + ... + e[6] k[6]) for
+		//x == nullptr
+		void weightedSquares(mat const* x, mat const& y, mat const& z, vec& sq)
+		{
+			Tableau const& tb(tableau());
+			unsigned long long w4(y.width4d);
+			__m256d at(_mm256_set1_pd(atol)), rt(_mm256_set1_pd(rtol)), sign(_mm256_set1_pd(-0.0));
+			for (unsigned long long c1(0); c1 < w4; c1 += 4)_mm256_store_pd(sq.data + c1, _mm256_setzero_pd());
+			for (unsigned long long c0(0); c0 < y.height; ++c0)
+				for (unsigned long long c1(0); c1 < w4; c1 += 4)
+				{
+					unsigned long long p(c0 * w4 + c1);
+					__m256d d;
+					if (x)d = _mm256_load_pd(x->data + p);
+					else
+					{
+						d = _mm256_setzero_pd();
+						for (unsigned long long c2(0); c2 < 7; ++c2)
+							if (tb.e[c2] != 0)d = _mm256_fmadd_pd(_mm256_set1_pd(tb.e[c2]), _mm256_load_pd(k[c2].data + p), d);
+						d = _mm256_mul_pd(d, _mm256_load_pd(hs.data + c1));
+					}
+					__m256d sc(_mm256_max_pd(_mm256_andnot_pd(sign, _mm256_load_pd(y.data + p)), _mm256_andnot_pd(sign, _mm256_load_pd(z.data + p))));
+					d = _mm256_div_pd(d, _mm256_fmadd_pd(rt, sc, at));
+					_mm256_store_pd(sq.data + c1, _mm256_fmadd_pd(d, d, _mm256_load_pd(sq.data + c1)));
+				}
+		}
+		//accepted lanes: y = yt, k[0] = k[6]
+		void blend(mat& y)
+		{
+			unsigned long long w4(y.width4d);
+			for (unsigned long long c0(0); c0 < y.height; ++c0)
+				for (unsigned long long c1(0); c1 < w4; c1 += 4)
+				{
+					unsigned long long p(c0 * w4 + c1);
+					__m256d m(_mm256_load_pd(mask.data + c1));
+					_mm256_store_pd(y.data + p, _mm256_blendv_pd(_mm256_load_pd(y.data + p), _mm256_load_pd(yt.data + p), m));
+					_mm256_store_pd(k[0].data + p, _mm256_blendv_pd(_mm256_load_pd(k[0].data + p), _mm256_load_pd(k[6].data + p), m));
+				}
+		}
+	};
+
 	//misc
 	template<class T>void randomVec(vec& a, std::mt19937& mt, T& rd)
 	{
@@ -0,0 +1,873 @@
+#pragma once
+#include <_BLAS.h>
+
+//CPU counterpart of CUDA/_CUDA_NBody_Common.h: the same particles and glue, the kernels on AVX2 (AVX-512 when
+//compiled for it) and all cores
+
+struct NBodyCPUParticle
+{
+	float position[3];
+	float mass;
+	float velocity[3];
+	float v;
+};
+//ExpData of the CUDA header under its own name, so both headers can be included together
+struct NBodyCPUExpData
+{
+	float r;
+	float force;
+};
+
+//one register of T: 8 floats or 4 doubles with AVX2, twice that with AVX-512;
+//rsqrt(r2) = r2^-0.5 and rsqrt3(r2) = r2^-1.5, 0 where r2 == 0 so a particle does not see itself
+template<class T>struct NBodySimd;
+#ifdef __AVX512F__
+template<>struct NBodySimd<float>
+{
+	using V = __m512;
+	static constexpr unsigned long long width = 16;
+	static V load(float const* p) { return _mm512_load_ps(p); }
+	static V loadu(float const* p) { return _mm512_loadu_ps(p); }
+	static void store(float* p, V a) { _mm512_store_ps(p, a); }
+	static V set1(float a) { return _mm512_set1_ps(a); }
+	static V zero() { return _mm512_setzero_ps(); }
+	static V add(V a, V b) { return _mm512_add_ps(a, b); }
+	static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+	static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+	static V fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+	//14 bits from rsqrt14, one Newton step
+	static V rsqrt(V r2)
+	{
+		V r(_mm512_rsqrt14_ps(r2));
+		r = _mm512_mul_ps(r, _mm512_fnmadd_ps(_mm512_mul_ps(r2, _mm512_set1_ps(0.5f)), _mm512_mul_ps(r, r), _mm512_set1_ps(1.5f)));
+		return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(r2, _mm512_setzero_ps(), _CMP_GT_OQ), r);
+	}
+	static V rsqrt3(V r2)
+	{
+		V r(rsqrt(r2));
+		return _mm512_mul_ps(r, _mm512_mul_ps(r, r));
+	}
+};
+template<>struct NBodySimd<double>
+{
+	using V = __m512d;
+	static constexpr unsigned long long width = 8;
+	static V load(double const* p) { return _mm512_load_pd(p); }
+	static V loadu(double const* p) { return _mm512_loadu_pd(p); }
+	static void store(double* p, V a) { _mm512_store_pd(p, a); }
+	static V set1(double a) { return _mm512_set1_pd(a); }
+	static V zero() { return _mm512_setzero_pd(); }
+	static V add(V a, V b) { return _mm512_add_pd(a, b); }
+	static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+	static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+	static V fmadd(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+	//14 bits from rsqrt14, two Newton steps
+	static V rsqrt(V r2)
+	{
+		V r(_mm512_rsqrt14_pd(r2));
+		V h(_mm512_mul_pd(r2, _mm512_set1_pd(0.5)));
+		V c(_mm512_set1_pd(1.5));
+		r = _mm512_mul_pd(r, _mm512_fnmadd_pd(h, _mm512_mul_pd(r, r), c));
+		r = _mm512_mul_pd(r, _mm512_fnmadd_pd(h, _mm512_mul_pd(r, r), c));
+		return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(r2, _mm512_setzero_pd(), _CMP_GT_OQ), r);
+	}
+	static V rsqrt3(V r2)
+	{
+		V r(rsqrt(r2));
+		return _mm512_mul_pd(r, _mm512_mul_pd(r, r));
+	}
+};
+#else
+template<>struct NBodySimd<float>
+{
+	using V = __m256;
+	static constexpr unsigned long long width = 8;
+	static V load(float const* p) { return _mm256_load_ps(p); }
+	static V loadu(float const* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, V a) { _mm256_store_ps(p, a); }
+	static V set1(float a) { return _mm256_set1_ps(a); }
+	static V zero() { return _mm256_setzero_ps(); }
+	static V add(V a, V b) { return _mm256_add_ps(a, b); }
+	static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+	static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+	//12 bits from rsqrtps, one Newton step, about what rsqrtf gives on the device
+	static V rsqrt(V r2)
+	{
+		V r(_mm256_rsqrt_ps(r2));
+		r = _mm256_mul_ps(r, _mm256_fnmadd_ps(_mm256_mul_ps(r2, _mm256_set1_ps(0.5f)), _mm256_mul_ps(r, r), _mm256_set1_ps(1.5f)));
+		return _mm256_and_ps(r, _mm256_cmp_ps(r2, _mm256_setzero_ps(), _CMP_GT_OQ));
+	}
+	static V rsqrt3(V r2)
+	{
+		V r(rsqrt(r2));
+		return _mm256_mul_ps(r, _mm256_mul_ps(r, r));
+	}
+};
+template<>struct NBodySimd<double>
+{
+	using V = __m256d;
+	static constexpr unsigned long long width = 4;
+	static V load(double const* p) { return _mm256_load_pd(p); }
+	static V loadu(double const* p) { return _mm256_loadu_pd(p); }
+	static void store(double* p, V a) { _mm256_store_pd(p, a); }
+	static V set1(double a) { return _mm256_set1_pd(a); }
+	static V zero() { return _mm256_setzero_pd(); }
+	static V add(V a, V b) { return _mm256_add_pd(a, b); }
+	static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+	static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+	static V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+	//12 bits from rsqrtps, two Newton steps
+	static V rsqrt(V r2)
+	{
+		V r(_mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r2))));
+		V h(_mm256_mul_pd(r2, _mm256_set1_pd(0.5)));
+		V c(_mm256_set1_pd(1.5));
+		r = _mm256_mul_pd(r, _mm256_fnmadd_pd(h, _mm256_mul_pd(r, r), c));
+		r = _mm256_mul_pd(r, _mm256_fnmadd_pd(h, _mm256_mul_pd(r, r), c));
+		return _mm256_and_pd(r, _mm256_cmp_pd(r2, _mm256_setzero_pd(), _CMP_GT_OQ));
+	}
+	static V rsqrt3(V r2)
+	{
+		V r(rsqrt(r2));
+		return _mm256_mul_pd(r, _mm256_mul_pd(r, r));
+	}
+};
+#endif
+
+//Barnes-Hut octree over Morton keys for the field sum_j m_j d_ij / (|d_ij|^2 + soft2)^1.5 of NBodyCPU:
+//63 bit keys (21 levels) in a cube kept from step to step while every particle stays inside it, so the keys come
+//in the order of the last step and an insertion sort with a work cap usually finishes them (a parallel LSD radix sort
+//otherwise); positions and masses are gathered in key order, the subtrees at cutLevel are built on all cores and
+//spliced into one array in depth first order where next skips a subtree (a leaf has next == its index + 1);
+//nodes carry mass, centre of mass and the quadrupole sum m (3 d d^T - |d|^2 I) about it;
+//every leaf is a group that walks the tree once: a cell away from the group box is taken as a multipole when its side
+//is below theta times the distance from its centre of mass to the group box, leaves that are opened are summed
+//directly, then both lists run with the group in SIMD lanes
+template<class T>struct NBodyTree
+{
+	using S = NBodySimd<T>;
+	using V = typename S::V;
+	struct Node
+	{
+		T cx, cy, cz, mass;
+		T qxx, qyy, qzz, qxy, qxz, qyz;
+		T bx, by, bz, half;//box
+		unsigned long long begin, end;//particles [begin, end) in key order
+		unsigned long long next;
+	};
+	struct Task
+	{
+		unsigned long long begin, end, level;
+		T bx, by, bz, half;
+	};
+	static constexpr unsigned long long leafSize = 64;
+	static constexpr unsigned long long levels = 21;
+	static constexpr unsigned long long cutLevel = 2;
+	static constexpr unsigned long long radixBits = 11;
+	static constexpr unsigned long long radixBlocks = 64;
+	static constexpr unsigned long long chunk = 4096;
+	std::vector<Node> nodes;
+	std::vector<unsigned long long> groups;//leaves
+	std::vector<unsigned long long> keys;
+	std::vector<unsigned long long> order;//key order -> particle
+	T lo[3];//root cube
+	T side;
+	T* buffer;
+	T* xs, * ys, * zs, * ms;//key order
+	T* fx, * fy, * fz;
+	unsigned long long capacity;
+	//statistics
+	unsigned long long boxes;//root cubes made
+	unsigned long long radixSorts;
+	unsigned long long insertionSorts;
+
+	NBodyTree()
+		:
+		nodes(), groups(), keys(), order(), lo{ 0,0,0 }, side(0),
+		buffer(nullptr), xs(nullptr), ys(nullptr), zs(nullptr), ms(nullptr), fx(nullptr), fy(nullptr), fz(nullptr),
+		capacity(0), boxes(0), radixSorts(0), insertionSorts(0)
+	{
+	}
+	NBodyTree(NBodyTree const&) = delete;
+	NBodyTree& operator=(NBodyTree const&) = delete;
+	~NBodyTree()
+	{
+		_mm_free(buffer);
+	}
+	//a = field at every particle; returns the number of particle-particle and particle-cell interactions
+	unsigned long long evaluate(T const* x, T const* y, T const* z, T const* m, unsigned long long num,
+		T theta, T soft2, T* ax, T* ay, T* az, unsigned long long threads = 0)
+	{
+		if (!num)return 0;
+		build(x, y, z, m, num, threads);
+		T theta2(theta * theta);
+		std::atomic<unsigned long long> count(0);
+		unsigned long long lists(threads ? threads : BLAS::threadNum());
+		std::vector<std::vector<unsigned long long>> cellLists(lists), leafLists(lists);
+		BLAS::parallelFor(groups.size(), [&](unsigned long long g, unsigned long long id)
+			{
+				std::vector<unsigned long long>& cells(cellLists[id]);
+				std::vector<unsigned long long>& leaves(leafLists[id]);
+				Node const& gn(nodes[groups[g]]);
+				T gmin[3]{ xs[gn.begin], ys[gn.begin], zs[gn.begin] };
+				T gmax[3]{ gmin[0], gmin[1], gmin[2] };
+				for (unsigned long long c0(gn.begin + 1); c0 < gn.end; ++c0)
+				{
+					T p[3]{ xs[c0], ys[c0], zs[c0] };
+					for (unsigned long long c1(0); c1 < 3; ++c1)
+					{
+						if (p[c1] < gmin[c1])gmin[c1] = p[c1];
+						if (p[c1] > gmax[c1])gmax[c1] = p[c1];
+					}
+				}
+				cells.clear();
+				leaves.clear();
+				unsigned long long direct(0);
+				for (unsigned long long k(0); k < nodes.size();)
+				{
+					Node const& nd(nodes[k]);
+					T c[3]{ nd.cx, nd.cy, nd.cz }, b[3]{ nd.bx, nd.by, nd.bz }, d2(0);
+					bool apart(false);
+					for (unsigned long long c1(0); c1 < 3; ++c1)
+					{
+						T d(c[c1] < gmin[c1] ? gmin[c1] - c[c1] : (c[c1] > gmax[c1] ? c[c1] - gmax[c1] : 0));
+						d2 += d * d;
+						apart = apart || gmin[c1] > b[c1] + nd.half || gmax[c1] < b[c1] - nd.half;
+					}
+					if (apart && 4 * nd.half * nd.half < theta2 * d2)
+					{
+						cells.push_back(k);
+						k = nd.next;
+					}
+					else if (nd.next == k + 1)
+					{
+						leaves.push_back(k);
+						direct += nd.end - nd.begin;
+						k = nd.next;
+					}
+					else k++;
+				}
+				group(gn.begin, gn.end, cells, leaves, soft2);
+				count += (gn.end - gn.begin) * (cells.size() + direct);
+			}, threads);
+		BLAS::parallelFor((num + chunk - 1) / chunk, [&](unsigned long long b, unsigned long long)
+			{
+				for (unsigned long long c0(b * chunk); c0 < num && c0 < b * chunk + chunk; ++c0)
+				{
+					ax[order[c0]] = fx[c0];
+					ay[order[c0]] = fy[c0];
+					az[order[c0]] = fz[c0];
+				}
+			}, threads);
+		return count;
+	}
+
+private:
+	static unsigned long long spread(unsigned long long a)
+	{
+		a &= 0x1fffff;
+		a = (a | a << 32) & 0x1f00000000ffffull;
+		a = (a | a << 16) & 0x1f0000ff0000ffull;
+		a = (a | a << 8) & 0x100f00f00f00f00full;
+		a = (a | a << 4) & 0x10c30c30c30c30c3ull;
+		a = (a | a << 2) & 0x1249249249249249ull;
+		return a;
+	}
+	//keys of the particles order[c0], false if one is outside the cube
+	bool keysOf(T const* x, T const* y, T const* z, unsigned long long num, unsigned long long threads)
+	{
+		std::atomic<bool> inside(true);
+		double cells(double(1ull << levels)), scale(cells / side);
+		BLAS::parallelFor((num + chunk - 1) / chunk, [&](unsigned long long b, unsigned long long)
+			{
+				for (unsigned long long c0(b * chunk); c0 < num && c0 < b * chunk + chunk; ++c0)
+				{
+					unsigned long long j(order[c0]), k(0);
+					double q[3]{ (x[j] - lo[0]) * scale, (y[j] - lo[1]) * scale, (z[j] - lo[2]) * scale };
+					for (unsigned long long c1(0); c1 < 3; ++c1)
+					{
+						if (!(q[c1] >= 0 && q[c1] < cells))
+						{
+							inside = false;
+							q[c1] = q[c1] >= 0 ? cells - 1 : 0;
+						}
+						k |= spread((unsigned long long)q[c1]) << c1;
+					}
+					keys[c0] = k;
+				}
+			}, threads);
+		return inside;
+	}
+	//cube around all particles with a margin for the next steps
+	void box(T const* x, T const* y, T const* z, unsigned long long num)
+	{
+		T mn[3]{ x[0], y[0], z[0] }, mx[3]{ x[0], y[0], z[0] };
+		for (unsigned long long c0(1); c0 < num; ++c0)
+		{
+			T p[3]{ x[c0], y[c0], z[c0] };
+			for (unsigned long long c1(0); c1 < 3; ++c1)
+			{
+				if (p[c1] < mn[c1])mn[c1] = p[c1];
+				if (p[c1] > mx[c1])mx[c1] = p[c1];
+			}
+		}
+		side = 0;
+		for (unsigned long long c1(0); c1 < 3; ++c1)
+			if (mx[c1] - mn[c1] > side)side = mx[c1] - mn[c1];
+		side = side > 0 ? side * T(1.25) : T(1);
+		for (unsigned long long c1(0); c1 < 3; ++c1)lo[c1] = (mn[c1] + mx[c1]) / 2 - side / 2;
+		boxes++;
+	}
+	//keys and order together, false (a permutation, partly sorted) once more than maxMoves moves are needed
+	bool insertion(unsigned long long num, unsigned long long maxMoves)
+	{
+		unsigned long long moves(0);
+		for (unsigned long long c0(1); c0 < num; ++c0)
+		{
+			unsigned long long k(keys[c0]), o(order[c0]), c1(c0);
+			for (; c1 && keys[c1 - 1] > k; --c1)
+			{
+				keys[c1] = keys[c1 - 1];
+				order[c1] = order[c1 - 1];
+			}
+			keys[c1] = k;
+			order[c1] = o;
+			if ((moves += c0 - c1) > maxMoves)return false;
+		}
+		return true;
+	}
+	//stable, radixBits per pass, passes where every key has the same digit are skipped
+	void radix(unsigned long long num, unsigned long long threads)
+	{
+		constexpr unsigned long long buckets(1ull << radixBits);
+		std::vector<unsigned long long> keys1(num), order1(num), cnt(radixBlocks * buckets);
+		unsigned long long per((num + radixBlocks - 1) / radixBlocks);
+		for (unsigned long long shift(0); shift < 3 * levels; shift += radixBits)
+		{
+			BLAS::parallelFor(radixBlocks, [&](unsigned long long b, unsigned long long)
+				{
+					unsigned long long* h(cnt.data() + b * buckets);
+					::memset(h, 0, buckets * sizeof(unsigned long long));
+					for (unsigned long long c0(b * per); c0 < num && c0 < b * per + per; ++c0)
+						h[(keys[c0] >> shift) & (buckets - 1)]++;
+				}, threads);
+			//digit d of block b goes after all smaller digits and after d in the blocks before b
+			unsigned long long sum(0);
+			bool same(false);
+			for (unsigned long long d(0); d < buckets; ++d)
+			{
+				unsigned long long s(sum);
+				for (unsigned long long b(0); b < radixBlocks; ++b)
+				{
+					unsigned long long c(cnt[b * buckets + d]);
+					cnt[b * buckets + d] = sum;
+					sum += c;
+				}
+				same = same || sum - s == num;
+			}
+			if (same)continue;
+			BLAS::parallelFor(radixBlocks, [&](unsigned long long b, unsigned long long)
+				{
+					unsigned long long* h(cnt.data() + b * buckets);
+					for (unsigned long long c0(b * per); c0 < num && c0 < b * per + per; ++c0)
+					{
+						unsigned long long p(h[(keys[c0] >> shift) & (buckets - 1)]++);
+						keys1[p] = keys[c0];
+						order1[p] = order[c0];
+					}
+				}, threads);
+			keys.swap(keys1);
+			order.swap(order1);
+		}
+		radixSorts++;
+	}
+	void build(T const* x, T const* y, T const* z, T const* m, unsigned long long num, unsigned long long threads)
+	{
+		if (order.size() != num)
+		{
+			order.resize(num);
+			keys.resize(num);
+			for (unsigned long long c0(0); c0 < num; ++c0)order[c0] = c0;
+			side = 0;
+		}
+		if (side <= 0 || !keysOf(x, y, z, num, threads))
+		{
+			box(x, y, z, num);
+			keysOf(x, y, z, num, threads);
+		}
+		if (insertion(num, num))insertionSorts++;
+		else radix(num, threads);
+		//the group kernel reads up to a register past the end
+		if (capacity < num + S::width)
+		{
+			_mm_free(buffer);
+			capacity = num + S::width;
+			buffer = (T*)_mm_malloc(7 * capacity * sizeof(T), 64);
+			xs = buffer; ys = xs + capacity; zs = ys + capacity; ms = zs + capacity;
+			fx = ms + capacity; fy = fx + capacity; fz = fy + capacity;
+			::memset(buffer, 0, 7 * capacity * sizeof(T));
+		}
+		BLAS::parallelFor((num + chunk - 1) / chunk, [&](unsigned long long b, unsigned long long)
+			{
+				for (unsigned long long c0(b * chunk); c0 < num && c0 < b * chunk + chunk; ++c0)
+				{
+					unsigned long long j(order[c0]);
+					xs[c0] = x[j]; ys[c0] = y[j]; zs[c0] = z[j]; ms[c0] = m[j];
+				}
+			}, threads);
+		std::vector<Task> tasks;
+		std::vector<std::vector<Node>> subs;
+		unsigned long long t(0);
+		nodes.clear();
+		top({ 0, num, 0, lo[0] + side / 2, lo[1] + side / 2, lo[2] + side / 2, side / 2 }, &tasks, subs, t);
+		subs.resize(tasks.size());
+		BLAS::parallelFor(tasks.size(), [&](unsigned long long c0, unsigned long long)
+			{
+				grow(subs[c0], tasks[c0]);
+			}, threads);
+		top({ 0, num, 0, lo[0] + side / 2, lo[1] + side / 2, lo[2] + side / 2, side / 2 }, nullptr, subs, t);
+		groups.clear();
+		for (unsigned long long c0(0); c0 < nodes.size(); ++c0)
+			if (nodes[c0].next == c0 + 1)groups.push_back(c0);
+	}
+	//ranges of the 8 octants of [begin, end) at level
+	void octants(Task const& a, unsigned long long* cut)const
+	{
+		unsigned long long shift(3 * (levels - 1 - a.level));
+		cut[0] = a.begin;
+		for (unsigned long long d(1); d < 8; ++d)
+			cut[d] = std::partition_point(keys.data() + cut[d - 1], keys.data() + a.end, [&](unsigned long long k)
+				{
+					return ((k >> shift) & 7) < d;
+				}) - keys.data();
+		cut[8] = a.end;
+	}
+	Task child(Task const& a, unsigned long long const* cut, unsigned long long d)const
+	{
+		T h(a.half / 2);
+		return { cut[d], cut[d + 1], a.level + 1, a.bx + (d & 1 ? h : -h), a.by + (d & 2 ? h : -h), a.bz + (d & 4 ? h : -h), h };
+	}
+	//levels above cutLevel: collects the tasks when tasks is given, else splices subs in the same order
+	void top(Task const& a, std::vector<Task>* tasks, std::vector<std::vector<Node>>& subs, unsigned long long& t)
+	{
+		if (a.level == cutLevel || a.end - a.begin <= leafSize)
+		{
+			if (tasks)tasks->push_back(a);
+			else
+			{
+				unsigned long long offset(nodes.size());
+				for (Node nd : subs[t++])
+				{
+					nd.next += offset;
+					nodes.push_back(nd);
+				}
+			}
+			return;
+		}
+		unsigned long long k(nodes.size()), cut[9];
+		if (!tasks)nodes.push_back(node(a));
+		octants(a, cut);
+		for (unsigned long long d(0); d < 8; ++d)
+			if (cut[d + 1] > cut[d])top(child(a, cut, d), tasks, subs, t);
+		if (!tasks)
+		{
+			nodes[k].next = nodes.size();
+			combine(nodes, k);
+		}
+	}
+	void grow(std::vector<Node>& out, Task const& a)
+	{
+		unsigned long long k(out.size());
+		out.push_back(node(a));
+		if (a.end - a.begin <= leafSize || a.level == levels)
+		{
+			out[k].next = k + 1;
+			leaf(out[k]);
+			return;
+		}
+		unsigned long long cut[9];
+		octants(a, cut);
+		for (unsigned long long d(0); d < 8; ++d)
+			if (cut[d + 1] > cut[d])grow(out, child(a, cut, d));
+		out[k].next = out.size();
+		combine(out, k);
+	}
+	static Node node(Task const& a)
+	{
+		Node nd{};
+		nd.bx = a.bx; nd.by = a.by; nd.bz = a.bz; nd.half = a.half;
+		nd.begin = a.begin;
+		nd.end = a.end;
+		return nd;
+	}
+	void leaf(Node& nd)const
+	{
+		double mass(0), cx(0), cy(0), cz(0);
+		for (unsigned long long c0(nd.begin); c0 < nd.end; ++c0)
+		{
+			mass += ms[c0];
+			cx += double(ms[c0]) * xs[c0];
+			cy += double(ms[c0]) * ys[c0];
+			cz += double(ms[c0]) * zs[c0];
+		}
+		if (mass > 0)
+		{
+			cx /= mass; cy /= mass; cz /= mass;
+		}
+		else
+		{
+			cx = nd.bx; cy = nd.by; cz = nd.bz;
+		}
+		double xx(0), yy(0), zz(0), xy(0), xz(0), yz(0);
+		for (unsigned long long c0(nd.begin); c0 < nd.end; ++c0)
+		{
+			double dx(xs[c0] - cx), dy(ys[c0] - cy), dz(zs[c0] - cz);
+			double d2(dx * dx + dy * dy + dz * dz), w(ms[c0]);
+			xx += w * (3 * dx * dx - d2);
+			yy += w * (3 * dy * dy - d2);
+			zz += w * (3 * dz * dz - d2);
+			xy += w * 3 * dx * dy;
+			xz += w * 3 * dx * dz;
+			yz += w * 3 * dy * dz;
+		}
+		nd.mass = T(mass);
+		nd.cx = T(cx); nd.cy = T(cy); nd.cz = T(cz);
+		nd.qxx = T(xx); nd.qyy = T(yy); nd.qzz = T(zz);
+		nd.qxy = T(xy); nd.qxz = T(xz); nd.qyz = T(yz);
+	}
+	//moments of out[k] from its children, shifted to the common centre of mass
+	static void combine(std::vector<Node>& out, unsigned long long k)
+	{
+		Node& nd(out[k]);
+		double mass(0), cx(0), cy(0), cz(0);
+		for (unsigned long long c(k + 1); c < nd.next; c = out[c].next)
+		{
+			mass += out[c].mass;
+			cx += double(out[c].mass) * out[c].cx;
+			cy += double(out[c].mass) * out[c].cy;
+			cz += double(out[c].mass) * out[c].cz;
+		}
+		if (mass > 0)
+		{
+			cx /= mass; cy /= mass; cz /= mass;
+		}
+		else
+		{
+			cx = nd.bx; cy = nd.by; cz = nd.bz;
+		}
+		double xx(0), yy(0), zz(0), xy(0), xz(0), yz(0);
+		for (unsigned long long c(k + 1); c < nd.next; c = out[c].next)
+		{
+			Node const& ch(out[c]);
+			double dx(ch.cx - cx), dy(ch.cy - cy), dz(ch.cz - cz);
+			double d2(dx * dx + dy * dy + dz * dz), w(ch.mass);
+			xx += ch.qxx + w * (3 * dx * dx - d2);
+			yy += ch.qyy + w * (3 * dy * dy - d2);
+			zz += ch.qzz + w * (3 * dz * dz - d2);
+			xy += ch.qxy + w * 3 * dx * dy;
+			xz += ch.qxz + w * 3 * dx * dz;
+			yz += ch.qyz + w * 3 * dy * dz;
+		}
+		nd.mass = T(mass);
+		nd.cx = T(cx); nd.cy = T(cy); nd.cz = T(cz);
+		nd.qxx = T(xx); nd.qyy = T(yy); nd.qzz = T(zz);
+		nd.qxy = T(xy); nd.qxz = T(xz); nd.qyz = T(yz);
+	}
+	//particles [begin, end) against the cells as multipoles and the leaves particle by particle;
+	//cell term with R = r_i - c: Q R / R^5 - (M / R^3 + 2.5 R^T Q R / R^7) R
+	void group(unsigned long long begin, unsigned long long end,
+		std::vector<unsigned long long> const& cells, std::vector<unsigned long long> const& leaves, T soft2)
+	{
+		alignas(64) T tx[S::width], ty[S::width], tz[S::width];
+		V s2(S::set1(soft2)), c25(S::set1(T(2.5)));
+		for (unsigned long long i(begin); i < end; i += S::width)
+		{
+			V xi(S::loadu(xs + i)), yi(S::loadu(ys + i)), zi(S::loadu(zs + i));
+			V ax(S::zero()), ay(S::zero()), az(S::zero());
+			for (unsigned long long k : cells)
+			{
+				Node const& nd(nodes[k]);
+				V dx(S::sub(xi, S::set1(nd.cx))), dy(S::sub(yi, S::set1(nd.cy))), dz(S::sub(zi, S::set1(nd.cz)));
+				V ir(S::rsqrt(S::fmadd(dx, dx, S::fmadd(dy, dy, S::fmadd(dz, dz, s2)))));
+				V ir2(S::mul(ir, ir));
+				V ir3(S::mul(ir, ir2));
+				V ir5(S::mul(ir3, ir2));
+				V qx(S::fmadd(S::set1(nd.qxx), dx, S::fmadd(S::set1(nd.qxy), dy, S::mul(S::set1(nd.qxz), dz))));
+				V qy(S::fmadd(S::set1(nd.qxy), dx, S::fmadd(S::set1(nd.qyy), dy, S::mul(S::set1(nd.qyz), dz))));
+				V qz(S::fmadd(S::set1(nd.qxz), dx, S::fmadd(S::set1(nd.qyz), dy, S::mul(S::set1(nd.qzz), dz))));
+				V rqr(S::fmadd(dx, qx, S::fmadd(dy, qy, S::mul(dz, qz))));
+				V s(S::fmadd(S::set1(nd.mass), ir3, S::mul(S::mul(c25, rqr), S::mul(ir5, ir2))));
+				ax = S::sub(S::fmadd(qx, ir5, ax), S::mul(s, dx));
+				ay = S::sub(S::fmadd(qy, ir5, ay), S::mul(s, dy));
+				az = S::sub(S::fmadd(qz, ir5, az), S::mul(s, dz));
+			}
+			for (unsigned long long k : leaves)
+				for (unsigned long long j(nodes[k].begin); j < nodes[k].end; ++j)
+				{
+					V dx(S::sub(S::set1(xs[j]), xi)), dy(S::sub(S::set1(ys[j]), yi)), dz(S::sub(S::set1(zs[j]), zi));
+					V w(S::mul(S::set1(ms[j]), S::rsqrt3(S::fmadd(dx, dx, S::fmadd(dy, dy, S::fmadd(dz, dz, s2))))));
+					ax = S::fmadd(w, dx, ax);
+					ay = S::fmadd(w, dy, ay);
+					az = S::fmadd(w, dz, az);
+				}
+			S::store(tx, ax);
+			S::store(ty, ay);
+			S::store(tz, az);
+			for (unsigned long long c0(0); c0 < S::width && i + c0 < end; ++c0)
+			{
+				fx[i + c0] = tx[c0];
+				fy[i + c0] = ty[c0];
+				fz[i + c0] = tz[c0];
+			}
+		}
+	}
+};
+
+//all-pairs gravity on structure-of-arrays particles of float or double:
+//a_i = G sum_j m_j d_ij / (|d_ij|^2 + soft2)^1.5, d_ij = r_j - r_i;
+//a task is a tile of i, every tile runs over j in blocks that stay in L2 with 2 registers of i per pass,
+//each i sums its j in the same order whatever the number of threads;
+//arrays are padded to a whole tile with massless particles at the origin;
+//theta > 0 swaps the pair sum for NBodyTree with that opening angle
+template<class T>struct NBodyCPU
+{
+	using S = NBodySimd<T>;
+	using V = typename S::V;
+	static constexpr unsigned long long tile = 256;
+	static constexpr unsigned long long jBlock = 4096;
+	unsigned long long num;
+	unsigned long long size;//num rounded up to tile
+	T* buffer;
+	T* x, * y, * z, * m;
+	T* vx, * vy, * vz;
+	T* ax, * ay, * az;//field sum_j m_j d_ij / (...)^1.5 of the last accelerations, without G
+	T dt;
+	T G;
+	T soft2;
+	T theta;
+	NBodyTree<T> tree;
+	BLAS::odeSymplectic::Scheme scheme;
+	unsigned long long threads;//0: threadNum()
+	bool fresh;//a belongs to the current positions
+	//statistics since construction or clearStats
+	unsigned long long interactions;
+	double seconds;
+
+	NBodyCPU(unsigned long long _num, T _dt, T _G, T _soft2 = T(1e-8))
+		:
+		num(_num),
+		size((_num + tile - 1) / tile * tile),
+		buffer((T*)_mm_malloc(10 * size * sizeof(T), 64)),
+		x(buffer), y(x + size), z(y + size), m(z + size),
+		vx(m + size), vy(vx + size), vz(vy + size),
+		ax(vz + size), ay(ax + size), az(ay + size),
+		dt(_dt), G(_G), soft2(_soft2),
+		theta(0),
+		tree(),
+		scheme(BLAS::odeSymplectic::Scheme::Leapfrog),
+		threads(0),
+		fresh(false),
+		interactions(0),
+		seconds(0)
+	{
+		::memset(buffer, 0, 10 * size * sizeof(T));
+	}
+	NBodyCPU(NBodyCPU const&) = delete;
+	NBodyCPU& operator=(NBodyCPU const&) = delete;
+	~NBodyCPU()
+	{
+		_mm_free(buffer);
+	}
+	//ax, ay, az for the current positions; returns the seconds taken
+	double accelerations(T _soft2)
+	{
+		auto t0(std::chrono::steady_clock::now());
+		if (theta > 0)interactions += tree.evaluate(x, y, z, m, num, theta, _soft2, ax, ay, az, threads);
+		else
+		{
+			BLAS::parallelFor(size / tile, [&](unsigned long long t, unsigned long long)
+				{
+					for (unsigned long long j0(0); j0 < size; j0 += jBlock)
+						block(t * tile, j0, j0 + jBlock < size ? j0 + jBlock : size, _soft2);
+				}, threads);
+			interactions += num * num;
+		}
+		double s(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+		seconds += s;
+		return s;
+	}
+	void accelerations()
+	{
+		accelerations(soft2);
+		fresh = true;
+	}
+	//v += G h a
+	void kick(T h)
+	{
+		V k(S::set1(G * h));
+		for (unsigned long long c0(0); c0 < size; c0 += S::width)
+		{
+			S::store(vx + c0, S::fmadd(k, S::load(ax + c0), S::load(vx + c0)));
+			S::store(vy + c0, S::fmadd(k, S::load(ay + c0), S::load(vy + c0)));
+			S::store(vz + c0, S::fmadd(k, S::load(az + c0), S::load(vz + c0)));
+		}
+	}
+	//r += h v
+	void drift(T h)
+	{
+		V k(S::set1(h));
+		for (unsigned long long c0(0); c0 < size; c0 += S::width)
+		{
+			S::store(x + c0, S::fmadd(k, S::load(vx + c0), S::load(x + c0)));
+			S::store(y + c0, S::fmadd(k, S::load(vy + c0), S::load(y + c0)));
+			S::store(z + c0, S::fmadd(k, S::load(vz + c0), S::load(z + c0)));
+		}
+		fresh = false;
+	}
+	//kick-drift-kick leapfrog or its Yoshida triple jump, one field evaluation per drift (the first step needs one more)
+	void step()
+	{
+		double k[4], d[3];
+		unsigned long long s(BLAS::odeSymplectic::coefficients(scheme, k, d));
+		if (!fresh)accelerations();
+		for (unsigned long long c0(0); c0 < s; ++c0)
+		{
+			kick(T(k[c0] * dt));
+			drift(T(d[c0] * dt));
+			accelerations();
+		}
+		kick(T(k[s] * dt));
+	}
+	void run(unsigned long long steps)
+	{
+		for (unsigned long long c0(0); c0 < steps; ++c0)step();
+	}
+	//call after changing positions or masses from outside
+	void touch()
+	{
+		fresh = false;
+	}
+	//kinetic + softened potential energy, in double
+	double energy()const
+	{
+		std::vector<double> partial(size / tile, 0);
+		BLAS::parallelFor(size / tile, [&](unsigned long long t, unsigned long long)
+			{
+				double e(0);
+				for (unsigned long long i(t * tile); i < t * tile + tile && i < num; ++i)
+				{
+					double u(0);
+					for (unsigned long long j(i + 1); j < num; ++j)
+					{
+						double dx(double(x[j]) - x[i]), dy(double(y[j]) - y[i]), dz(double(z[j]) - z[i]);
+						u += m[j] / ::sqrt(dx * dx + dy * dy + dz * dz + soft2);
+					}
+					e += 0.5 * m[i] * (double(vx[i]) * vx[i] + double(vy[i]) * vy[i] + double(vz[i]) * vz[i]) - G * m[i] * u;
+				}
+				partial[t] = e;
+			}, threads);
+		double e(0);
+		for (double a : partial)e += a;
+		return e;
+	}
+	//interactions (pairs, or particle-particle and particle-cell with the tree) per second of all accelerations so far
+	double pairRate()const
+	{
+		return seconds > 0 ? interactions / seconds : 0;
+	}
+	void clearStats()
+	{
+		interactions = 0;
+		seconds = 0;
+	}
+
+private:
+	//i in [i0, i0 + tile) against j in [j0, j1), the first j block overwrites a
+	void block(unsigned long long i0, unsigned long long j0, unsigned long long j1, T _soft2)
+	{
+		V s2(S::set1(_soft2));
+		for (unsigned long long i(i0); i < i0 + tile; i += 2 * S::width)
+		{
+			V xi0(S::load(x + i)), yi0(S::load(y + i)), zi0(S::load(z + i));
+			V xi1(S::load(x + i + S::width)), yi1(S::load(y + i + S::width)), zi1(S::load(z + i + S::width));
+			V ax0, ay0, az0, ax1, ay1, az1;
+			if (j0)
+			{
+				ax0 = S::load(ax + i); ay0 = S::load(ay + i); az0 = S::load(az + i);
+				ax1 = S::load(ax + i + S::width); ay1 = S::load(ay + i + S::width); az1 = S::load(az + i + S::width);
+			}
+			else ax0 = ay0 = az0 = ax1 = ay1 = az1 = S::zero();
+			for (unsigned long long j(j0); j < j1; ++j)
+			{
+				V xj(S::set1(x[j])), yj(S::set1(y[j])), zj(S::set1(z[j])), mj(S::set1(m[j]));
+				V dx0(S::sub(xj, xi0)), dy0(S::sub(yj, yi0)), dz0(S::sub(zj, zi0));
+				V dx1(S::sub(xj, xi1)), dy1(S::sub(yj, yi1)), dz1(S::sub(zj, zi1));
+				V r0(S::fmadd(dx0, dx0, S::fmadd(dy0, dy0, S::fmadd(dz0, dz0, s2))));
+				V r1(S::fmadd(dx1, dx1, S::fmadd(dy1, dy1, S::fmadd(dz1, dz1, s2))));
+				r0 = S::mul(mj, S::rsqrt3(r0));
+				r1 = S::mul(mj, S::rsqrt3(r1));
+				ax0 = S::fmadd(r0, dx0, ax0); ay0 = S::fmadd(r0, dy0, ay0); az0 = S::fmadd(r0, dz0, az0);
+				ax1 = S::fmadd(r1, dx1, ax1); ay1 = S::fmadd(r1, dy1, ay1); az1 = S::fmadd(r1, dz1, az1);
+			}
+			S::store(ax + i, ax0); S::store(ay + i, ay0); S::store(az + i, az0);
+			S::store(ax + i + S::width, ax1); S::store(ay + i + S::width, ay1); S::store(az + i + S::width, az1);
+		}
+	}
+};
+
+//drop-in for NBodyCUDA_Glue: particles is 1024 blocks entries in host memory, run is one drift then kick
+//like positionCalc and velocityCalc_Optimize1 but with the dt and G given here, experiment is forceCalc
+struct NBodyCPU_Glue
+{
+	NBodyCPUParticle* particles;
+	unsigned int blocks;
+	NBodyCPU<float> engine;
+
+	NBodyCPU_Glue(unsigned int _blocks, float _dt, float _G)
+		:
+		particles(nullptr),
+		blocks(_blocks),
+		engine(1024ull * _blocks, _dt, _G, 1e-8f)
+	{
+	}
+	void run()
+	{
+		gather();
+		engine.drift(engine.dt);
+		engine.accelerations();
+		engine.kick(engine.dt);
+		for (unsigned long long c0(0); c0 < engine.num; ++c0)
+		{
+			NBodyCPUParticle& p(particles[c0]);
+			p.position[0] = engine.x[c0]; p.position[1] = engine.y[c0]; p.position[2] = engine.z[c0];
+			p.velocity[0] = engine.vx[c0]; p.velocity[1] = engine.vy[c0]; p.velocity[2] = engine.vz[c0];
+		}
+	}
+	//expData[i]: |r_i| and the radial part of the field at r_i, softened by 1e-3 like forceCalc;
+	//E is NBodyCPUExpData or any aggregate of float r, force such as the CUDA ExpData
+	template<class E>void experiment(E* expData)
+	{
+		gather();
+		engine.accelerations(1e-3f);
+		engine.touch();
+		for (unsigned long long c0(0); c0 < engine.num; ++c0)
+		{
+			float a(::sqrtf(engine.x[c0] * engine.x[c0] + engine.y[c0] * engine.y[c0] + engine.z[c0] * engine.z[c0]));
+			expData[c0] = { a, (engine.ax[c0] * engine.x[c0] + engine.ay[c0] * engine.y[c0] + engine.az[c0] * engine.z[c0]) / a };
+		}
+	}
+
+private:
+	void gather()
+	{
+		for (unsigned long long c0(0); c0 < engine.num; ++c0)
+		{
+			NBodyCPUParticle const& p(particles[c0]);
+			engine.x[c0] = p.position[0]; engine.y[c0] = p.position[1]; engine.z[c0] = p.position[2];
+			engine.m[c0] = p.mass;
+			engine.vx[c0] = p.velocity[0]; engine.vy[c0] = p.velocity[1]; engine.vz[c0] = p.velocity[2];
+		}
+		engine.touch();
+	}
+};